@@ -157,6 +157,16 @@ namespace codal
      * @return A random, natural number between 0 and the max-1. Or DEVICE_INVALID_VALUE if max is <= 0.
      */
     int random(int max);
+
+    /**
+     * Calculates the CRC-32 (as used by zlib and Ethernet) of the given data.
+     *
+     * @param data The data to checksum.
+     * @param len The number of bytes to checksum.
+     * @param crc The CRC of any preceding data, allowing a checksum to be computed in several parts. Defaults to 0.
+     * @return The CRC-32 of the data.
+     */
+    uint32_t crc32(const void *data, uint32_t len, uint32_t crc = 0);
 }
 
 #endif
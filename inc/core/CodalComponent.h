@@ -71,6 +71,10 @@ DEALINGS IN THE SOFTWARE.
 #define DEVICE_ID_SPLITTER            37
 #define DEVICE_ID_AUDIO_PROCESSOR     38
 #define DEVICE_ID_TAP                 39
+#define DEVICE_ID_SENSOR_FUSION       40
+#define DEVICE_ID_USB_CDC             41
+#define DEVICE_ID_EDGE_CAPTURE        42
+#define DEVICE_ID_BUTTON_SCANNER      43
 
 #define DEVICE_ID_IO_P0               100                       // IDs 100-227 are reserved for I/O Pin IDs.
 
@@ -164,6 +164,24 @@ DEALINGS IN THE SOFTWARE.
 #define DEVICE_DMESG_BUFFER_SIZE              1024
 #endif
 
+// When set to '1', DMESG() only records the address of its format string and its raw arguments, in a binary
+// ring of DEVICE_DMESG_BINARY_SIZE words ('print codalBinaryLogStore'). Messages are formatted into codalLogStore
+// when codal_dmesg_flush() is called, or can be decoded on the host using the format strings in the ELF file.
+#ifndef DEVICE_DMESG_BINARY
+#define DEVICE_DMESG_BINARY                   0
+#endif
+
+// The size of the binary DMESG ring, in 32 bit words. Must be a power of two.
+#ifndef DEVICE_DMESG_BINARY_SIZE
+#define DEVICE_DMESG_BINARY_SIZE              256
+#endif
+
+// Messages logged with DMESG_ERROR() .. DMESG_DEBUG() above this level are compiled out.
+// 1 - errors, 2 - warnings, 3 - information, 4 - debug. Can be set per subsystem, e.g. DMESG_LEVEL_USB.
+#ifndef DMESG_LEVEL
+#define DMESG_LEVEL                           3
+#endif
+
 #ifndef CODAL_DEBUG
 #define CODAL_DEBUG                           CODAL_DEBUG_DISABLED
 #endif
@@ -176,6 +194,12 @@ DEALINGS IN THE SOFTWARE.
 #define CODAL_LOW_LEVEL_VALIDATION            0
 #endif
 
+// Enable this to serve single character ManagedStrings from a read-only table in flash, rather than the heap.
+// Costs around 600 bytes of flash (800 with DEVICE_TAG). Set '1' to enable.
+#ifndef MANAGED_STRING_STATIC_CHARS
+#define MANAGED_STRING_STATIC_CHARS           1
+#endif
+
 // Versioning options.
 // We use semantic versioning (http://semver.org/) to identify differnet versions of the codal device runtime.
 // Where possible we use yotta (an ARM mbed build tool) to help us track versions.
@@ -194,6 +218,19 @@ DEALINGS IN THE SOFTWARE.
 #define DEVICE_WEBUSB                         1
 #endif
 
+// Report the device as a composite (Miscellaneous/IAD) device, rather than specifying class per-interface.
+// Enable this when using interfaces that need interface association descriptors, such as USBCDC, for Windows to bind them.
+#ifndef DEVICE_USB_IAD
+#define DEVICE_USB_IAD                        0
+#endif
+
+// Enable this to calculate pitch, roll, compass heading and field strength using fixed point, lookup table
+// based maths rather than floating point trigonometry. Recommended for CPUs without a floating point unit.
+// Set '1' to enable.
+#ifndef CODAL_FIXED_POINT_ORIENTATION
+#define CODAL_FIXED_POINT_ORIENTATION  0
+#endif
+
 #ifndef CODAL_PROVIDE_PRINTF
 #define CODAL_PROVIDE_PRINTF           1
 #endif
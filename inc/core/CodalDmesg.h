@@ -28,6 +28,52 @@ DEALINGS IN THE SOFTWARE.
 #include "CodalConfig.h"
 #include <stdbool.h>
 
+#define DMESG_LEVEL_ERROR   1
+#define DMESG_LEVEL_WARN    2
+#define DMESG_LEVEL_INFO    3
+#define DMESG_LEVEL_DEBUG   4
+
+// Per subsystem log levels, for use with DMESG_ERROR() .. DMESG_DEBUG().
+#ifndef DMESG_LEVEL_BUS
+#define DMESG_LEVEL_BUS     DMESG_LEVEL
+#endif
+
+#ifndef DMESG_LEVEL_HEAP
+#define DMESG_LEVEL_HEAP    DMESG_LEVEL
+#endif
+
+#ifndef DMESG_LEVEL_USB
+#define DMESG_LEVEL_USB     DMESG_LEVEL
+#endif
+
+#ifndef DMESG_LEVEL_STREAM
+#define DMESG_LEVEL_STREAM  DMESG_LEVEL
+#endif
+
+#ifndef DMESG_LEVEL_SENSOR
+#define DMESG_LEVEL_SENSOR  DMESG_LEVEL
+#endif
+
+/**
+  * Log a message for the given subsystem (BUS, HEAP, USB, STREAM, SENSOR), if its log level is at least the
+  * level of the message. Otherwise the message, and the evaluation of its arguments, is compiled out.
+  *
+  * @code
+  * DMESG_WARN(BUS, "evt %d/%d: overflow!", evt.source, evt.value);
+  * @endcode
+  */
+#define DMESG_AT(subsystem, level, ...)                                                            \
+    do                                                                                             \
+    {                                                                                              \
+        if ((level) <= DMESG_LEVEL_##subsystem)                                                    \
+            DMESG(__VA_ARGS__);                                                                    \
+    } while (0)
+
+#define DMESG_ERROR(subsystem, ...) DMESG_AT(subsystem, DMESG_LEVEL_ERROR, __VA_ARGS__)
+#define DMESG_WARN(subsystem, ...)  DMESG_AT(subsystem, DMESG_LEVEL_WARN, __VA_ARGS__)
+#define DMESG_INFO(subsystem, ...)  DMESG_AT(subsystem, DMESG_LEVEL_INFO, __VA_ARGS__)
+#define DMESG_DEBUG(subsystem, ...) DMESG_AT(subsystem, DMESG_LEVEL_DEBUG, __VA_ARGS__)
+
 #if DEVICE_DMESG_BUFFER_SIZE > 0
 
 #if DEVICE_DMESG_BUFFER_SIZE < 256
@@ -45,6 +91,40 @@ struct CodalLogStore
 };
 extern struct CodalLogStore codalLogStore;
 
+#if CONFIG_ENABLED(DEVICE_DMESG_BINARY)
+
+#if DEVICE_DMESG_BINARY_SIZE & (DEVICE_DMESG_BINARY_SIZE - 1)
+#error "DEVICE_DMESG_BINARY_SIZE must be a power of two"
+#endif
+
+#define DMESG_RECORD_MAGIC          0xDB    // Top byte of the first word of each complete record.
+#define DMESG_RECORD_CRLF           0x100   // Set in the first word if the message ends with a new line.
+#define DMESG_RECORD_MAX_WORDS      16
+#define DMESG_RECORD_MAX_STRING     32      // The most characters of a %s argument kept in a record.
+
+/**
+  * A ring of binary DMESG records, indexed by head and tail modulo DEVICE_DMESG_BINARY_SIZE.
+  *
+  * Each record is a sequence of 32 bit words:
+  *    word 0 - DMESG_RECORD_MAGIC in the top byte, DMESG_RECORD_CRLF, and the length of the record in words in the low byte
+  *    word 1 - the address of the format string
+  *    then one word per argument, except %s arguments: a word holding the number of characters kept,
+  *    followed by the characters, padded to a whole number of words.
+  *
+  * Words between tail and head belong to records not yet consumed. Word 0 is written last, so a record
+  * whose word 0 does not hold DMESG_RECORD_MAGIC is still being written.
+  */
+struct CodalBinaryLogStore
+{
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t dropped;  // The number of records discarded as the ring was full, or corrupt.
+    uint32_t buffer[DEVICE_DMESG_BINARY_SIZE];
+};
+extern struct CodalBinaryLogStore codalBinaryLogStore;
+
+#endif
+
 /**
   * Log formatted message to an internal buffer.
   *
@@ -66,6 +146,9 @@ extern struct CodalLogStore codalLogStore;
   * ...
   * DMESG("USB: Error #%d at %X", k, ptr);
   * @endcode
+  *
+  * With DEVICE_DMESG_BINARY, the format string must be a literal (or otherwise never change), as only its
+  * address is recorded, and formatting happens when codal_dmesg_flush() is called.
   */
 void codal_dmesg(const char *format, ...);
 void codal_dmesg_nocrlf(const char *format, ...);
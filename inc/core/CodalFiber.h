@@ -40,6 +40,7 @@ DEALINGS IN THE SOFTWARE.
 #include "Event.h"
 #include "EventModel.h"
 #include "codal_target_hal.h"
+#include "ErrorNo.h"
 
 // Fiber Scheduler Flags
 #define DEVICE_SCHEDULER_RUNNING            0x01
@@ -51,12 +52,19 @@ DEALINGS IN THE SOFTWARE.
 #define DEVICE_FIBER_FLAG_PARENT            0x02
 #define DEVICE_FIBER_FLAG_CHILD             0x04
 #define DEVICE_FIBER_FLAG_DO_NOT_PAGE       0x08
+#define DEVICE_FIBER_FLAG_WAIT_ALL          0x10
+#define DEVICE_FIBER_FLAG_CLEAR_ON_EXIT     0x20
 
 #define DEVICE_SCHEDULER_EVT_TICK           1
 #define DEVICE_SCHEDULER_EVT_IDLE           2
 
 #define DEVICE_GET_FIBER_LIST_AVAILABLE     1
 
+// FiberEventFlags wait modes
+#define FIBER_EVENT_FLAGS_WAIT_ANY          0x00
+#define FIBER_EVENT_FLAGS_WAIT_ALL          0x01
+#define FIBER_EVENT_FLAGS_CLEAR_ON_EXIT     0x02
+
 
 namespace codal
 {
@@ -388,6 +396,245 @@ namespace codal
          */
         int getWaitCount();
     };
+
+    /**
+     * A counting semaphore.
+     *
+     * Waiting fibers are held on a private queue and moved directly onto the run queue when signalled,
+     * so no events are raised on the MessageBus. signal() may be safely called from interrupt context.
+     */
+    class FiberSemaphore
+    {
+        private:
+        volatile int    count;
+        Fiber           *queue;
+
+        public:
+
+        /**
+         * Create a new semaphore.
+         *
+         * @param initialCount The number of units initially available.
+         */
+        FiberSemaphore(int initialCount = 0);
+
+        /**
+         * Block the calling fiber until a unit is available, and take it.
+         *
+         * @return DEVICE_OK on success, or DEVICE_NOT_SUPPORTED if no unit is available and the scheduler is not running.
+         */
+        int wait();
+
+        /**
+         * Take a unit if one is available, without blocking.
+         *
+         * @return DEVICE_OK on success, or DEVICE_BUSY if no unit is available.
+         */
+        int tryWait();
+
+        /**
+         * Release a unit. If any fibers are blocked, the longest waiting fiber is given the unit and made runnable.
+         * Safe to call from interrupt context.
+         */
+        void signal();
+
+        /**
+         * Determine the number of units currently available.
+         */
+        int getCount();
+
+        /**
+         * Determine the number of fibers currently blocked on this semaphore.
+         */
+        int getWaitCount();
+    };
+
+    /**
+     * A set of 32 event flags, on which fibers can wait for any or all of a given mask to be set.
+     *
+     * Waiting fibers are woken directly through the run queue, without generating MessageBus events.
+     * set() and clear() may be safely called from interrupt context.
+     */
+    class FiberEventFlags
+    {
+        private:
+        volatile uint32_t   flags;
+        Fiber               *queue;
+
+        public:
+
+        /**
+         * Create a new set of event flags, all initially clear.
+         */
+        FiberEventFlags();
+
+        /**
+         * Block the calling fiber until the flags given in mask are set.
+         *
+         * @param mask The flags of interest.
+         *
+         * @param mode FIBER_EVENT_FLAGS_WAIT_ANY or FIBER_EVENT_FLAGS_WAIT_ALL, optionally combined with
+         *             FIBER_EVENT_FLAGS_CLEAR_ON_EXIT to atomically clear the flags in mask when the wait completes.
+         *
+         * @return The value of the flags at the point the wait was satisfied, or 0 if the wait could not be satisfied
+         *         without blocking and the scheduler is not running.
+         */
+        uint32_t wait(uint32_t mask, int mode = FIBER_EVENT_FLAGS_WAIT_ANY);
+
+        /**
+         * Set the given flags, and wake any fibers whose wait condition is now satisfied.
+         * Safe to call from interrupt context.
+         *
+         * @param mask The flags to set.
+         */
+        void set(uint32_t mask);
+
+        /**
+         * Clear the given flags.
+         *
+         * @param mask The flags to clear.
+         */
+        void clear(uint32_t mask);
+
+        /**
+         * Determine the current value of the flags.
+         */
+        uint32_t get();
+
+        /**
+         * Determine the number of fibers currently blocked on these flags.
+         */
+        int getWaitCount();
+    };
+
+    /**
+     * A fixed capacity, first in first out queue of N elements of type T.
+     *
+     * put() blocks the calling fiber while the queue is full, and get() blocks while it is empty.
+     * The non-blocking tryPut() and tryGet() variants may be used from interrupt context.
+     * Elements are copied into and out of the queue, so T should be a small, trivially copyable type.
+     */
+    template <typename T, int N>
+    class FiberQueue
+    {
+        private:
+        T               buffer[N];
+        uint16_t        head;
+        uint16_t        tail;
+        FiberSemaphore  items;
+        FiberSemaphore  spaces;
+
+        void push(const T &value)
+        {
+            target_disable_irq();
+            buffer[tail] = value;
+            tail = (tail + 1) % N;
+            target_enable_irq();
+
+            items.signal();
+        }
+
+        void pop(T &value)
+        {
+            target_disable_irq();
+            value = buffer[head];
+            head = (head + 1) % N;
+            target_enable_irq();
+
+            spaces.signal();
+        }
+
+        public:
+
+        /**
+         * Create a new, empty queue.
+         */
+        FiberQueue() : head(0), tail(0), items(0), spaces(N)
+        {
+        }
+
+        /**
+         * Add an element to the tail of the queue, blocking the calling fiber until space is available.
+         *
+         * @param value The element to add.
+         *
+         * @return DEVICE_OK on success, or DEVICE_NOT_SUPPORTED if the queue is full and the scheduler is not running.
+         */
+        int put(const T &value)
+        {
+            int result = spaces.wait();
+
+            if (result == DEVICE_OK)
+                push(value);
+
+            return result;
+        }
+
+        /**
+         * Add an element to the tail of the queue if space is available, without blocking.
+         *
+         * @param value The element to add.
+         *
+         * @return DEVICE_OK on success, or DEVICE_NO_RESOURCES if the queue is full.
+         */
+        int tryPut(const T &value)
+        {
+            if (spaces.tryWait() != DEVICE_OK)
+                return DEVICE_NO_RESOURCES;
+
+            push(value);
+            return DEVICE_OK;
+        }
+
+        /**
+         * Remove the element at the head of the queue, blocking the calling fiber until one is available.
+         *
+         * @param value Populated with the element removed.
+         *
+         * @return DEVICE_OK on success, or DEVICE_NOT_SUPPORTED if the queue is empty and the scheduler is not running.
+         */
+        int get(T &value)
+        {
+            int result = items.wait();
+
+            if (result == DEVICE_OK)
+                pop(value);
+
+            return result;
+        }
+
+        /**
+         * Remove the element at the head of the queue if one is available, without blocking.
+         *
+         * @param value Populated with the element removed.
+         *
+         * @return DEVICE_OK on success, or DEVICE_NO_DATA if the queue is empty.
+         */
+        int tryGet(T &value)
+        {
+            if (items.tryWait() != DEVICE_OK)
+                return DEVICE_NO_DATA;
+
+            pop(value);
+            return DEVICE_OK;
+        }
+
+        /**
+         * Determine the number of elements currently held in the queue.
+         */
+        int length()
+        {
+            return items.getCount();
+        }
+
+        /**
+         * Determine the maximum number of elements the queue can hold.
+         */
+        int capacity()
+        {
+            return N;
+        }
+    };
 }
 
 
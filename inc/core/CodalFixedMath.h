@@ -0,0 +1,91 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+/**
+  * Fixed point, lookup table based maths functions.
+  *
+  * These provide fast approximations of the trigonometric and square root functions used to derive
+  * orientation (pitch, roll and compass heading) on CPUs without a floating point unit.
+  *
+  * Angles are represented as integers in hundredths of a degree (centidegrees), and sine and cosine
+  * values are returned as signed Q14 fixed point values (i.e. 1.0 == 16384).
+  */
+
+#ifndef CODAL_FIXED_MATH_H
+#define CODAL_FIXED_MATH_H
+
+#include "CodalConfig.h"
+#include "CodalCompat.h"
+
+#define FIXED_MATH_ONE                      16384
+#define FIXED_MATH_SHIFT                    14
+
+#define FIXED_MATH_DEGREES(x)               ((x) * 100)
+#define FIXED_MATH_TO_RADIANS(x)            ((float)(x) * (float)(PI / 18000.0))
+#define FIXED_MATH_FROM_RADIANS(x)          ((int32_t)((x) * (float)(18000.0 / PI)))
+
+namespace codal
+{
+    /**
+      * Calculates the angle of the vector (x, y) from the positive x axis, in the same way as atan2().
+      *
+      * Accurate to within 0.02 degrees.
+      *
+      * @param y The y component of the vector.
+      * @param x The x component of the vector.
+      *
+      * @return The angle, in centidegrees, in the range -18000..18000.
+      */
+    int32_t fixed_atan2(int32_t y, int32_t x);
+
+    /**
+      * Calculates the sine of the given angle.
+      *
+      * @param angle The angle, in centidegrees. Any value is accepted.
+      *
+      * @return The sine of the angle, as a Q14 fixed point value.
+      */
+    int32_t fixed_sin(int32_t angle);
+
+    /**
+      * Calculates the cosine of the given angle.
+      *
+      * @param angle The angle, in centidegrees. Any value is accepted.
+      *
+      * @return The cosine of the angle, as a Q14 fixed point value.
+      */
+    int32_t fixed_cos(int32_t angle);
+
+    /**
+      * Calculates the integer square root of the given value, rounded down.
+      *
+      * @param value The value to take the square root of.
+      *
+      * @return The largest integer whose square is less than or equal to value.
+      */
+    uint32_t fixed_sqrt(uint64_t value);
+}
+
+#endif
@@ -32,14 +32,26 @@ DEALINGS IN THE SOFTWARE.
 
 #include "CodalConfig.h"
 
+/**
+  * Defines a KeyValueTable called NAME from the given array of KeyValueTableEntry.
+  * The keys of PAIRS must be in strictly ascending order.
+  */
 #define CREATE_KEY_VALUE_TABLE(NAME, PAIRS) const KeyValueTable NAME { PAIRS, sizeof(PAIRS) / sizeof(KeyValueTableEntry) };
 
+/**
+  * As CREATE_KEY_VALUE_TABLE, but checks at compile time that the keys are in strictly ascending order.
+  * PAIRS must be declared constexpr.
+  */
+#define CREATE_CHECKED_KEY_VALUE_TABLE(NAME, PAIRS) \
+    static_assert(codal::KeyValueTable::isSorted(PAIRS, sizeof(PAIRS) / sizeof(KeyValueTableEntry)), #PAIRS " keys must be in ascending order"); \
+    constexpr KeyValueTable NAME { PAIRS, sizeof(PAIRS) / sizeof(KeyValueTableEntry) };
+
 namespace codal
 {
     /**
      * Provides a simple key/value pair lookup table with range lookup support.
-     * Normally stored in FLASH to reduce RAM usage. Keys should be pre-sorted
-     * in ascending order.
+     * Normally stored in FLASH to reduce RAM usage. Keys must be pre-sorted
+     * in ascending order, which allows lookups to use a binary search.
      */
 
     struct KeyValueTableEntry
@@ -53,10 +65,51 @@ namespace codal
         const KeyValueTableEntry *data;
         const int length;
 
+        /**
+         * Finds the entry with the smallest key greater than or equal to the given key.
+         *
+         * @param key The key to look up.
+         *
+         * @return The matching entry, or the entry with the largest key if the given key exceeds all keys in the table.
+         */
         KeyValueTableEntry* find(const uint32_t key) const;
+
+        /**
+         * Finds the entry with the given value. This performs a linear search, as values need not be ordered.
+         *
+         * @param value The value to look up.
+         *
+         * @return The first entry holding the given value, or NULL if there is none.
+         */
+        KeyValueTableEntry* findValue(const uint32_t value) const;
+
         uint32_t get(const uint32_t key) const;
         uint32_t getKey(const uint32_t key) const;
         bool hasKey(const uint32_t key) const;
+
+        /**
+         * Performs a reverse lookup, mapping a value (e.g. a register setting) back to its nominal key.
+         *
+         * @param value The value to look up.
+         * @param defaultKey The key to return if the value is not present in the table. Defaults to 0.
+         *
+         * @return The key of the first entry holding the given value, or defaultKey.
+         */
+        uint32_t getKeyForValue(const uint32_t value, const uint32_t defaultKey = 0) const;
+
+        /**
+         * Determines if the given entries are in strictly ascending key order.
+         * Evaluated at compile time by CREATE_CHECKED_KEY_VALUE_TABLE.
+         *
+         * @param entries The entries to check.
+         * @param length The number of entries.
+         *
+         * @return true if the keys are sorted, false otherwise.
+         */
+        static constexpr bool isSorted(const KeyValueTableEntry *entries, int length)
+        {
+            return length < 2 || (entries[0].key < entries[1].key && isSorted(entries + 1, length - 1));
+        }
     };
 
 }
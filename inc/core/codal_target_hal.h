@@ -92,6 +92,37 @@ extern "C"
      */
     short unsigned int __sync_fetch_and_add_2 (volatile void *ptr, short unsigned int value);
 
+    /**
+     * Default implementation of atomic compare and swap operation.
+     * GCC provides this where possible, but this is not supported on some CPU architectures...
+     *
+     * @param ptr pointer to the memory to access.
+     * @param oldval the value the memory location is expected to hold.
+     * @param newval the value to store, if the memory location holds oldval.
+     * @return true if newval was stored, false otherwise.
+     */
+    bool __sync_bool_compare_and_swap_4 (volatile void *ptr, unsigned int oldval, unsigned int newval);
+
+    /**
+     * Default implementation of 32 bit atomic fetch and add operation.
+     * GCC provides this where possible, but this is not supported on some CPU architectures...
+     *
+     * @param ptr pointer to the memory to access.
+     * @param value the value to add to the memory location.
+     * @return the value of the memory location BEFORE the add operation took place.
+     */
+    unsigned int __sync_fetch_and_add_4 (volatile void *ptr, unsigned int value);
+
+    /**
+     * Default implementation of 32 bit atomic fetch and bitwise and operation.
+     * GCC provides this where possible, but this is not supported on some CPU architectures...
+     *
+     * @param ptr pointer to the memory to access.
+     * @param value the value to combine with the memory location.
+     * @return the value of the memory location BEFORE the operation took place.
+     */
+    unsigned int __sync_fetch_and_and_4 (volatile void *ptr, unsigned int value);
+
 }
 
 // This is re-defined in targets with external flash, that require certain functions to be placed in RAM
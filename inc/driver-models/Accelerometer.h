@@ -30,6 +30,7 @@ DEALINGS IN THE SOFTWARE.
 #include "Pin.h"
 #include "CoordinateSystem.h"
 #include "CodalUtil.h"
+#include "Sample3DSource.h"
 
 /**
   * Status flags
@@ -81,6 +82,13 @@ DEALINGS IN THE SOFTWARE.
 #define ACCELEROMETER_8G_THRESHOLD                 ((uint32_t)ACCELEROMETER_8G_TOLERANCE * (uint32_t)ACCELEROMETER_8G_TOLERANCE)
 #define ACCELEROMETER_SHAKE_COUNT_THRESHOLD        4
 
+/**
+  * The largest number of samples that may be delivered in a single batch (typically the depth of a hardware FIFO).
+  */
+#ifndef ACCELEROMETER_MAX_BATCH_SIZE
+#define ACCELEROMETER_MAX_BATCH_SIZE               32
+#endif
+
 namespace codal
 {
     struct ShakeHistory
@@ -107,6 +115,7 @@ namespace codal
 
         uint16_t        samplePeriod;       // The time between samples, in milliseconds.
         uint8_t         sampleRange;        // The sample range of the accelerometer in g.
+        uint8_t         batchSize;          // The number of samples buffered by the hardware before they are delivered to the model.
         Sample3D        sample;             // The last sample read, in the coordinate system specified by the coordinateSpace variable.
         Sample3D        sampleENU;          // The last sample read, in raw ENU format (stored in case requests are made for data in other coordinate spaces)
         CoordinateSpace &coordinateSpace;   // The coordinate space transform (if any) to apply to the raw data from the hardware.
@@ -119,6 +128,7 @@ namespace codal
         uint16_t        lastGesture;        // the last, stable gesture recorded.
         uint16_t        currentGesture;     // the instantaneous, unfiltered gesture detected.
         ShakeHistory    shake;              // State information needed to detect shake events.
+        Sample3DSource  *stream;            // The DataSource streaming our samples, if one has been requested.
 
         public:
 
@@ -173,6 +183,27 @@ namespace codal
           */
         virtual int getRange();
 
+        /**
+          * Attempts to configure the accelerometer to buffer the given number of samples in hardware (typically
+          * a FIFO) before delivering them to this model as a single batch. This trades latency for a large
+          * reduction in bus transactions and events when sampling at high rates.
+          *
+          * @param samples The requested number of samples per batch. A value of 1 disables batching.
+          *
+          * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the request fails, or DEVICE_NOT_SUPPORTED
+          * if the hardware has no FIFO.
+          *
+          * @note This method should be overriden (if supported) by specific accelerometer device drivers.
+          */
+        virtual int setBatchSize(int samples);
+
+        /**
+          * Reads the currently configured batch size of the accelerometer.
+          *
+          * @return The number of samples delivered per batch.
+          */
+        int getBatchSize();
+
         /**
          * Configures the accelerometer for G range and sample rate defined
          * in this object. The nearest values are chosen to those defined
@@ -213,6 +244,27 @@ namespace codal
          */
         virtual int update();
 
+        /**
+         * Stores a batch of samples from the accelerometer sensor, and performs gesture tracking over every sample
+         * in the batch. A single ACCELEROMETER_EVT_DATA_UPDATE event is raised for the whole batch, and the last
+         * sample becomes the current sample.
+         *
+         * @param samples The samples read, in raw ENU format and in the order they were taken.
+         * @param length The number of samples provided.
+         *
+         * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if no samples are provided.
+         */
+        int updateBatch(Sample3D *samples, int length);
+
+        /**
+          * Provides a DataSource that streams every sample from this accelerometer as ManagedBuffers of
+          * interleaved 16 bit signed X,Y,Z triples (DATASTREAM_FORMAT_16BIT_SIGNED_XYZ), in the coordinate
+          * system defined in the constructor. The DataSource is created on first use.
+          *
+          * @return The DataSource for this accelerometer.
+          */
+        Sample3DSource& getDataSource();
+
         /**
           * Reads the last accelerometer value stored, and provides it in the coordinate system requested.
           *
@@ -48,6 +48,7 @@ DEALINGS IN THE SOFTWARE.
 #define USB_STRING_DESCRIPTOR_TYPE 3
 #define USB_INTERFACE_DESCRIPTOR_TYPE 4
 #define USB_ENDPOINT_DESCRIPTOR_TYPE 5
+#define USB_INTERFACE_ASSOCIATION_DESCRIPTOR_TYPE 11
 #define USB_BOS_DESCRIPTOR_TYPE 15
 
 #define USB_REQ_HOSTTODEVICE 0x00
@@ -135,6 +136,19 @@ typedef struct
     uint8_t iInterface;
 } __attribute__((packed)) InterfaceDescriptor;
 
+//    Interface Association
+typedef struct
+{
+    uint8_t len;   // 8
+    uint8_t dtype; // 11 USB_INTERFACE_ASSOCIATION_DESCRIPTOR_TYPE
+    uint8_t firstInterface;
+    uint8_t interfaceCount;
+    uint8_t functionClass;
+    uint8_t functionSubClass;
+    uint8_t functionProtocol;
+    uint8_t iFunction;
+} __attribute__((packed)) InterfaceAssociationDescriptor;
+
 typedef struct
 {
     uint8_t numEndpoints;
@@ -261,6 +275,9 @@ public:
     virtual int stdRequest(UsbEndpointIn &ctrl, USBSetup &setup) { return DEVICE_NOT_SUPPORTED; }
     virtual int endpointRequest() { return DEVICE_NOT_SUPPORTED; }
     virtual const InterfaceInfo *getInterfaceInfo() { return NULL; }
+    // interfaces that form a function together with the ones added after them (eg CDC) fill in an
+    // association descriptor, that is sent ahead of their interface descriptor
+    virtual int getAssociation(InterfaceAssociationDescriptor *desc) { return DEVICE_NOT_SUPPORTED; }
     void fillInterfaceInfo(InterfaceDescriptor *desc);
     virtual bool enableWebUSB() { return false; }
 };
@@ -31,6 +31,7 @@ DEALINGS IN THE SOFTWARE.
 #include "CoordinateSystem.h"
 #include "CodalUtil.h"
 #include "Accelerometer.h"
+#include "Sample3DSource.h"
 
 
 /**
@@ -77,6 +78,7 @@ namespace codal
         Sample3D              sampleENU;          // The last sample read, in raw ENU format (stored in case requests are made for data in other coordinate spaces)
         CoordinateSpace       &coordinateSpace;   // The coordinate space transform (if any) to apply to the raw data from the hardware.
         Accelerometer*        accelerometer;      // The accelerometer to use for tilt compensation.
+        Sample3DSource*       stream;             // The DataSource streaming our samples, if one has been requested.
 
         public:
 
@@ -244,6 +246,15 @@ namespace codal
          */
         virtual int update();
 
+        /**
+          * Provides a DataSource that streams every sample from this compass as ManagedBuffers of
+          * interleaved 16 bit signed X,Y,Z triples (DATASTREAM_FORMAT_16BIT_SIGNED_XYZ), in the coordinate
+          * system defined in the constructor. The DataSource is created on first use.
+          *
+          * @return The DataSource for this compass.
+          */
+        Sample3DSource& getDataSource();
+
         /**
           * Reads the last compass value stored, and provides it in the coordinate system requested.
           *
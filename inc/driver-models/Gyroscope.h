@@ -31,6 +31,7 @@ DEALINGS IN THE SOFTWARE.
 #include "Pin.h"
 #include "CoordinateSystem.h"
 #include "CodalUtil.h"
+#include "Sample3DSource.h"
 
 /**
   * Status flags
@@ -57,6 +58,7 @@ namespace codal
         Sample3D        sample;             // The last sample read, in the coordinate system specified by the coordinateSpace variable.
         Sample3D        sampleENU;          // The last sample read, in raw ENU format (stored in case requests are made for data in other coordinate spaces)
         CoordinateSpace &coordinateSpace;   // The coordinate space transform (if any) to apply to the raw data from the hardware.
+        Sample3DSource  *stream;            // The DataSource streaming our samples, if one has been requested.
 
         public:
 
@@ -151,6 +153,15 @@ namespace codal
          */
         virtual int update(Sample3D s);
 
+        /**
+          * Provides a DataSource that streams every sample from this gyroscope as ManagedBuffers of
+          * interleaved 16 bit signed X,Y,Z triples (DATASTREAM_FORMAT_16BIT_SIGNED_XYZ), in the coordinate
+          * system defined in the constructor. The DataSource is created on first use.
+          *
+          * @return The DataSource for this gyroscope.
+          */
+        Sample3DSource& getDataSource();
+
         /**
           * Reads the last gyroscope value stored, and provides it in the coordinate system requested.
           *
@@ -29,6 +29,17 @@ DEALINGS IN THE SOFTWARE.
 #include "ErrorNo.h"
 #include "Pin.h"
 
+/**
+  * I2CTransaction flags
+  */
+#define I2C_TRANSACTION_FLAG_REGISTER           0x01    // Write the reg byte before any txBuffer data.
+#define I2C_TRANSACTION_FLAG_REPEATED_START     0x02    // Use a repeated START (rather than STOP/START) between the write and read phases.
+
+// Register writes of up to this many data bytes are assembled on the stack, rather than in a heap allocated buffer.
+#ifndef I2C_REGISTER_WRITE_BUFFER_SIZE
+#define I2C_REGISTER_WRITE_BUFFER_SIZE          16
+#endif
+
 namespace codal
 {
 /**
@@ -37,8 +48,51 @@ namespace codal
 
 enum AcknowledgeType {ACK, NACK};
 
+typedef void (*PVoidCallback)(void *);
+
+/**
+  * Describes a single I2C transaction, consisting of an optional write phase followed by an optional read phase.
+  *
+  * Transactions are queued by I2C::submit() and executed in order. The descriptor and its buffers must remain
+  * valid until the transaction completes.
+  */
+struct I2CTransaction
+{
+    I2CTransaction  *next;              // Used internally to queue transactions.
+    uint16_t        address;            // The 8 bit I2C address of the device.
+    uint8_t         reg;                // The register to address, if I2C_TRANSACTION_FLAG_REGISTER is set.
+    uint8_t         flags;              // I2C_TRANSACTION_FLAG_* values.
+    const uint8_t   *txBuffer;          // Data to write, or NULL.
+    uint32_t        txSize;             // The number of bytes to write.
+    uint8_t         *rxBuffer;          // Buffer to read into, or NULL.
+    uint32_t        rxSize;             // The number of bytes to read.
+    PVoidCallback   doneHandler;        // Called on completion (possibly in IRQ context), or NULL.
+    void            *arg;               // Parameter passed to doneHandler.
+    volatile int    result;             // DEVICE_BUSY whilst pending, then the result of the transaction.
+
+    I2CTransaction()
+    {
+        next = NULL;
+        address = 0;
+        reg = 0;
+        flags = I2C_TRANSACTION_FLAG_REPEATED_START;
+        txBuffer = NULL;
+        txSize = 0;
+        rxBuffer = NULL;
+        rxSize = 0;
+        doneHandler = NULL;
+        arg = NULL;
+        result = DEVICE_OK;
+    }
+};
+
 class I2C
 {
+    I2CTransaction          *queueHead;     // Transactions awaiting the bus, in order of submission.
+    I2CTransaction          *queueTail;     // The last transaction in the queue.
+    I2CTransaction *volatile active;        // The transaction currently on the bus, or NULL.
+    volatile bool           dispatching;    // Set whilst the queue is being serviced.
+
 public:
     I2C(Pin &sda, Pin &scl);
 
@@ -79,7 +133,65 @@ protected:
     */
     virtual int read(AcknowledgeType ack = ACK);
 
+    /**
+      * Performs the given transaction on the bus, blocking until it is complete.
+      *
+      * This is the bulk transfer hook used by the transaction queue. The default implementation issues the
+      * transaction through write() and read(). Drivers for hardware able to perform a complete write/read
+      * sequence in one operation should override this method.
+      *
+      * @param t The transaction to perform.
+      * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the transaction failed.
+      */
+    virtual int transfer(I2CTransaction *t);
+
+    /**
+      * Starts the given transaction on the bus. transferComplete() must be called once it has finished.
+      *
+      * The default implementation calls transfer(), and completes the transaction immediately.
+      * Drivers for DMA or interrupt driven hardware should override this method to start the transaction and return
+      * straight away, calling transferComplete() from their interrupt handler.
+      *
+      * @param t The transaction to start.
+      * @return DEVICE_OK on success, or an error code if the transaction could not be started.
+      */
+    virtual int startTransfer(I2CTransaction *t);
+
+    /**
+      * Records the completion of the transaction currently on the bus, notifies its owner, and starts the next
+      * queued transaction (if any).
+      *
+      * @param t The transaction that has completed.
+      * @param result The result of the transaction.
+      */
+    void transferComplete(I2CTransaction *t, int result);
+
+    /**
+      * Starts queued transactions until the queue is empty or a transaction is in progress.
+      */
+    void dispatch();
+
 public:
+    /**
+      * Queues the given transaction for execution, and returns immediately.
+      *
+      * Transactions are executed in the order they are submitted. On completion, the result is stored in the
+      * transaction and its doneHandler (if any) is called, possibly in IRQ context.
+      *
+      * @param t The transaction to queue. This must remain valid until the transaction completes.
+      * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the transaction is malformed.
+      */
+    int submit(I2CTransaction *t);
+
+    /**
+      * Queues the given transaction for execution, and blocks the calling fiber until it is complete.
+      * Any doneHandler set on the transaction is replaced.
+      *
+      * @param t The transaction to perform.
+      * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if the transaction is malformed, or DEVICE_I2C_ERROR if the transaction failed.
+      */
+    int transact(I2CTransaction *t);
+
     /**
       * Issues a standard, 2 byte I2C command write to the I2C bus.
       * This consists of:
@@ -383,6 +383,38 @@ namespace codal
             return DEVICE_NOT_IMPLEMENTED;
         }
 
+        /**
+          * Identifies the GPIO port this pin belongs to. Pins that share a port can be sampled together
+          * with a single call to readPort(), which is much faster than reading each pin in turn.
+          *
+          * @return a platform specific port number, or DEVICE_NOT_SUPPORTED if this pin cannot be read as part of a port.
+          */
+        virtual int getPort()
+        {
+            return DEVICE_NOT_SUPPORTED;
+        }
+
+        /**
+          * Determines which bit of the value returned by readPort() represents this pin.
+          *
+          * @return the bit mask of this pin within its port, or 0 if port reads are not supported.
+          */
+        virtual uint32_t getPortMask()
+        {
+            return 0;
+        }
+
+        /**
+          * Reads the digital input level of every pin on the port this pin belongs to, in a single operation.
+          * Pins are not reconfigured, so each pin of interest should already be a digital input.
+          *
+          * @return the input levels of the port, as a bit field indexed by getPortMask(), or 0 if port reads are not supported.
+          */
+        virtual uint32_t readPort()
+        {
+            return 0;
+        }
+
         virtual int setIRQ(void (*gpio_interrupt)(int))
         {
             this->gpio_irq = gpio_interrupt;
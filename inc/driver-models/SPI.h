@@ -28,20 +28,79 @@ DEALINGS IN THE SOFTWARE.
 #include "CodalConfig.h"
 #include "ErrorNo.h"
 #include "Pin.h"
+#include "CodalFiber.h"
+
+// The maximum number of transfers that may be queued by startTransfer() at any one time.
+#ifndef SPI_TRANSFER_QUEUE_SIZE
+#define SPI_TRANSFER_QUEUE_SIZE     4
+#endif
 
 namespace codal
 {
-// TODO there should be some locking mechanism here
 
 typedef void (*PVoidCallback)(void *);
 
+/**
+ * Describes a single transfer queued by startTransfer().
+ */
+struct SPITransfer
+{
+    const uint8_t   *txBuffer;
+    uint32_t        txSize;
+    uint8_t         *rxBuffer;
+    uint32_t        rxSize;
+    PVoidCallback   doneHandler;
+    void            *arg;
+};
 
 /**
  * Class definition for an SPI interface.
  */
 class SPI
 {
+    SPITransfer     queue[SPI_TRANSFER_QUEUE_SIZE];     // Transfers queued by startTransfer(). The head is the transfer in progress.
+    uint8_t         queueHead;                          // Index of the oldest queued transfer.
+    volatile uint8_t queueLength;                       // Number of queued transfers.
+    volatile bool   active;                             // Set whilst the transfer at the head of the queue is on the bus.
+    volatile bool   dispatching;                        // Set whilst the queue is being serviced.
+
+    FiberLock       busLock;                            // Held by the device currently using the bus.
+    const void      *busOwner;                          // The device that last configured the bus.
+
+protected:
+    /**
+     * Starts the given queued transfer. transferComplete() must be called once it has finished.
+     *
+     * The default implementation calls transfer(), and then completes the transfer straight away, from the same
+     * context. It yields to other fibers first, so that a doneHandler that starts another transfer (as ST7735 does
+     * for each chunk of a frame) does not hold the processor for the whole chain. It must therefore be called from
+     * fiber context. Drivers for DMA or interrupt driven hardware should override this method to start the transfer
+     * and return straight away, calling transferComplete() from their interrupt handler.
+     *
+     * @param t The transfer to start.
+     * @return DEVICE_OK on success, or an error code if the transfer failed or could not be started, in which case
+     * the caller completes it.
+     */
+    virtual int beginTransfer(SPITransfer *t);
+
+    /**
+     * Records the completion of the transfer currently on the bus, calls its doneHandler, and starts the
+     * next queued transfer (if any).
+     */
+    void transferComplete();
+
+    /**
+     * Starts queued transfers until the queue is empty or a transfer is in progress.
+     *
+     * @return The result of the first transfer started, or DEVICE_OK if none was started.
+     */
+    int dispatch();
+
 public:
+    /**
+     * Constructor.
+     */
+    SPI();
     /** Set the frequency of the SPI interface
      *
      * @param frequency The bus frequency in hertz
@@ -77,6 +136,9 @@ public:
     /**
      * Writes and reads from the SPI bus concurrently. Waits (possibly un-scheduled) for transfer to finish.
      *
+     * The default implementation calls write() for each byte. Drivers for hardware with a FIFO or DMA should
+     * override it to move the whole block at once.
+     *
      * Either buffer can be NULL.
      */
     virtual int transfer(const uint8_t *txBuffer, uint32_t txSize, uint8_t *rxBuffer,
@@ -85,11 +147,41 @@ public:
     /**
      * Writes and reads from the SPI bus concurrently. Finally, calls doneHandler (possibly in IRQ context).
      *
+     * Transfers are queued and performed in order. A doneHandler may safely start another transfer,
+     * which is performed once the handler returns. Completion is delivered from the context that finishes
+     * the transfer (see beginTransfer()), so no fiber is created.
+     *
+     * At most SPI_TRANSFER_QUEUE_SIZE transfers may be queued at once. If the queue is full, the transfer
+     * is not queued and doneHandler will not be called.
+     *
+     * When the bus is shared, callers must hold it (see acquire()) until doneHandler has been called.
+     *
      * Either buffer can be NULL.
+     *
+     * @return DEVICE_OK on success, DEVICE_NO_RESOURCES if SPI_TRANSFER_QUEUE_SIZE transfers are already queued, or
+     * the error returned by beginTransfer() if the transfer was started straight away and failed.
      */
     virtual int startTransfer(const uint8_t *txBuffer, uint32_t txSize, uint8_t *rxBuffer,
                          uint32_t rxSize, PVoidCallback doneHandler, void *arg);
-    
+
+    /**
+     * Gains exclusive use of the bus, blocking the calling fiber until any other device has released it.
+     * Used to share a bus between several devices with their own chip selects (see SPIDevice).
+     *
+     * @param owner An identifier for the device requesting the bus.
+     * @return 1 if another device has used the bus since the given owner last held it (so the frequency and mode
+     * must be reapplied), or 0 otherwise.
+     */
+    int acquire(const void *owner);
+
+    /**
+     * Releases the bus after a call to acquire(), allowing the next waiting device to use it.
+     *
+     * @param reconfigure If set, the next device to acquire the bus will be told to reapply its settings,
+     * even if it was the last owner. Defaults to false.
+     */
+    void release(bool reconfigure = false);
+
     virtual ~SPI() {}
 };
 }
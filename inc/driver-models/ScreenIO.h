@@ -36,6 +36,18 @@ public:
     virtual void send(const void *txBuffer, uint32_t txSize) = 0;
     virtual void startSend(const void *txBuffer, uint32_t txSize, PVoidCallback doneHandler,
                            void *handlerArg) = 0;
+
+    /**
+     * Gains exclusive use of the underlying bus, if it is shared with other devices.
+     * Blocks the calling fiber until the bus is available. The default implementation does nothing.
+     */
+    virtual void acquire() {}
+
+    /**
+     * Releases the bus after a call to acquire(). May be called once the last startSend() has completed.
+     * The default implementation does nothing.
+     */
+    virtual void release() {}
 };
 
 } // namespace codal
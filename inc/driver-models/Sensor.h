@@ -46,10 +46,16 @@ DEALINGS IN THE SOFTWARE.
 #define SENSOR_LOW_THRESHOLD_PASSED 0x04
 #define SENSOR_LOW_THRESHOLD_ENABLED 0x08
 #define SENSOR_HIGH_THRESHOLD_ENABLED 0x10
+#define SENSOR_ADAPTIVE_ENABLED 0x20
 
 #define SENSOR_DEFAULT_SENSITIVITY 868
 #define SENSOR_DEFAULT_SAMPLE_PERIOD 500
 
+// The change in value between consecutive samples (in sensor units) above which an adaptive sensor speeds up.
+#ifndef SENSOR_ADAPTIVE_DEFAULT_DELTA
+#define SENSOR_ADAPTIVE_DEFAULT_DELTA 4
+#endif
+
 namespace codal
 {
     /**
@@ -64,6 +70,9 @@ namespace codal
         uint16_t highThreshold;      // threshold at which a HIGH event is generated
         uint16_t lowThreshold;       // threshold at which a LOW event is generated
         uint16_t sensorValue;        // Last sampled data.
+        uint16_t minPeriod;          // The shortest time between samples when adaptive sampling, in milliseconds.
+        uint16_t maxPeriod;          // The longest time between samples when adaptive sampling, in milliseconds.
+        uint16_t adaptiveDelta;      // The change between samples above which an adaptive sensor speeds up.
 
         public:
 
@@ -98,6 +107,7 @@ namespace codal
 
         /**
           * Set the automatic sample period of the accelerometer to the specified value (in ms).
+          * This disables adaptive sampling, if enabled.
           *
           * @param period the requested time between samples, in milliseconds.
           *
@@ -105,6 +115,26 @@ namespace codal
           */
         int setPeriod(int period);
 
+        /**
+          * Enables adaptive sampling. The sample period is halved (down to minPeriod) whenever the value changes
+          * by at least delta between samples, or is close enough to an enabled threshold that it could cross it
+          * before the next sample. Otherwise, the period grows gradually back towards maxPeriod.
+          *
+          * @param minPeriod the shortest time between samples, in milliseconds.
+          * @param maxPeriod the longest time between samples, in milliseconds.
+          * @param delta the change in value between samples that is considered significant. Defaults to SENSOR_ADAPTIVE_DEFAULT_DELTA.
+          *
+          * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if minPeriod is not positive or exceeds maxPeriod.
+          */
+        int setAdaptivePeriod(int minPeriod, int maxPeriod, uint16_t delta = SENSOR_ADAPTIVE_DEFAULT_DELTA);
+
+        /**
+          * Determines if adaptive sampling is enabled.
+          *
+          * @return true if the sample period adapts to the signal, false if it is fixed.
+          */
+        bool isAdaptive();
+
         /**
           * Reads the currently configured sample period.
           *
@@ -165,6 +195,18 @@ namespace codal
          */
         void checkThresholding();
 
+        /**
+         * Adjust the sample period based on the most recent change in value, and its proximity to any thresholds.
+         *
+         * @param previousValue the value of the sensor before the most recent sample was taken.
+         */
+        void adaptSamplePeriod(uint16_t previousValue);
+
+        /**
+         * (Re)schedule the periodic timer event that drives sampling, using the current samplePeriod.
+         */
+        void scheduleSample();
+
         /**
          * Read the value from underlying hardware.
          */
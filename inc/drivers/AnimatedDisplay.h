@@ -27,6 +27,7 @@ DEALINGS IN THE SOFTWARE.
 
 #include "Display.h"
 #include "BitmapFont.h"
+#include "ManagedBuffer.h"
 
 /**
   * Event codes raised by a Display
@@ -106,14 +107,14 @@ namespace codal
         // State for scrollString() method.
         // This is a surprisingly intricate method.
         //
-        // The text being displayed.
-        ManagedString scrollingText;
+        // The text being displayed, pre-rendered as packed columns of pixels.
+        ManagedBuffer scrollingStrip;
 
-        // The index of the character currently being displayed.
-        int16_t scrollingChar;
+        // The number of bytes used to hold each column of scrollingStrip.
+        uint8_t scrollingStripStride;
 
-        // The number of pixels the current character has been shifted on the display.
-        int8_t scrollingPosition;
+        // The number of pixels the strip has been shifted onto the display.
+        int scrollingPosition;
 
         //
         // State for printString() method.
@@ -151,9 +152,16 @@ namespace codal
         void animationUpdate();
 
 
+        /**
+         * Lays out the given string as a strip of packed pixel columns, ready to be scrolled.
+         *
+         * @param s The string to render.
+         */
+        void renderScrollStrip(ManagedString s);
+
         /**
          * Internal scrollText update method.
-         * Shift the screen image by one pixel to the left. If necessary, paste in the next char.
+         * Shift the screen left, pasting the next column of the pre-rendered text strip into the right hand edge.
          */
         void updateScrollText();
 
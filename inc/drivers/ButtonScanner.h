@@ -0,0 +1,162 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef CODAL_BUTTON_SCANNER_H
+#define CODAL_BUTTON_SCANNER_H
+
+#include "CodalConfig.h"
+#include "CodalComponent.h"
+#include "AbstractButton.h"
+#include "Event.h"
+#include "Pin.h"
+
+// The maximum number of buttons (including every key of a matrix) that a single scanner can service.
+#define BUTTON_SCANNER_MAX_BUTTONS          32
+
+// The maximum number of row and column pins in a keypad matrix.
+#ifndef BUTTON_SCANNER_MAX_MATRIX_PINS
+#define BUTTON_SCANNER_MAX_MATRIX_PINS      8
+#endif
+
+// The time allowed for the columns of a keypad matrix to settle after a row is driven, in microseconds.
+#ifndef BUTTON_SCANNER_SETTLE_TIME
+#define BUTTON_SCANNER_SETTLE_TIME          2
+#endif
+
+namespace codal
+{
+    /**
+     * Class definition for ButtonScanner.
+     *
+     * Services a bank of buttons and/or a keypad matrix from a single periodic callback, rather than one
+     * Button component per pin. All inputs are sampled in one pass (using a single port read where pins
+     * share a GPIO port), and every button is debounced at once using a two bit vertical counter, so a
+     * change of state is accepted after four consecutive matching samples.
+     *
+     * Each button raises the same events as a Button with the id it was given (DEVICE_BUTTON_EVT_DOWN,
+     * DEVICE_BUTTON_EVT_UP, DEVICE_BUTTON_EVT_CLICK, DEVICE_BUTTON_EVT_LONG_CLICK and DEVICE_BUTTON_EVT_HOLD),
+     * so existing listeners and MultiButton work unchanged.
+     */
+    class ButtonScanner : public CodalComponent
+    {
+        Pin             *pins[BUTTON_SCANNER_MAX_BUTTONS];          // The pin of each directly connected button.
+        uint32_t        portMask[BUTTON_SCANNER_MAX_BUTTONS];       // The bit of each direct button's pin within a port read, or 0 if read individually.
+        uint32_t        columnMask[BUTTON_SCANNER_MAX_MATRIX_PINS]; // The bit of each matrix column within a port read, or 0 if read individually.
+        Pin             *portPin;                                   // The pin used to read all port-grouped inputs at once, if any.
+
+        Pin             *rows[BUTTON_SCANNER_MAX_MATRIX_PINS];      // The matrix row pins, driven low in turn.
+        Pin             *columns[BUTTON_SCANNER_MAX_MATRIX_PINS];   // The matrix column pins, read with pull ups enabled.
+        uint8_t         rowCount;
+        uint8_t         columnCount;
+
+        uint16_t        ids[BUTTON_SCANNER_MAX_BUTTONS];            // The event id of each button.
+        unsigned long   downStartTime[BUTTON_SCANNER_MAX_BUTTONS];  // The time at which each button was last pressed.
+        uint8_t         buttonCount;                                // The number of buttons, including every key of the matrix.
+        uint8_t         matrixStart;                                // The index of the first matrix key.
+
+        uint32_t        activeHigh;                                 // Direct buttons that are pressed when their pin is high.
+        uint32_t        allEvents;                                  // Buttons configured for DEVICE_BUTTON_ALL_EVENTS.
+        uint32_t        state;                                      // The debounced state of every button, 1 = pressed.
+        uint32_t        count0;                                     // Bit 0 of each button's vertical debounce counter.
+        uint32_t        count1;                                     // Bit 1 of each button's vertical debounce counter.
+        uint32_t        holdTriggered;                              // Buttons that have already raised DEVICE_BUTTON_EVT_HOLD.
+
+        /**
+         * Includes the given pin in the port group if possible.
+         *
+         * @return the bit of the pin within a port read, or 0 if it must be read individually.
+         */
+        uint32_t groupPin(Pin *pin);
+
+        /**
+         * Samples every button once.
+         *
+         * @return a bit mask with bit n set if button n is instantaneously pressed.
+         */
+        uint32_t sample();
+
+        public:
+
+        /**
+         * Constructor.
+         *
+         * @param id The id of this component. Defaults to DEVICE_ID_BUTTON_SCANNER. Events are raised using the id of each button.
+         */
+        ButtonScanner(uint16_t id = DEVICE_ID_BUTTON_SCANNER);
+
+        /**
+         * Adds a button connected directly to a pin.
+         *
+         * @param pin The pin the button is connected to.
+         * @param id The id used for events raised by this button.
+         * @param eventConfiguration The events to raise. Defaults to DEVICE_BUTTON_ALL_EVENTS.
+         * @param polarity Whether the button is pressed when the pin is high or low. Defaults to ACTIVE_LOW.
+         * @param mode The pull to apply to the pin. Defaults to PullMode::None.
+         *
+         * @return the index of the button on success, or DEVICE_NO_RESOURCES if the scanner is full.
+         */
+        int addButton(Pin &pin, uint16_t id, ButtonEventConfiguration eventConfiguration = DEVICE_BUTTON_ALL_EVENTS, ButtonPolarity polarity = ACTIVE_LOW, PullMode mode = PullMode::None);
+
+        /**
+         * Adds a keypad matrix. Each row is driven low in turn, and the columns (which have pull ups enabled) read
+         * to determine which keys in that row are pressed. Diodes are needed on each key to avoid ghosting if
+         * several keys may be pressed at once.
+         *
+         * @param rows The row pins.
+         * @param rowCount The number of row pins.
+         * @param columns The column pins.
+         * @param columnCount The number of column pins.
+         * @param ids The event id of each key, in row major order (rowCount * columnCount entries).
+         * @param eventConfiguration The events to raise. Defaults to DEVICE_BUTTON_ALL_EVENTS.
+         *
+         * @return DEVICE_OK on success, DEVICE_INVALID_STATE if a matrix has already been added,
+         *         DEVICE_INVALID_PARAMETER if there are too many rows or columns, or DEVICE_NO_RESOURCES if the scanner is full.
+         */
+        int addMatrix(Pin **rows, int rowCount, Pin **columns, int columnCount, const uint16_t *ids, ButtonEventConfiguration eventConfiguration = DEVICE_BUTTON_ALL_EVENTS);
+
+        /**
+         * Tests if the button with the given id is currently pressed.
+         *
+         * @param id The event id of the button.
+         *
+         * @return 1 if the button is pressed, 0 if not, or DEVICE_INVALID_PARAMETER if no button has the given id.
+         */
+        int isPressed(uint16_t id);
+
+        /**
+         * Determines the debounced state of every button.
+         *
+         * @return a bit mask with bit n set if button n is pressed, in the order buttons were added.
+         */
+        uint32_t getState();
+
+        /**
+         * Periodic callback from the system timer. Samples and debounces all buttons, and raises any events.
+         */
+        virtual void periodicCallback();
+    };
+}
+
+#endif
@@ -0,0 +1,221 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef CODAL_EDGE_CAPTURE_H
+#define CODAL_EDGE_CAPTURE_H
+
+#include "CodalConfig.h"
+#include "CodalComponent.h"
+#include "DataStream.h"
+#include "Event.h"
+#include "Pin.h"
+
+// The number of edges that can be held between the pin IRQ and the fiber that processes them. Must be a power of two.
+#ifndef EDGE_CAPTURE_BUFFER_SIZE
+#define EDGE_CAPTURE_BUFFER_SIZE            64
+#endif
+
+// The maximum number of decoders that can be attached to a single EdgeCapture.
+#ifndef EDGE_CAPTURE_MAX_DECODERS
+#define EDGE_CAPTURE_MAX_DECODERS           4
+#endif
+
+// The maximum number of edges held for a connected DataSink.
+#ifndef EDGE_CAPTURE_STREAM_BUFFER_SIZE
+#define EDGE_CAPTURE_STREAM_BUFFER_SIZE     64
+#endif
+
+#define EDGE_CAPTURE_EVT_DATA               1   // Internal: edges are waiting to be processed.
+#define EDGE_CAPTURE_EVT_PULSE              2   // A complete high and low pulse has been measured.
+#define EDGE_CAPTURE_EVT_OVERFLOW           3   // Edges were dropped because the capture buffer was full.
+
+#define EDGE_CAPTURE_STATUS_ENABLED         0x01
+#define EDGE_CAPTURE_STATUS_PENDING         0x02
+#define EDGE_CAPTURE_STATUS_OVERFLOW        0x04
+#define EDGE_CAPTURE_STATUS_LISTENING       0x08
+
+/**
+ * Each captured edge is held as a 32 bit word, with the level of the pin after the edge in bit 0,
+ * and the time of the edge in microseconds (modulo 2^31) in bits 1..31.
+ */
+#define EDGE_CAPTURE_LEVEL(e)               ((e) & 1)
+#define EDGE_CAPTURE_TIME(e)                ((e) >> 1)
+#define EDGE_CAPTURE_ELAPSED(a, b)          (((uint32_t)(b) - (uint32_t)(a)) >> 1)
+
+namespace codal
+{
+    /**
+     * Interface for protocol decoders that interpret a sequence of edges captured by an EdgeCapture.
+     * Decoders are run in fiber context, so may take their time and raise events.
+     */
+    class EdgeDecoder
+    {
+        public:
+
+        /**
+         * Called for each captured edge, in order.
+         *
+         * @param level The level of the pin after the edge.
+         * @param duration The time the pin spent at the previous level, in microseconds.
+         */
+        virtual void decode(int level, uint32_t duration) = 0;
+    };
+
+    /**
+     * Class definition for EdgeCapture.
+     *
+     * Records the time of every rising and falling edge on a pin into a ring buffer from the pin IRQ,
+     * and processes the captured edges in batches in fiber context. This generalises PulseIn to capture
+     * whole edge sequences at a high rate, such as IR remote frames, ultrasonic echoes or PWM inputs.
+     *
+     * Pulse width, period and duty cycle are measured continuously, any attached EdgeDecoders are run
+     * over each edge, and the raw edges are available to a connected DataSink in the format described above.
+     */
+    class EdgeCapture : public CodalComponent, public DataSource
+    {
+        Pin             &pin;
+        uint32_t        buffer[EDGE_CAPTURE_BUFFER_SIZE];
+        volatile uint16_t head;
+        volatile uint16_t tail;
+        uint32_t        lastEdge;
+        bool            haveEdge;
+        uint32_t        highWidth;
+        uint32_t        lowWidth;
+        uint32_t        dropped;
+
+        EdgeDecoder     *decoders[EDGE_CAPTURE_MAX_DECODERS];
+
+        DataSink        *downstream;
+        ManagedBuffer   output;
+        int             outputLength;
+
+        /**
+         * Event handler called from the pin IRQ for each edge.
+         */
+        void onEdge(Event e);
+
+        /**
+         * Event handler that processes captured edges in fiber context.
+         */
+        void onData(Event e);
+
+        public:
+
+        /**
+         * Constructor.
+         *
+         * @param pin The pin to capture edges from.
+         * @param id The id to use for events raised by this component. Defaults to DEVICE_ID_EDGE_CAPTURE.
+         */
+        EdgeCapture(Pin &pin, uint16_t id = DEVICE_ID_EDGE_CAPTURE);
+
+        /**
+         * Begin capturing edges. The pin is configured as a digital input generating edge events.
+         *
+         * @return DEVICE_OK on success.
+         */
+        int enable();
+
+        /**
+         * Stop capturing edges, and turn off edge events on the pin. Edges already captured are still processed.
+         *
+         * @return DEVICE_OK on success.
+         */
+        int disable();
+
+        /**
+         * Attach a decoder, to be run over every captured edge.
+         *
+         * @param decoder The decoder to add.
+         *
+         * @return DEVICE_OK on success, or DEVICE_NO_RESOURCES if EDGE_CAPTURE_MAX_DECODERS are already attached.
+         */
+        int addDecoder(EdgeDecoder &decoder);
+
+        /**
+         * Detach a previously added decoder.
+         *
+         * @param decoder The decoder to remove.
+         *
+         * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the decoder was not attached.
+         */
+        int removeDecoder(EdgeDecoder &decoder);
+
+        /**
+         * Determines the width of the most recent high pulse.
+         *
+         * @return The width of the pulse in microseconds, or 0 if no pulse has been measured.
+         */
+        int getPulseWidth();
+
+        /**
+         * Determines the period of the most recent complete high and low pulse.
+         *
+         * @return The period in microseconds, or 0 if no pulse has been measured.
+         */
+        int getPeriod();
+
+        /**
+         * Determines the duty cycle of the most recent complete high and low pulse.
+         *
+         * @return The proportion of the period spent high, in tenths of a percent (0..1000), or 0 if no pulse has been measured.
+         */
+        int getDutyCycle();
+
+        /**
+         * Determines the number of edges lost because the capture buffer was full.
+         *
+         * @return The number of edges dropped since the last call to this method.
+         */
+        int getDropped();
+
+        /**
+         * Provide the next available buffer of captured edges to a connected DataSink.
+         */
+        virtual ManagedBuffer pull();
+
+        /**
+         * Connect a DataSink, which will be passed captured edges as they are processed.
+         */
+        virtual void connect(DataSink &sink);
+
+        /**
+         * Disconnect the DataSink, if any.
+         */
+        virtual void disconnect();
+
+        /**
+         * Edges are provided as unsigned 32 bit values.
+         */
+        virtual int getFormat();
+
+        /**
+         * Destructor.
+         */
+        ~EdgeCapture();
+    };
+}
+
+#endif
@@ -0,0 +1,289 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef CODAL_FLASH_LOG_H
+#define CODAL_FLASH_LOG_H
+
+#include "CodalConfig.h"
+#include "SPIFlash.h"
+#include "DataStream.h"
+#include "CodalFiber.h"
+
+#define FLASH_LOG_MAGIC                 0xF1A5106C
+
+// Status flags
+#define FLASH_LOG_STATUS_MOUNTED        0x01
+
+/**
+ * Header at the start of each sector of the log.
+ */
+struct FlashLogSector
+{
+    uint32_t magic;
+    uint32_t sequence;              // Incremented each time a sector is opened, so that the newest sector can be found.
+    uint32_t crc;                   // CRC32 of the magic and sequence number.
+};
+
+/**
+ * Header at the start of each page of data in the log. The first page of each sector holds
+ * this after the FlashLogSector header.
+ */
+struct FlashLogPage
+{
+    uint16_t length;                // The number of bytes of records in the page.
+    uint16_t check;                 // The one's complement of length.
+    uint32_t crc;                   // CRC32 of the records in the page.
+};
+
+// The largest record that can be appended, in bytes. Records are held in a single page, each preceded by a length byte.
+#define FLASH_LOG_MAX_RECORD_SIZE       (SPIFLASH_PAGE_SIZE - sizeof(FlashLogSector) - sizeof(FlashLogPage) - 1)
+
+namespace codal
+{
+    class FlashLogReader;
+
+    /**
+     * An append only log of records, held in a region of SPI flash.
+     *
+     * The region is used as a ring of small rows (sectors). Records are gathered in RAM until a page
+     * is full, or flush() is called, and each page is then programmed with a single write. When the
+     * last page of a sector is used, the next sector is erased and the oldest records it held are lost.
+     *
+     * Each sector carries a sequence number, and the pages of a sector are filled in order, so the
+     * write position is recovered when the log is first used by a binary search of the sector and page
+     * headers, rather than a scan of the whole region.
+     *
+     * Pages are written whole, so flush() wastes the remainder of the current page, and should be
+     * called only when the records must survive a reset.
+     */
+    class FlashLog
+    {
+        friend class FlashLogReader;
+
+        SPIFlash        &flash;
+        uint32_t        start;              // The address of the first sector of the log.
+        uint32_t        sequence;           // The sequence number of the head sector.
+        uint16_t        sectorCount;        // The number of sectors in the log.
+        uint16_t        head;               // The sector being written.
+        uint16_t        tail;               // The sector holding the oldest records.
+        uint16_t        page;               // The page of the head sector being filled.
+        uint16_t        length;             // The number of bytes of records in buffer.
+        uint8_t         status;
+        FiberLock       lock;
+        uint8_t         buffer[SPIFLASH_PAGE_SIZE];     // The page being filled, starting with its FlashLogPage header.
+
+        public:
+
+        /**
+         * Constructor.
+         *
+         * The flash is not accessed until the log is first used.
+         *
+         * @param flash The flash device holding the log.
+         * @param start The address of the region to use. Must be aligned to SPIFLASH_SMALL_ROW_SIZE.
+         * @param length The size of the region to use, in bytes. Must span at least two small rows.
+         */
+        FlashLog(SPIFlash &flash, uint32_t start, uint32_t length);
+
+        /**
+         * Appends a record to the log.
+         *
+         * @param data The record to append.
+         * @param len The length of the record, in bytes. At most FLASH_LOG_MAX_RECORD_SIZE.
+         *
+         * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if the length is invalid, or the error reported by the flash device.
+         */
+        int append(const void *data, int len);
+
+        /**
+         * Writes any records held in RAM to flash.
+         *
+         * @return DEVICE_OK on success, or the error reported by the flash device.
+         */
+        int flush();
+
+        /**
+         * Discards all records in the log.
+         *
+         * @return DEVICE_OK on success, or the error reported by the flash device.
+         */
+        int clear();
+
+        /**
+         * Determines the number of bytes of flash available to the log, including the space used by its headers.
+         */
+        uint32_t getCapacity();
+
+        /**
+         * Destructor.
+         *
+         * Any records held in RAM are written to flash.
+         */
+        ~FlashLog();
+
+        private:
+
+        /**
+         * Locates the write position in flash, formatting the region if it does not hold a log.
+         */
+        int mount();
+
+        /**
+         * Starts a new, empty log in sector 0.
+         */
+        int format();
+
+        /**
+         * Erases the sector after the head, and makes it the new head.
+         */
+        int openSector();
+
+        /**
+         * Writes the page being filled to flash, and moves on to the next page.
+         */
+        int writePage();
+
+        /**
+         * Reads the header of the given sector.
+         *
+         * @return true if the header is valid.
+         */
+        bool readSector(int sector, FlashLogSector &header);
+
+        /**
+         * Determines if the given page of the head sector has been written.
+         */
+        bool pageUsed(int p);
+
+        /**
+         * Determines the number of sectors in the log older than the given sector.
+         */
+        uint32_t age(int sector)
+        {
+            return (head + sectorCount - sector) % sectorCount;
+        }
+
+        /**
+         * Determines the address of the header of the given page.
+         */
+        uint32_t pageAddress(int sector, int p)
+        {
+            return start + sector * SPIFLASH_SMALL_ROW_SIZE + p * SPIFLASH_PAGE_SIZE + (p == 0 ? sizeof(FlashLogSector) : 0);
+        }
+
+        /**
+         * Determines the number of bytes of records that fit in the given page.
+         */
+        static int pageCapacity(int p)
+        {
+            return SPIFLASH_PAGE_SIZE - sizeof(FlashLogPage) - (p == 0 ? sizeof(FlashLogSector) : 0);
+        }
+    };
+
+    /**
+     * Reads the records held in a FlashLog, from oldest to newest, including those not yet written to flash.
+     *
+     * As a DataSource, each record is provided as a separate ManagedBuffer. If the records being read
+     * are overwritten by the log, reading continues from the oldest remaining record.
+     */
+    class FlashLogReader : public DataSource
+    {
+        FlashLog        &log;
+        uint32_t        sequence;           // The sequence number of the sector being read.
+        uint16_t        sector;             // The sector being read.
+        uint16_t        page;               // The page being read.
+        uint16_t        offset;             // The offset of the next record in the page.
+        int16_t         cached;             // The length of the page held in cache, or -1 if the cache is empty.
+        DataSink        *downstream;
+        uint8_t         cache[SPIFLASH_PAGE_SIZE];
+
+        public:
+
+        /**
+         * Constructor.
+         *
+         * @param log The log to read. Reading begins with the oldest record.
+         */
+        FlashLogReader(FlashLog &log);
+
+        /**
+         * Moves back to the oldest record in the log.
+         */
+        void rewind();
+
+        /**
+         * Reads the next record.
+         *
+         * @param data The buffer to copy the record into.
+         * @param len The size of the buffer. Longer records are truncated.
+         *
+         * @return The length of the record, or DEVICE_NO_DATA if there are no more records.
+         */
+        int read(void *data, int len);
+
+        /**
+         * Determines if there are any more records to read.
+         */
+        bool available();
+
+        /**
+         * Provide the next record to our downstream caller, or an empty buffer if there are no more records.
+         */
+        virtual ManagedBuffer pull();
+
+        /**
+         * Allow our downstream component to register itself with us.
+         * Our downstream component is notified if any records are available.
+         */
+        virtual void connect(DataSink &sink);
+
+        /**
+         * Remove our downstream component.
+         */
+        virtual void disconnect();
+
+        /**
+         *  Determine the data format of the buffers streamed out of this component.
+         */
+        virtual int getFormat();
+
+        /**
+         * Defines the data format of the buffers streamed out of this component.
+         * Only DATASTREAM_FORMAT_8BIT_UNSIGNED is supported.
+         */
+        virtual int setFormat(int format);
+
+        private:
+
+        /**
+         * Moves to the next record, if not already positioned on one.
+         *
+         * @return a pointer to the length byte of the record, or NULL if there are no more records.
+         */
+        const uint8_t *next();
+    };
+}
+
+#endif
@@ -49,12 +49,32 @@ struct GFATEntry
     char filename[0];
 };
 
+// The number of boot, FAT and root directory blocks kept in RAM once built, as hosts read these repeatedly.
+#ifndef GHOSTFAT_CACHE_BLOCKS
+#define GHOSTFAT_CACHE_BLOCKS 4
+#endif
+
+struct GFATCachedBlock
+{
+    uint32_t blockNo;
+    uint32_t lastUsed;
+    uint8_t data[512];
+};
+
 // the name VirtualFAT would be more fitting, but it's unfortunately already taken.
 
 class GhostFAT : public USBMSC
 {
+    GFATEntry **fileIndex;      // all entries, in order of startCluster
+    uint16_t numFiles;
+    uint32_t cacheClock;
+    GFATCachedBlock *cache;
+
     void buildBlock(uint32_t block_no, uint8_t *data);
+    void buildFAT(uint32_t sectionIdx, uint16_t *dest);
     void readDirData(uint8_t *dest, int blkno, uint8_t dirid);
+    int findFile(uint32_t cluster);
+    const uint8_t *cachedBlock(uint32_t block_no);
 
 protected:
     GFATEntry *files;
@@ -64,7 +84,7 @@ public:
     GhostFAT();
 
     virtual uint32_t getCapacity();
-    virtual void readBlocks(int blockAddr, int numBlocks);
+    virtual int readBlock(uint32_t blockAddr, uint8_t *dest);
     virtual void writeBlocks(int blockAddr, int numBlocks);
 
     GFATEntry *addFile(GFATReadCallback read, void *userdata, const char *filename, uint32_t size,
@@ -42,6 +42,11 @@ DEALINGS IN THE SOFTWARE.
 
 #define HID_KEYBOARD_DELAY_DEFAULT 10
 
+// The number of reports computed ahead when typing, before they are sent.
+#ifndef HID_KEYBOARD_QUEUE_LENGTH
+#define HID_KEYBOARD_QUEUE_LENGTH 8
+#endif
+
 namespace codal
 {
     enum KeyActionType
@@ -62,13 +67,40 @@ namespace codal
         uint8_t keyStateGeneric[HID_KEYBOARD_KEYSTATE_SIZE_GENERIC];
         uint8_t keyStateConsumer[HID_KEYBOARD_KEYSTATE_SIZE_CONSUMER];
 
+        uint8_t queue[HID_KEYBOARD_QUEUE_LENGTH][HID_KEYBOARD_KEYSTATE_SIZE_GENERIC + 1];
+        uint8_t queueLength;
+        bool queueing;
+
         /**
-          * Writes the given report out over USB.
+          * Writes the given report out over USB, or adds it to the report queue while typing.
           *
           * @param report A pointer to the report to copy to USB
           */
         int updateReport(HIDKeyboardReport* report);
 
+        /**
+          * Writes all queued reports out over USB, in order.
+          *
+          * @return DEVICE_OK on success, or the error reported by the endpoint.
+          */
+        int sendQueue();
+
+        /**
+          * Queues the reports for the given sequence, followed by all keys up.
+          *
+          * @param seq A valid pointer to a KeySequence.
+          */
+        void queueSequence(const KeySequence *seq);
+
+        /**
+          * Presses or releases the given Key, without any delay.
+          *
+          * @param k A valid Key
+          *
+          * @return DEVICE_OK on success.
+          */
+        int keyAction(Key k, KeyActionType action);
+
         /**
           * sets the media key buffer to the given Key, without affecting the state of other media keys.
           *
@@ -251,6 +283,10 @@ namespace codal
         /**
           * Type a sequence of characters
           *
+          * Characters that share the same modifiers are merged into as few reports as rollover allows:
+          * each character adds its key to those already held, until a key repeats or all six slots are used.
+          * Reports are computed ahead, and sent back to back at the rate the host polls for them.
+          *
           * @param s A valid pointer to a char array
           *
           * @param len The length of s.
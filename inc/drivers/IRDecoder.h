@@ -0,0 +1,130 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef CODAL_IR_DECODER_H
+#define CODAL_IR_DECODER_H
+
+#include "CodalConfig.h"
+#include "CodalComponent.h"
+#include "EdgeCapture.h"
+
+#define IR_DECODER_EVT_NEC                  16  // A complete NEC frame has been received.
+#define IR_DECODER_EVT_NEC_REPEAT           17  // An NEC repeat code has been received.
+#define IR_DECODER_EVT_RC5                  18  // A complete RC5 frame has been received.
+
+// The tolerance applied to all IR timings, as a fraction of the nominal duration (in 1/256ths).
+#ifndef IR_DECODER_TOLERANCE
+#define IR_DECODER_TOLERANCE                64
+#endif
+
+// NEC protocol timings, in microseconds.
+#define IR_NEC_LEADER_MARK                  9000
+#define IR_NEC_LEADER_SPACE                 4500
+#define IR_NEC_REPEAT_SPACE                 2250
+#define IR_NEC_BIT_MARK                     562
+#define IR_NEC_ZERO_SPACE                   562
+#define IR_NEC_ONE_SPACE                    1687
+
+// RC5 protocol timings, in microseconds.
+#define IR_RC5_HALF_BIT                     889
+
+namespace codal
+{
+    /**
+     * Decodes NEC (and extended NEC) IR remote frames from a sequence of edges.
+     * The 16 bit address and 8 bit command of the last frame are available once IR_DECODER_EVT_NEC is raised.
+     */
+    class NECDecoder : public EdgeDecoder
+    {
+        uint16_t    id;
+        uint8_t     markLevel;
+        uint8_t     state;
+        uint8_t     bits;
+        uint32_t    data;
+
+        public:
+
+        uint16_t    address;
+        uint8_t     command;
+
+        /**
+         * Constructor.
+         *
+         * @param id The id to use for events raised by this decoder. Defaults to DEVICE_ID_EDGE_CAPTURE.
+         * @param activeLow true if the receiver output is low while IR is received, as with most demodulating receivers. Defaults to true.
+         */
+        NECDecoder(uint16_t id = DEVICE_ID_EDGE_CAPTURE, bool activeLow = true);
+
+        /**
+         * Process the next edge.
+         *
+         * @param level The level of the pin after the edge.
+         * @param duration The time the pin spent at the previous level, in microseconds.
+         */
+        virtual void decode(int level, uint32_t duration);
+    };
+
+    /**
+     * Decodes Philips RC5 IR remote frames from a sequence of edges.
+     * The address, command (including the extended seventh bit) and toggle bit of the last frame are
+     * available once IR_DECODER_EVT_RC5 is raised.
+     */
+    class RC5Decoder : public EdgeDecoder
+    {
+        uint16_t    id;
+        uint8_t     markLevel;
+        uint8_t     halfBits;
+        uint32_t    marks;
+
+        /**
+         * Decode the 28 half bits received, and raise an event if they form a valid frame.
+         */
+        void complete();
+
+        public:
+
+        uint8_t     address;
+        uint8_t     command;
+        uint8_t     toggle;
+
+        /**
+         * Constructor.
+         *
+         * @param id The id to use for events raised by this decoder. Defaults to DEVICE_ID_EDGE_CAPTURE.
+         * @param activeLow true if the receiver output is low while IR is received, as with most demodulating receivers. Defaults to true.
+         */
+        RC5Decoder(uint16_t id = DEVICE_ID_EDGE_CAPTURE, bool activeLow = true);
+
+        /**
+         * Process the next edge.
+         *
+         * @param level The level of the pin after the edge.
+         * @param duration The time the pin spent at the previous level, in microseconds.
+         */
+        virtual void decode(int level, uint32_t duration);
+    };
+}
+
+#endif
@@ -35,14 +35,30 @@ DEALINGS IN THE SOFTWARE.
 #define DEVICE_KEY_VALUE_STORE_OFFSET             -4
 #endif
 
+// The number of flash pages used by the store. At least two are needed, so that compaction is power fail safe.
+#ifndef KEY_VALUE_STORAGE_PAGE_COUNT
+#define KEY_VALUE_STORAGE_PAGE_COUNT              2
+#endif
+
+// The longest key that may be stored, excluding its NULL terminator.
+#ifndef KEY_VALUE_STORAGE_MAX_KEY_LENGTH
+#define KEY_VALUE_STORAGE_MAX_KEY_LENGTH          64
+#endif
+
+#define KEY_VALUE_STORAGE_LOG_MAGIC               0xC0DA1106
+
+#define KEY_VALUE_RECORD_FLAG_TOMBSTONE           0x01
+
+// Size of the buffer used to move data to and from flash, in words.
+#define KEY_VALUE_STORAGE_CHUNK_WORDS             16
+
+// Definitions for the fixed size KeyValuePair format used by get(key), and by earlier versions of the store.
 #define KEY_VALUE_STORAGE_MAGIC                   0xC0DA1
 
 #define KEY_VALUE_STORAGE_BLOCK_SIZE              48
 #define KEY_VALUE_STORAGE_KEY_SIZE                16
 #define KEY_VALUE_STORAGE_VALUE_SIZE              KEY_VALUE_STORAGE_BLOCK_SIZE - KEY_VALUE_STORAGE_KEY_SIZE
 
-#define KEY_VALUE_STORAGE_SCRATCH_WORD_SIZE       64
-
 #define KEY_VALUE_STORAGE_MAX_PAIRS               5
 
 namespace codal
@@ -71,30 +87,70 @@ namespace codal
       }
   };
 
+  /**
+    * Header at the start of each page of the store. The page with a valid magic number
+    * and the highest sequence number holds the live data.
+    */
+  struct KeyValueStoragePage
+  {
+      uint32_t sequence;
+      uint32_t magic;
+  };
+
+  /**
+    * Header of each record in the log. The key (without NULL terminator) and the value follow
+    * immediately, padded to a whole number of words. The CRC covers the first word of the header,
+    * the key and the value.
+    */
+  struct KeyValueRecord
+  {
+      uint16_t valueLength;
+      uint8_t keyLength;
+      uint8_t flags;
+      uint32_t crc;
+  };
+
+  /**
+    * RAM index entry for a live key.
+    */
+  struct KeyValueIndexEntry
+  {
+      uint16_t hash;              // PearsonHash of the key.
+      uint16_t offset;            // Location of the latest record for the key, in words from the start of the page.
+  };
 
   /**
     * Class definition for the KeyValueStorage class.
     * This allows reading and writing of small blocks of data to FLASH memory.
     *
     * This class operates as a key value store, it allows the retrieval, addition
-    * and deletion of KeyValuePairs.
+    * and deletion of key value pairs of any length.
     *
-    * The first 8 bytes are reserved for the KeyValueStore struct which gives core
-    * information such as the number of KeyValuePairs in the store, and whether the
-    * store has been initialised.
+    * The store is log structured. Each put() or remove() appends a record to the active page,
+    * so flash is only erased when the page fills. The live records are then copied to the next
+    * page in turn, spreading wear evenly across the pages used. A page only becomes active
+    * once its header is written, after all of its records, so an interrupted update or compaction
+    * leaves the previous state intact.
     *
-    * After the KeyValueStore struct, KeyValuePairs are arranged contiguously until
-    * the end of the block used as persistent storage.
+    * |-----8-----|----8+N----|-----|----8+N----|------------|
+    * | Page hdr  | Record[0] | ... | Record[M] | Free space |
+    * |-----------|-----------|-----|-----------|------------|
     *
-    * |-------8-------|--------48-------|-----|---------48--------|
-    * | KeyValueStore | KeyValuePair[0] | ... | KeyValuePair[N-1] |
-    * |---------------|-----------------|-----|-------------------|
+    * The location of the latest record of each key is held in RAM, indexed by a PearsonHash of the key.
     */
   class KeyValueStorage
   {
-      uint32_t          flashPagePtr;
-      NVMController&    controller;
-      uint32_t          *scratch;
+      uint32_t              flashPagePtr;       // The address of the first page of the store.
+      uint32_t              legacyPagePtr;      // The address of the page used by the original fixed size format.
+      uint32_t              pageSize;           // The size of each page, in bytes.
+      uint32_t              sequence;           // The sequence number of the active page.
+      uint32_t              writeOffset;        // The offset in the active page at which the next record will be written.
+      uint8_t               pageCount;          // The number of pages used by the store.
+      uint8_t               activePage;         // The page currently holding the live data.
+      uint16_t              indexLength;        // The number of live keys.
+      uint16_t              indexCapacity;      // The number of entries allocated in index.
+      KeyValueIndexEntry    *index;             // The location of each live key.
+      NVMController&        controller;
 
       public:
 
@@ -106,9 +162,11 @@ namespace codal
         * 
         * @param controller The non-volatile storage controller to use
         * @param pageNumber The logical page number for this KeyValueStorage. 
-        *                   Optionally use negative number to count from end of address space.
+        *                   Optionally use negative number to count from end of address space, in which case
+        *                   this is the last page of the store, and any further pages are taken below it.
+        * @param pageCount The number of consecutive pages to use. Defaults to KEY_VALUE_STORAGE_PAGE_COUNT, and must be at least 2.
         */
-      KeyValueStorage(NVMController& controller, int pageNumber = DEVICE_KEY_VALUE_STORE_OFFSET);
+      KeyValueStorage(NVMController& controller, int pageNumber = DEVICE_KEY_VALUE_STORE_OFFSET, int pageCount = KEY_VALUE_STORAGE_PAGE_COUNT);
 
       /**
         * Places a given key, and it's corresponding value into flash at the earliest
@@ -121,8 +179,8 @@ namespace codal
         *
         * @param dataSize the size of the data to be persisted
         *
-        * @return KEY_VALUE_OK on success, KEY_VALUE_INVALID_PARAMETER if the key or size is too large,
-        *         KEY_VALUE_NO_RESOURCES if the storage page is full
+        * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if the key or size is too large,
+        *         DEVICE_NO_RESOURCES if the storage is full
         */
       int put(const char* key, uint8_t* data, int dataSize);
 
@@ -137,8 +195,8 @@ namespace codal
         *
         * @param dataSize the size of the data to be persisted
         *
-        * @return KEY_VALUE_OK on success, KEY_VALUE_INVALID_PARAMETER if the key or size is too large,
-        *         KEY_VALUE_NO_RESOURCES if the storage page is full
+        * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if the key or size is too large,
+        *         DEVICE_NO_RESOURCES if the storage is full
         */
       int put(ManagedString key, uint8_t* data, int dataSize);
 
@@ -148,7 +206,7 @@ namespace codal
         * @param key the unique name used to identify a KeyValuePair in flash.
         *
         * @return a pointer to a heap allocated KeyValuePair struct, this pointer will be
-        *         NULL if the key was not found in storage.
+        *         NULL if the key was not found in storage. Values longer than KEY_VALUE_STORAGE_VALUE_SIZE are truncated.
         *
         * @note it is up to the user to free memory after use.
         */
@@ -160,18 +218,31 @@ namespace codal
         * @param key the unique name used to identify a KeyValuePair in flash.
         *
         * @return a pointer to a heap allocated KeyValuePair struct, this pointer will be
-        *         NULL if the key was not found in storage.
+        *         NULL if the key was not found in storage. Values longer than KEY_VALUE_STORAGE_VALUE_SIZE are truncated.
         *
         * @note it is up to the user to free memory after use.
         */
       KeyValuePair* get(ManagedString key);
 
+      /**
+        * Retreives the value identified by a given key, without any heap allocation.
+        *
+        * @param key the unique name used to identify the value in flash.
+        *
+        * @param buffer the buffer to copy the value into. May be NULL to just determine the length of the value.
+        *
+        * @param bufferSize the size of the buffer. Values larger than the buffer are truncated.
+        *
+        * @return the length of the stored value, or DEVICE_NO_DATA if the key was not found in storage.
+        */
+      int get(const char* key, uint8_t *buffer, int bufferSize);
+
       /**
         * Removes a KeyValuePair identified by a given key.
         *
         * @param key the unique name used to identify a KeyValuePair in flash.
         *
-        * @return KEY_VALUE_OK on success, or KEY_VALUE_NO_DATA if the given key
+        * @return DEVICE_OK on success, or DEVICE_NO_DATA if the given key
         *         was not found in flash.
         */
       int remove(const char* key);
@@ -181,7 +252,7 @@ namespace codal
         *
         * @param key the unique name used to identify a KeyValuePair in flash.
         *
-        * @return KEY_VALUE_OK on success, or KEY_VALUE_NO_DATA if the given key
+        * @return DEVICE_OK on success, or DEVICE_NO_DATA if the given key
         *         was not found in flash.
         */
       int remove(ManagedString key);
@@ -198,33 +269,83 @@ namespace codal
        */
       int wipe();
 
+      /**
+        * Destructor.
+        */
+      ~KeyValueStorage();
+
       private:
 
       /**
-       * Function to lazily instatiate a scratch buffer
-       */
-      void scratchReset();
+        * Locates the live data in flash, and rebuilds the RAM index from it.
+        * Flash that holds no valid store is formatted, importing any data held in the original fixed size format.
+        */
+      void mount();
 
       /**
-        * Function for populating the scratch page with a KeyValueStore.
+        * Imports the key value pairs held in the original fixed size format, if any.
         *
-        * @param store the KeyValueStore struct to write to the scratch page.
+        * @return true if an existing store was found and imported.
+        */
+      bool importLegacy();
+
+      /**
+        * Erases the given page, ready to receive records.
         */
-      void scratchKeyValueStore(KeyValueStore store);
+      int beginPage(int page);
 
       /**
-        * Function for populating the scratch page with a KeyValuePair.
+        * Writes the header of the given page, making it the active page.
+        */
+      int commitPage(int page);
+
+      /**
+        * Copies the latest record of every live key into the next page, and makes that the active page.
+        * The new page is not committed, so the previous page remains the valid copy of the store until
+        * the caller has appended any new record and called commitPage().
         *
-        * @param pair the KeyValuePair struct to write to the scratch page.
+        * @param reserve The number of bytes that must be free in the new page.
+        * @param replace The position in the index of a key about to be rewritten, or -1. Its current record is only
+        *                dropped if the new page would otherwise not have enough space.
+        * @return DEVICE_OK on success, or DEVICE_NO_RESOURCES if there is not enough space.
+        */
+      int compact(uint32_t reserve, int replace = -1);
+
+      /**
+        * Appends a record to the active page, and updates the index.
         *
-        * @param flashPointer the pointer in flash where this KeyValuePair resides. This pointer
-        * is used to determine the offset into the scratch page, where the KeyValuePair should
-        * be written.
+        * @return DEVICE_OK on success, or DEVICE_NO_RESOURCES if the page is full.
         */
-      void scratchKeyValuePair(KeyValuePair pair, int scratchOffset);
+      int append(const char *key, int keyLength, uint16_t hash, const uint8_t *data, int dataSize, uint8_t flags);
 
+      /**
+        * Determines the position of the given key in the index.
+        *
+        * @return the position in the index, or -1 if the key is not present.
+        */
+      int find(const char *key, int keyLength, uint16_t hash);
+
+      /**
+        * Reads and validates the record at the given offset of the active page.
+        *
+        * @return DEVICE_OK if a valid record is present, DEVICE_NO_DATA if the space is unused,
+        *         or DEVICE_INVALID_PARAMETER if the record is corrupt.
+        */
+      int readRecord(uint32_t offset, KeyValueRecord &record, char *key);
+
+      /**
+        * Reads any number of bytes from any address in flash.
+        */
+      int readBytes(uint32_t address, void *buffer, uint32_t length);
 
+      /**
+        * Determines the address of the given page.
+        */
+      uint32_t pageAddress(int page)
+      {
+          return flashPagePtr + page * pageSize;
+      }
   };
 }
 
-#endif
\ No newline at end of file
+#endif
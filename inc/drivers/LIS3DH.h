@@ -74,6 +74,15 @@ DEALINGS IN THE SOFTWARE.
 #define LIS3DH_INT2_THS        0x36
 #define LIS3DH_INT2_DURATION   0x37
 
+/**
+  * LIS3DH FIFO constants
+  */
+#define LIS3DH_FIFO_DEPTH              32
+#define LIS3DH_FIFO_MODE_BYPASS        0x00
+#define LIS3DH_FIFO_MODE_STREAM        0x80
+#define LIS3DH_FIFO_SRC_OVRN           0x40
+#define LIS3DH_FIFO_SRC_FSS            0x1F
+
 /**
   * MMA8653 constants
   */
@@ -92,6 +101,7 @@ namespace codal
         I2C&            i2c;                // The I2C interface to use.
         Pin             &int1;              // Data ready interrupt.
         uint16_t        address;            // I2C address of this accelerometer.
+        Sample3D        *batch;             // Samples drained from the FIFO, allocated when batching is first enabled.
 
         public:
 
@@ -157,6 +167,18 @@ namespace codal
          */
         virtual int requestUpdate() override;
 
+        /**
+          * Configures the LIS3DH hardware FIFO to deliver the given number of samples per batch.
+          * When enabled, the INT1 line signals the FIFO watermark rather than each new sample, and
+          * the whole FIFO is drained in a single burst read.
+          *
+          * @param samples The requested number of samples per batch, up to LIS3DH_FIFO_DEPTH. A value of 1 disables batching.
+          *
+          * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the accelerometer could not be configured,
+          *         or DEVICE_NO_RESOURCES if the sample buffer could not be allocated.
+          */
+        virtual int setBatchSize(int samples) override;
+
         /**
           * Destructor.
           */
@@ -87,6 +87,11 @@ DEALINGS IN THE SOFTWARE.
   */
 #define LSM303_A_WHOAMI_VAL           0x33
 #define LSM303_A_STATUS_DATA_READY    0x08
+#define LSM303_A_FIFO_DEPTH           32
+#define LSM303_A_FIFO_MODE_BYPASS     0x00
+#define LSM303_A_FIFO_MODE_STREAM     0x80
+#define LSM303_A_FIFO_SRC_OVRN        0x40
+#define LSM303_A_FIFO_SRC_FSS         0x1F
 
 /**
  * LSM303 Status flags
@@ -105,6 +110,12 @@ namespace codal
     I2C&            i2c;                    // The I2C interface to use.
     Pin&            int1;                   // Data ready interrupt.
     uint16_t        address;                // I2C address of this accelerometer.
+    Sample3D        *batch;                 // Samples drained from the FIFO, allocated when batching is first enabled.
+
+    /**
+     * Converts a single raw XYZ frame read from the device into a sample in milli-g, in ENU format.
+     */
+    Sample3D decodeSample(uint8_t *data);
 
     public:
 
@@ -144,6 +155,18 @@ namespace codal
      */
     virtual int requestUpdate() override;
 
+    /**
+     * Configures the hardware FIFO to deliver the given number of samples per batch.
+     * When enabled, the INT1 line signals the FIFO watermark rather than each new sample, and
+     * the whole FIFO is drained in a single burst read.
+     *
+     * @param samples The requested number of samples per batch, up to LSM303_A_FIFO_DEPTH. A value of 1 disables batching.
+     *
+     * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the accelerometer could not be configured,
+     *         or DEVICE_NO_RESOURCES if the sample buffer could not be allocated.
+     */
+    virtual int setBatchSize(int samples) override;
+
     /**
      * A periodic callback invoked by the fiber scheduler idle thread.
      *
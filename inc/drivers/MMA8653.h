@@ -57,9 +57,6 @@ DEALINGS IN THE SOFTWARE.
   */
 #define MMA8653_WHOAMI_VAL      0x5A
 
-#define MMA8653_SAMPLE_RANGES   3
-#define MMA8653_SAMPLE_RATES    8
-
 struct MMA8653Sample
 {
     int16_t         x;
@@ -67,21 +64,6 @@ struct MMA8653Sample
     int16_t         z;
 };
 
-struct MMA8653SampleRateConfig
-{
-    uint32_t        sample_period;
-    uint8_t         ctrl_reg1;
-};
-
-struct MMA8653SampleRangeConfig
-{
-    uint8_t         sample_range;
-    uint8_t         xyz_data_cfg;
-};
-
-
-extern const MMA8653SampleRangeConfig MMA8653SampleRange[];
-extern const MMA8653SampleRateConfig MMA8653SampleRate[];
 
 
 namespace codal
@@ -28,6 +28,23 @@ DEALINGS IN THE SOFTWARE.
 #include "CodalConfig.h"
 #include "AnalogSensor.h"
 
+// Set to 1 to convert readings through a precomputed, interpolated lookup table, or 0 to evaluate the Beta equation on every sample.
+#ifndef NON_LINEAR_ANALOG_SENSOR_LUT
+#define NON_LINEAR_ANALOG_SENSOR_LUT 1
+#endif
+
+// The lookup table divides the 10 bit input range into 2^NON_LINEAR_ANALOG_SENSOR_LUT_BITS linearly interpolated segments.
+#ifndef NON_LINEAR_ANALOG_SENSOR_LUT_BITS
+#define NON_LINEAR_ANALOG_SENSOR_LUT_BITS 6
+#endif
+
+#if NON_LINEAR_ANALOG_SENSOR_LUT_BITS < 1 || NON_LINEAR_ANALOG_SENSOR_LUT_BITS > 10
+#error "NON_LINEAR_ANALOG_SENSOR_LUT_BITS must be between 1 and 10"
+#endif
+
+#define NON_LINEAR_ANALOG_SENSOR_LUT_SIZE ((1 << NON_LINEAR_ANALOG_SENSOR_LUT_BITS) + 1)
+#define NON_LINEAR_ANALOG_SENSOR_LUT_SHIFT (10 - NON_LINEAR_ANALOG_SENSOR_LUT_BITS)
+
 namespace codal
 {
     /**
@@ -42,6 +59,16 @@ namespace codal
         float seriesResistor; // the resitance (in ohms) of the associated series resistor.
         float zeroOffset;     // A user defined "zero" point (negative asymptote).
 
+#if CONFIG_ENABLED(NON_LINEAR_ANALOG_SENSOR_LUT)
+        int32_t lut[NON_LINEAR_ANALOG_SENSOR_LUT_SIZE];    // Converted values at evenly spaced readings, in 24.8 fixed point.
+        int32_t lutEnds[2][NON_LINEAR_ANALOG_SENSOR_LUT_SHIFT + 1]; // Converted values at readings 2^k in from each end of the range, for the steep end segments.
+
+        /**
+         * Populates the lookup table from the Beta equation.
+         */
+        void buildLookupTable();
+#endif
+
         public:
 
         /**
@@ -67,6 +94,25 @@ namespace codal
          */
         virtual void updateSample();
 
+        /**
+         * Converts a raw reading into SI units by evaluating the Beta equation directly, in floating point.
+         * This is the reference conversion from which the lookup table is built.
+         *
+         * @param reading The raw reading from the sensor, in the range 0..1023.
+         *
+         * @return The sensed value, in SI units.
+         */
+        float convertReading(int reading);
+
+        /**
+         * Converts a raw reading into SI units, using the lookup table if enabled.
+         *
+         * @param reading The raw reading from the sensor, in the range 0..1023.
+         *
+         * @return The sensed value, in SI units.
+         */
+        int convert(int reading);
+
     };
 }
 
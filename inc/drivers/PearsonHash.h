@@ -12,12 +12,16 @@ namespace codal
       **/
     class PearsonHash
     {
-        static uint32_t hashN(ManagedString s, uint8_t byteCount);
+        static uint32_t hashN(const char *s, uint8_t byteCount);
 
         public:
         static uint8_t hash8(ManagedString s);
         static uint16_t hash16(ManagedString s);
         static uint32_t hash32(ManagedString s);
+
+        static uint8_t hash8(const char *s);
+        static uint16_t hash16(const char *s);
+        static uint32_t hash32(const char *s);
     };
 }
 
@@ -0,0 +1,106 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef DEVICE_SPIFLASH_MSC_H
+#define DEVICE_SPIFLASH_MSC_H
+
+#include "USBMSC.h"
+#include "SPIFlash.h"
+#include "CodalFiber.h"
+
+#if CONFIG_ENABLED(DEVICE_USB)
+
+// The time after the last write from the host before any cached data is written to flash, in milliseconds.
+#ifndef SPIFLASH_MSC_FLUSH_DELAY_MS
+#define SPIFLASH_MSC_FLUSH_DELAY_MS     200
+#endif
+
+#define DEVICE_MSC_EVT_FLUSH            3
+
+namespace codal
+{
+
+/**
+ * Exposes a region of SPI flash to the USB host as a mass storage device, that the host
+ * may format and use as an ordinary disk.
+ *
+ * Writes are gathered in a RAM copy of the flash sector (small row) being written, which is written
+ * back when the host moves on to another sector, or stops writing for SPIFLASH_MSC_FLUSH_DELAY_MS.
+ * The sector is only erased if the new data sets bits that are clear in flash, and only modified
+ * pages are programmed.
+ */
+class SPIFlashMSC : public USBMSC
+{
+    SPIFlash &flash;
+    uint32_t start;                 // The address of the region exposed to the host.
+    uint32_t blocks;                // The size of the region, in blocks.
+    int32_t cachedSector;           // The sector held in cache, or -1 if none.
+    uint16_t dirty;                 // Bitmask of the pages of the cached sector that differ from flash.
+    bool needsErase;                // Set if the cached sector cannot be written without first erasing it.
+    bool listening;
+    uint8_t *cache;                 // A copy of the sector being written.
+    FiberLock lock;
+
+    void flushHandler(Event);
+    int writeBack();
+    int loadSector(int sector);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param flash The flash device to expose.
+     * @param start The address of the region to expose. Should be aligned to SPIFLASH_SMALL_ROW_SIZE.
+     * @param length The size of the region, in bytes.
+     *
+     * @note Only whole SPIFLASH_SMALL_ROW_SIZE sectors inside the region are exposed, so an unaligned
+     *       start address or a length that is not a multiple of the sector size reduces the capacity.
+     */
+    SPIFlashMSC(SPIFlash &flash, uint32_t start, uint32_t length);
+
+    virtual uint32_t getCapacity();
+    virtual int readBlock(uint32_t blockAddr, uint8_t *dest);
+    virtual int writeBlock(uint32_t blockAddr, const uint8_t *src);
+    virtual void writeBlocks(int blockAddr, int numBlocks);
+
+    /**
+     * Writes any data held in cache to flash.
+     *
+     * @return DEVICE_OK on success, or the error reported by the flash device.
+     */
+    int flush();
+
+    /**
+     * Destructor.
+     *
+     * Any data held in cache is written to flash.
+     */
+    ~SPIFlashMSC();
+};
+}
+
+#endif
+
+#endif
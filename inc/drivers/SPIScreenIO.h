@@ -34,12 +34,30 @@ namespace codal
 
 class SPIScreenIO : public ScreenIO
 {
+    uint32_t frequency;
+    uint8_t mode;
+    uint8_t bits;
+
 public:
     SPI &spi;
     SPIScreenIO(SPI &spi);
+
+    /**
+     * Constructor, for a screen sharing its SPI bus with other devices.
+     *
+     * @param spi The SPI bus the screen is attached to.
+     * @param frequency The bus frequency to use with the screen, in hertz. Reapplied by acquire() if another
+     *                  device has used the bus in the meantime.
+     * @param mode The SPI mode to use with the screen (0 - 3). Defaults to 0.
+     * @param bits The number of bits per SPI frame. Defaults to 8.
+     */
+    SPIScreenIO(SPI &spi, uint32_t frequency, int mode = 0, int bits = 8);
+
     virtual void send(const void *txBuffer, uint32_t txSize);
     virtual void startSend(const void *txBuffer, uint32_t txSize, PVoidCallback doneHandler,
                            void *handlerArg);
+    virtual void acquire();
+    virtual void release();
 };
 
 } // namespace codal
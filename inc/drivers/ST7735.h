@@ -64,6 +64,7 @@ protected:
     void setData() { dc->setDigitalValue(1); }
 
     void sendCmd(uint8_t *buf, int len);
+    void sendCmdCore(uint8_t *buf, int len);
     void sendCmdSeq(const uint8_t *buf);
     void sendDone(Event);
     void sendWords(unsigned numBytes);
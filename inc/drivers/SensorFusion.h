@@ -0,0 +1,262 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef CODAL_SENSOR_FUSION_H
+#define CODAL_SENSOR_FUSION_H
+
+#include "CodalConfig.h"
+#include "CodalComponent.h"
+#include "Event.h"
+#include "Accelerometer.h"
+#include "Gyroscope.h"
+#include "Compass.h"
+#include "Matrix4.h"
+
+/**
+  * Status flags
+  */
+#define SENSOR_FUSION_STATUS_ACCEL_VALID        0x02
+#define SENSOR_FUSION_STATUS_MAG_VALID          0x04
+#define SENSOR_FUSION_STATUS_INITIALISED        0x08
+#define SENSOR_FUSION_STATUS_ACCEL_FRESH        0x10
+#define SENSOR_FUSION_STATUS_MAG_FRESH          0x20
+
+/**
+  * Sensor fusion events
+  */
+#define SENSOR_FUSION_EVT_DATA_UPDATE           1
+#define SENSOR_FUSION_EVT_ORIENTATION_CHANGE    2
+
+/**
+  * Default filter configuration.
+  *
+  * Gains are expressed in thousandths. The proportional gain determines how quickly gyroscope drift is
+  * corrected against the accelerometer and compass, the integral gain how quickly gyroscope bias is learnt.
+  */
+#ifndef SENSOR_FUSION_DEFAULT_KP
+#define SENSOR_FUSION_DEFAULT_KP                1000
+#endif
+
+#ifndef SENSOR_FUSION_DEFAULT_KI
+#define SENSOR_FUSION_DEFAULT_KI                0
+#endif
+
+// Number of gyroscope sample units per degree per second.
+#ifndef SENSOR_FUSION_DEFAULT_GYRO_SENSITIVITY
+#define SENSOR_FUSION_DEFAULT_GYRO_SENSITIVITY  1
+#endif
+
+// Change in any angle (in degrees) needed to raise SENSOR_FUSION_EVT_ORIENTATION_CHANGE.
+#ifndef SENSOR_FUSION_DEFAULT_THRESHOLD
+#define SENSOR_FUSION_DEFAULT_THRESHOLD         2
+#endif
+
+// Longest gap between gyroscope samples that will be integrated, in microseconds.
+#define SENSOR_FUSION_MAX_DT                    100000
+
+// Fractional bits used by the fixed point filter.
+#define SENSOR_FUSION_Q                         28
+
+namespace codal
+{
+    /**
+      * Class definition for SensorFusion.
+      *
+      * Combines the readings of an Accelerometer, Gyroscope and (optionally) a Compass into a single
+      * orientation estimate, using a Mahony style complementary filter. The orientation is held as a quaternion
+      * that is integrated every time the gyroscope reports a new sample, with drift corrected against the
+      * direction of gravity and (if available) magnetic north.
+      *
+      * All angles are reported in a North East Down frame fixed to the device: x points out of the top of the device,
+      * y out of its right hand side and z out of its back. When the CODAL_FIXED_POINT_ORIENTATION option is enabled,
+      * the filter runs entirely in fixed point arithmetic.
+      */
+    class SensorFusion : public CodalComponent
+    {
+        Accelerometer   &accelerometer;     // The accelerometer used to determine the direction of gravity.
+        Gyroscope       &gyroscope;         // The gyroscope whose samples drive the filter.
+        Compass         *compass;           // The compass used to determine the direction of north, or NULL.
+
+        Sample3D        accel;              // The latest accelerometer sample, in device NED format.
+        Sample3D        mag;                // The latest compass sample, in device NED format.
+
+        CODAL_TIMESTAMP lastUpdate;         // The time of the last gyroscope sample, in microseconds.
+        int             kp;                 // Proportional gain, in thousandths.
+        int             ki;                 // Integral gain, in thousandths.
+        int             gyroSensitivity;    // Gyroscope sample units per degree per second.
+        int             threshold;          // Change in orientation needed to raise an event, in centidegrees.
+
+#if CONFIG_ENABLED(CODAL_FIXED_POINT_ORIENTATION)
+        int32_t         q[4];               // The orientation quaternion (w, x, y, z), in fixed point.
+        int32_t         bias[3];            // The learnt gyroscope bias, in radians per second, in fixed point.
+#else
+        float           q[4];               // The orientation quaternion (w, x, y, z).
+        float           bias[3];            // The learnt gyroscope bias, in radians per second.
+#endif
+
+        int32_t         pitch;              // The current pitch, in centidegrees.
+        int32_t         roll;               // The current roll, in centidegrees.
+        int32_t         yaw;                // The current yaw, in centidegrees.
+        int32_t         reported[3];        // The pitch, roll and yaw last reported through an orientation change event.
+
+        public:
+
+        /**
+          * Constructor.
+          * Create a software abstraction of a sensor fusion filter, using the given accelerometer and gyroscope.
+          * The yaw reported is relative to the device orientation when the filter started.
+          *
+          * @param accelerometer The accelerometer to use.
+          * @param gyroscope The gyroscope to use.
+          * @param id The id to use for the message bus when transmitting events.
+          */
+        SensorFusion(Accelerometer &accelerometer, Gyroscope &gyroscope, uint16_t id = DEVICE_ID_SENSOR_FUSION);
+
+        /**
+          * Constructor.
+          * Create a software abstraction of a sensor fusion filter, using the given accelerometer, gyroscope and compass.
+          * The yaw reported is the heading of the device relative to magnetic north.
+          *
+          * @param accelerometer The accelerometer to use.
+          * @param gyroscope The gyroscope to use.
+          * @param compass The compass to use.
+          * @param id The id to use for the message bus when transmitting events.
+          */
+        SensorFusion(Accelerometer &accelerometer, Gyroscope &gyroscope, Compass &compass, uint16_t id = DEVICE_ID_SENSOR_FUSION);
+
+        /**
+          * Configures the gains of the filter.
+          *
+          * @param kp The proportional gain, in thousandths. Larger values trust the accelerometer and compass more.
+          * @param ki The integral gain, in thousandths. Set to zero to disable gyroscope bias estimation.
+          *
+          * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if either gain is negative.
+          */
+        int setGains(int kp, int ki);
+
+        /**
+          * Defines the scale of the samples provided by the gyroscope.
+          *
+          * @param sensitivity The number of gyroscope sample units that represent one degree per second.
+          *
+          * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the sensitivity is not positive.
+          */
+        int setGyroscopeSensitivity(int sensitivity);
+
+        /**
+          * Defines how far the device must rotate before a SENSOR_FUSION_EVT_ORIENTATION_CHANGE event is raised.
+          *
+          * @param degrees The change in pitch, roll or yaw needed to raise an event, in degrees.
+          *
+          * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the threshold is negative.
+          */
+        int setThreshold(int degrees);
+
+        /**
+          * Discards the current orientation estimate. The filter is reinitialised from the
+          * accelerometer and compass when the next gyroscope sample arrives.
+          */
+        void reset();
+
+        /**
+          * Provides the fused pitch of the device.
+          *
+          * @return The pitch of the device, in degrees, in the range -90..90. Positive values indicate the top of the device is raised.
+          */
+        int getPitch();
+
+        /**
+          * Provides the fused roll of the device.
+          *
+          * @return The roll of the device, in degrees, in the range -180..180. Positive values indicate the right hand side of the device is lowered.
+          */
+        int getRoll();
+
+        /**
+          * Provides the fused yaw (heading) of the device.
+          *
+          * @return The yaw of the device, in degrees, in the range 0..359, measured clockwise when viewed from above.
+          */
+        int getYaw();
+
+        /**
+          * Provides the orientation of the device as a unit quaternion.
+          *
+          * @return A 4x1 matrix holding the w, x, y and z components of the quaternion.
+          */
+        Matrix4 getQuaternion();
+
+        /**
+          * Provides the orientation of the device as a rotation matrix.
+          *
+          * @return A 3x3 matrix that rotates a vector from the device frame into the NED world frame.
+          */
+        Matrix4 getRotationMatrix();
+
+        /**
+          * Destructor.
+          */
+        ~SensorFusion();
+
+        private:
+
+        /**
+          * Common initialisation for the constructors.
+          */
+        void setup();
+
+        /**
+          * Converts a sample from the East North Up format used by the driver models into the device NED frame.
+          */
+        static Sample3D toNED(Sample3D s);
+
+        /**
+          * Seeds the quaternion directly from the latest accelerometer and compass samples.
+          */
+        void initialise();
+
+        /**
+          * Advances the filter by one gyroscope sample.
+          *
+          * @param g The gyroscope sample, in device NED format.
+          * @param dt The time since the previous sample, in microseconds.
+          */
+        void step(Sample3D g, uint32_t dt);
+
+        /**
+          * Recalculates pitch, roll and yaw from the quaternion, and raises any events required.
+          */
+        void recalculateAngles();
+
+        /**
+          * Event handlers, called whenever one of our sensors reports new data.
+          */
+        void onAccelerometerUpdate(Event);
+        void onCompassUpdate(Event);
+        void onGyroscopeUpdate(Event);
+    };
+}
+
+#endif
@@ -28,6 +28,11 @@ DEALINGS IN THE SOFTWARE.
 #include "SPIFlash.h"
 #include "SPI.h"
 
+// The longest time to sleep between polls of the status register while waiting for an erase, in milliseconds.
+#ifndef SPIFLASH_MAX_BACKOFF_MS
+#define SPIFLASH_MAX_BACKOFF_MS 50
+#endif
+
 namespace codal
 {
 class StandardSPIFlash : public SPIFlash
@@ -36,23 +41,75 @@ protected:
     uint32_t _numPages;
     SPI &spi;
     Pin &ssel;
-    uint8_t cmdBuf[4];
+    uint8_t cmdBuf[5];
     uint8_t status;
+    bool fastRead;
+
+    // Write combining state. Pending data is held for a single page, with unwritten bytes left at 0xFF.
+    uint8_t *combineBuffer;
+    int32_t combineAddr;
+    uint16_t combineStart;
+    uint16_t combineEnd;
+
+    // Held for the duration of each operation, as waiting for the flash may yield to other fibers.
+    FiberLock lock;
 
     void setCommand(uint8_t command, int addr);
     int sendCommand(uint8_t command, int addr = -1, void *resp = 0, int respSize = 0);
-    int eraseCore(uint8_t cmd, uint32_t addr);
+    int eraseCore(uint8_t cmd, uint32_t addr, uint32_t len);
     int waitBusy(int waitMS);
     void writeEnable();
+    int programPage(uint32_t addr, const uint8_t *data, uint32_t len);
+    int readCore(uint32_t addr, void *buffer, uint32_t len);
+    int writeCore(uint32_t addr, const void *buffer, uint32_t len);
+    int flushCore();
 
 public:
     StandardSPIFlash(SPI &spi, Pin &ssel, int numPages);
     virtual int numPages();
     virtual int readBytes(uint32_t addr, void *buffer, uint32_t len);
+
+    /**
+     * Programs the given data into flash. Unlike the base SPIFlash contract, the data may span
+     * any number of pages.
+     *
+     * If write combining is enabled, the data may be held in RAM until a write to another page,
+     * a read of the same page, or a call to flush().
+     */
     virtual int writeBytes(uint32_t addr, const void *buffer, uint32_t len);
     virtual int eraseSmallRow(uint32_t addr);
     virtual int eraseBigRow(uint32_t addr);
     virtual int eraseChip();
+
+    /**
+     * Selects the command used to read data. Fast read (0x0B) is used by default, as it is
+     * supported at the full bus frequency of all common parts; the legacy read (0x03) is
+     * available for parts that lack it.
+     *
+     * @param enable true to use fast read, false to use the legacy read command.
+     */
+    void setFastRead(bool enable);
+
+    /**
+     * Enables or disables write combining. When enabled, successive writes to the same page
+     * are gathered in a page sized RAM buffer, and programmed in a single operation.
+     *
+     * @param enable true to enable write combining, false to flush any pending data and disable it.
+     * @return DEVICE_OK on success, or DEVICE_NO_RESOURCES if the buffer could not be allocated.
+     */
+    int setWriteCombining(bool enable);
+
+    /**
+     * Programs any data held by the write combining buffer.
+     *
+     * @return DEVICE_OK on success, or DEVICE_SPI_ERROR if the flash could not be written.
+     */
+    int flush();
+
+    /**
+     * Destructor. Programs any data held by the write combining buffer.
+     */
+    ~StandardSPIFlash();
 };
 }
 
@@ -48,8 +48,15 @@ DEALINGS IN THE SOFTWARE.
 #define TOUCH_BUTTON_CALIBRATION_PERIOD                     10
 #endif
 
+// Configure the rate at which an automatically calibrated TouchButton tracks slow drift in its untouched reading.
+// Defined as the time constant of the baseline average, in samples.
+#ifndef TOUCH_BUTTON_DRIFT_RATE
+#define TOUCH_BUTTON_DRIFT_RATE                             32
+#endif
+
 // Status flags associated with a touch sensor
 #define TOUCH_BUTTON_CALIBRATING            0x10
+#define TOUCH_BUTTON_DRIFT_COMPENSATION     0x20
 
 namespace codal
 {
@@ -67,6 +74,7 @@ namespace codal
         TouchSensor     &touchSensor;           // The TouchSensor driving this button
         int             threshold;              // The calibration threshold of this button
         int             reading;                // The last sample taken of this button.
+        int             baseline;               // The tracked untouched reading of this button, in 1/16ths.
         bool            active;                 // true if this button is currnelty being sensed, false otherwise.
 
 
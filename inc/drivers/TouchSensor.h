@@ -36,6 +36,20 @@ DEALINGS IN THE SOFTWARE.
 #define TOUCH_SENSOR_SAMPLE_PERIOD      50
 #define TOUCH_SENSE_SAMPLE_MAX          1000
 
+// Bounds on the time allowed for receiver pins to discharge before each scan, in microseconds.
+#ifndef TOUCH_SENSOR_MIN_DRAIN_TIME
+#define TOUCH_SENSOR_MIN_DRAIN_TIME     20
+#endif
+
+#ifndef TOUCH_SENSOR_MAX_DRAIN_TIME
+#define TOUCH_SENSOR_MAX_DRAIN_TIME     1000
+#endif
+
+// The discharge time is calibrated as this multiple of the longest charge time seen in recent scans.
+#ifndef TOUCH_SENSOR_DRAIN_FACTOR
+#define TOUCH_SENSOR_DRAIN_FACTOR       4
+#endif
+
 // Event codes associate with this touch sensor.
 #define TOUCH_SENSOR_UPDATE_NEEDED      1
 
@@ -53,9 +67,21 @@ namespace codal
         protected:
 
         TouchButton*    buttons[TOUCH_SENSOR_MAX_BUTTONS];
+        uint32_t        portMask[TOUCH_SENSOR_MAX_BUTTONS];     // The bit of each button within a port read, or 0 if read individually.
+        Pin             *portPin;                               // The pin used to read all port-grouped buttons at once, if any.
         Pin             &drivePin;
         int             numberOfButtons;
 
+        uint16_t        drainTime;                              // The calibrated time allowed for receiver pins to discharge, in microseconds.
+        uint16_t        chargeTime;                             // The longest charge time seen since the last calibration, in microseconds.
+        uint32_t        scanTime;                               // The duration of the last scan, in microseconds.
+        uint32_t        maxScanTime;                            // The longest scan duration seen since the last call to getMaxScanTime().
+
+        /**
+          * Determine which buttons can be read together with a single port read.
+          */
+        void updatePortGroup();
+
         public:
 
         /**
@@ -93,6 +119,27 @@ namespace codal
          */
         virtual void onSampleEvent(Event);
 
+        /**
+         * Determines the duration of the most recent scan, including the discharge time.
+         *
+         * @return The scan duration, in microseconds.
+         */
+        int getScanTime();
+
+        /**
+         * Determines the longest scan duration since this method was last called, and resets it.
+         *
+         * @return The longest scan duration, in microseconds.
+         */
+        int getMaxScanTime();
+
+        /**
+         * Determines the time currently allowed for receiver pins to discharge before each scan.
+         *
+         * @return The discharge time, in microseconds.
+         */
+        int getDrainTime();
+
         /**
           * Destructor.
           */
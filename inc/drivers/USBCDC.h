@@ -0,0 +1,305 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef DEVICE_USBCDC_H
+#define DEVICE_USBCDC_H
+
+#include "CodalUSB.h"
+#include "DataStream.h"
+#include "ManagedString.h"
+#include "Serial.h"
+#include "CodalFiber.h"
+
+#if CONFIG_ENABLED(DEVICE_USB)
+
+// The size of the receive and transmit ring buffers, in bytes.
+#ifndef USB_CDC_RX_BUFFER_SIZE
+#define USB_CDC_RX_BUFFER_SIZE          1024
+#endif
+
+#ifndef USB_CDC_TX_BUFFER_SIZE
+#define USB_CDC_TX_BUFFER_SIZE          1024
+#endif
+
+// The size of the buffers handed to a connected DataSink. Should be a multiple of USB_MAX_PKT_SIZE.
+#ifndef USB_CDC_STREAM_BUFFER_SIZE
+#define USB_CDC_STREAM_BUFFER_SIZE      256
+#endif
+
+#define USB_CDC_EVT_DATA_RECEIVED       1   // Data has been placed in the receive buffer.
+#define USB_CDC_EVT_LINE_STATE          2   // The host has opened or closed the port.
+#define USB_CDC_EVT_TX                  3   // Internal: data is waiting to be sent.
+#define USB_CDC_EVT_STREAM              4   // Internal: a buffer is ready for the connected DataSink.
+#define USB_CDC_EVT_PULL                5   // Internal: the source passed to setSource() has a buffer ready.
+
+#define USB_CDC_STATUS_RX_PAUSED        0x01
+#define USB_CDC_STATUS_STREAM_READY     0x02
+
+#define CDC_REQUEST_SET_LINE_CODING         0x20
+#define CDC_REQUEST_GET_LINE_CODING         0x21
+#define CDC_REQUEST_SET_CONTROL_LINE_STATE  0x22
+
+#define CDC_LINE_STATE_DTR              0x01
+#define CDC_LINE_STATE_RTS              0x02
+
+namespace codal
+{
+    typedef struct {
+        uint32_t baud;
+        uint8_t stopBits;   // 0 - 1 stop bit, 1 - 1.5 stop bits, 2 - 2 stop bits
+        uint8_t parity;     // 0 - none, 1 - odd, 2 - even, 3 - mark, 4 - space
+        uint8_t dataBits;
+    } __attribute__((packed)) CDCLineCoding;
+
+    /**
+     * The communications (control) interface of a CDC-ACM function.
+     *
+     * This carries the line coding and control line state requests from the host,
+     * and the association descriptor that groups it with the data interface that follows it.
+     * It is owned by, and added to CodalUSB alongside, a USBCDC instance.
+     */
+    class USBCDCControl : public CodalUSBInterface
+    {
+        uint16_t id;
+        uint8_t lineState;
+        CDCLineCoding lineCoding;
+        uint8_t functional[19];
+        InterfaceInfo info;
+
+        public:
+
+        /**
+         * Constructor.
+         *
+         * @param id the id of the USBCDC instance that owns this interface, used for its events.
+         */
+        USBCDCControl(uint16_t id);
+
+        virtual int classRequest(UsbEndpointIn &ctrl, USBSetup &setup);
+        virtual const InterfaceInfo *getInterfaceInfo();
+        virtual int getAssociation(InterfaceAssociationDescriptor *desc);
+
+        /**
+         * Retrieves the control line state last set by the host.
+         *
+         * @return a bitmask of CDC_LINE_STATE_DTR and CDC_LINE_STATE_RTS.
+         */
+        uint8_t getLineState()
+        {
+            return lineState;
+        }
+
+        /**
+         * Retrieves the line coding last set by the host. This has no effect on the data rate.
+         */
+        const CDCLineCoding &getLineCoding()
+        {
+            return lineCoding;
+        }
+    };
+
+    /**
+     * A USB CDC-ACM (virtual serial port) function.
+     *
+     * Data is received straight from the endpoint into a ring buffer, and sent from a ring buffer,
+     * with the same API as Serial. When the host cannot keep up, the OUT endpoint is NAKed until
+     * there is room for another packet.
+     *
+     * Alternatively, the port can stream: a connected DataSink is handed buffers filled directly
+     * by the endpoint, and buffers pulled from a source passed to setSource() are written to
+     * the endpoint without being copied.
+     *
+     * Both interfaces of the function are added with attach(). Windows only binds the function
+     * when DEVICE_USB_IAD is enabled.
+     */
+    class USBCDC : public CodalUSBInterface, public DataSource, public DataSink
+    {
+        uint16_t id;
+        volatile uint8_t status;
+        bool listening;
+
+        uint8_t *rxBuff;
+        uint8_t *txBuff;
+        volatile uint16_t rxHead;
+        volatile uint16_t rxTail;
+        volatile uint16_t txHead;
+        volatile uint16_t txTail;
+
+        ManagedBuffer streamBuffer;     // Filled by the endpoint while a DataSink is connected.
+        volatile uint16_t streamLength;
+        ManagedBuffer output;           // Awaiting collection by the connected DataSink.
+
+        DataSink *downstream;
+        DataSource *upstream;
+        FiberLock txLock;
+
+        void startListening();
+        void onEvent(Event evt);
+        void receiveStream();
+        void deliverStream();
+        void pauseRx();
+        void resumeRx();
+        int rxSpace();
+        int fillTxBuffer(const uint8_t *buffer, int len);
+        int drainTx();
+        int flushTx();
+        void waitForData(SerialMode mode);
+
+        public:
+
+        USBCDCControl control;
+
+        /**
+         * Constructor.
+         *
+         * @param id the id used by this port for its events. Defaults to DEVICE_ID_USB_CDC.
+         */
+        USBCDC(uint16_t id = DEVICE_ID_USB_CDC);
+
+        /**
+         * Adds the control and data interfaces of this port to the given USB device.
+         * Must be called before the device is started.
+         *
+         * @param usb the USB device to add this port to.
+         *
+         * @return DEVICE_OK on success, or DEVICE_NO_RESOURCES if the device has already been started.
+         */
+        int attach(CodalUSB &usb);
+
+        virtual int endpointRequest();
+        virtual const InterfaceInfo *getInterfaceInfo();
+
+        /**
+         * Determines if the host has opened the port (asserted DTR).
+         *
+         * @return true if the host has the port open, false otherwise.
+         */
+        bool isConnected();
+
+        /**
+         * Sends a single character to the host.
+         *
+         * @param c the character to send.
+         * @param mode the selected mode, one of: ASYNC, SYNC_SPINWAIT, SYNC_SLEEP.
+         *
+         * @return the number of bytes buffered or sent, or DEVICE_NO_RESOURCES if the transmit buffer is full.
+         */
+        int sendChar(char c, SerialMode mode = DEVICE_DEFAULT_SERIAL_MODE);
+
+        /**
+         * Sends a ManagedString to the host.
+         *
+         * @param s the string to send.
+         * @param mode the selected mode, one of: ASYNC, SYNC_SPINWAIT, SYNC_SLEEP.
+         *
+         * @return the number of bytes buffered or sent, or DEVICE_INVALID_PARAMETER.
+         */
+        int send(ManagedString s, SerialMode mode = DEVICE_DEFAULT_SERIAL_MODE);
+
+        /**
+         * Sends a buffer to the host.
+         *
+         * In ASYNC mode, as much of the buffer as fits is copied to the transmit buffer and sent in the
+         * background. Otherwise, the calling fiber sends the data itself, and returns once it has all been sent.
+         * If the host does not have the port open, data is only buffered, and sent when it is opened.
+         *
+         * @param buffer the data to send.
+         * @param bufferLen the number of bytes to send.
+         * @param mode the selected mode, one of: ASYNC, SYNC_SPINWAIT, SYNC_SLEEP.
+         *
+         * @return the number of bytes buffered or sent, or DEVICE_INVALID_PARAMETER.
+         */
+        int send(const uint8_t *buffer, int bufferLen, SerialMode mode = DEVICE_DEFAULT_SERIAL_MODE);
+
+        /**
+         * Reads a single character received from the host.
+         *
+         * @param mode the selected mode, one of: ASYNC, SYNC_SPINWAIT, SYNC_SLEEP.
+         *
+         * @return the character read, or DEVICE_NO_DATA if none is available in ASYNC mode.
+         */
+        int read(SerialMode mode = DEVICE_DEFAULT_SERIAL_MODE);
+
+        /**
+         * Reads up to size characters received from the host.
+         *
+         * @param size the number of characters to read.
+         * @param mode the selected mode, one of: ASYNC, SYNC_SPINWAIT, SYNC_SLEEP. In ASYNC mode,
+         *        only the characters already received are returned.
+         *
+         * @return the characters read.
+         */
+        ManagedString read(int size, SerialMode mode = DEVICE_DEFAULT_SERIAL_MODE);
+
+        /**
+         * Reads data received from the host into the given buffer.
+         *
+         * @param buffer the buffer to fill.
+         * @param bufferLen the number of bytes to read.
+         * @param mode the selected mode, one of: ASYNC, SYNC_SPINWAIT, SYNC_SLEEP. In ASYNC mode,
+         *        only the bytes already received are read, otherwise the call returns once bufferLen bytes have been read.
+         *
+         * @return the number of bytes read, or DEVICE_INVALID_PARAMETER.
+         */
+        int read(uint8_t *buffer, int bufferLen, SerialMode mode = DEVICE_DEFAULT_SERIAL_MODE);
+
+        /**
+         * Determines if there is any data waiting in the receive buffer.
+         */
+        int isReadable();
+
+        /**
+         * @return the number of bytes waiting in the receive buffer.
+         */
+        int rxBufferedSize();
+
+        /**
+         * @return the number of bytes waiting in the transmit buffer.
+         */
+        int txBufferedSize();
+
+        /**
+         * Discards any data waiting in the receive buffer.
+         */
+        int clearRxBuffer();
+
+        /**
+         * Writes the buffers provided by the given source to the host, as they become available.
+         *
+         * @param source the DataSource to stream from.
+         */
+        void setSource(DataSource &source);
+
+        virtual ManagedBuffer pull();
+        virtual void connect(DataSink &sink);
+        virtual void disconnect();
+        virtual int getFormat();
+        virtual int pullRequest();
+    };
+}
+
+#endif
+
+#endif
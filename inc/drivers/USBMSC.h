@@ -30,11 +30,24 @@ DEALINGS IN THE SOFTWARE.
 
 #if CONFIG_ENABLED(DEVICE_USB)
 
+#define USBMSC_BLOCK_SIZE 512
+
 namespace codal
 {
 
 struct MSCState;
 
+/**
+ * Throughput counters for READ_10 and WRITE_10 commands.
+ */
+struct USBMSCStats
+{
+    uint32_t blocksRead;
+    uint32_t blocksWritten;
+    uint32_t readTime;      // Total time spent handling READ_10, in microseconds.
+    uint32_t writeTime;     // Total time spent handling WRITE_10, in microseconds.
+};
+
 class USBMSC : public CodalUSBInterface
 {
     struct MSCState *state;
@@ -44,13 +57,19 @@ class USBMSC : public CodalUSBInterface
     bool listen;
     bool disableIRQ;
 
+    USBMSCStats stats;
+#ifdef USB_EP_FLAG_ASYNC
+    uint8_t *blockBuffers;      // Two block buffers, used alternately by readBlocks(). Allocated on first use.
+
+    void waitForEndpoint();
+#endif
+
     bool writePadded(const void *ptr, int dataSize, int allocSize = -1);
     void writeHandler(Event);
     void readHandler(Event);
 
     int handeSCSICommand();
     int sendResponse(bool ok);
-    void fail();
 
     bool cmdInquiry();
     bool cmdRequest_Sense();
@@ -60,6 +79,13 @@ class USBMSC : public CodalUSBInterface
     bool cmdModeSense(bool is10);
     bool cmdReadFormatCapacity();
 
+protected:
+    /**
+     * Marks the current READ_10 or WRITE_10 command as failed. Further data is not transferred,
+     * and finishReadWrite() reports the failure to the host.
+     */
+    void fail();
+
 public:
     USBMSC();
     virtual int endpointRequest();
@@ -77,8 +103,54 @@ public:
     int currLUN();
     uint32_t cbwTag();
 
-    virtual void readBlocks(int blockAddr, int numBlocks) = 0;
-    virtual void writeBlocks(int blockAddr, int numBlocks) = 0;
+    /**
+     * Handles a READ_10 command, sending the given blocks to the host.
+     *
+     * The default implementation calls readBlock() for each block in turn, and sends it to the host.
+     * Where the target supports asynchronous IN endpoints (USB_EP_FLAG_ASYNC), blocks are double buffered,
+     * so that each block is read while the previous one is sent.
+     * Implementations that override this must call finishReadWrite() when complete.
+     */
+    virtual void readBlocks(int blockAddr, int numBlocks);
+
+    /**
+     * Handles a WRITE_10 command, receiving the given blocks from the host.
+     *
+     * The default implementation receives each block from the host in turn, and passes it to writeBlock().
+     * OUT endpoints can only be read synchronously, so blocks are not overlapped with their reception.
+     * Implementations that override this must call finishReadWrite() when complete.
+     */
+    virtual void writeBlocks(int blockAddr, int numBlocks);
+
+    /**
+     * Reads a single block, for the default readBlocks().
+     *
+     * @param blockAddr The block to read.
+     * @param dest The buffer to fill, of USBMSC_BLOCK_SIZE bytes.
+     *
+     * @return DEVICE_OK on success. Any other value fails the command.
+     */
+    virtual int readBlock(uint32_t blockAddr, uint8_t *dest) { return DEVICE_NOT_SUPPORTED; }
+
+    /**
+     * Writes a single block, for the default writeBlocks().
+     *
+     * @param blockAddr The block to write.
+     * @param src The data received from the host, of USBMSC_BLOCK_SIZE bytes.
+     *
+     * @return DEVICE_OK on success. Any other value fails the command.
+     */
+    virtual int writeBlock(uint32_t blockAddr, const uint8_t *src) { return DEVICE_NOT_SUPPORTED; }
+
+    /**
+     * Determines the throughput counters for the default readBlocks() and writeBlocks().
+     */
+    const USBMSCStats &getStats() { return stats; }
+
+    /**
+     * Resets the throughput counters.
+     */
+    void resetStats();
 };
 }
 
@@ -42,7 +42,12 @@ DEALINGS IN THE SOFTWARE.
 #define DATASTREAM_FORMAT_32BIT_UNSIGNED    7
 #define DATASTREAM_FORMAT_32BIT_SIGNED      8
 
-#define DATASTREAM_FORMAT_BYTES_PER_SAMPLE(x) ((x+1)/2)
+// Multi-channel formats follow, and are described by the size of each individual sample.
+// Interleaved X,Y,Z triples of 16 bit signed samples (e.g. from a motion sensor).
+#define DATASTREAM_FORMAT_16BIT_SIGNED_XYZ  9
+
+#define DATASTREAM_FORMAT_BYTES_PER_SAMPLE(x) ((x) == DATASTREAM_FORMAT_16BIT_SIGNED_XYZ ? 2 : ((x)+1)/2)
+#define DATASTREAM_FORMAT_CHANNELS(x) ((x) == DATASTREAM_FORMAT_16BIT_SIGNED_XYZ ? 3 : 1)
 
 namespace codal
 {
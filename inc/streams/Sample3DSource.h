@@ -0,0 +1,121 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "CodalConfig.h"
+#include "DataStream.h"
+#include "CoordinateSystem.h"
+
+#ifndef SAMPLE3D_SOURCE_H
+#define SAMPLE3D_SOURCE_H
+
+#define SAMPLE3D_SOURCE_DEFAULT_BUFFER_SIZE     32
+
+/**
+ * A DataSource that packs a sequence of Sample3D values into ManagedBuffers of interleaved
+ * 16 bit signed X,Y,Z triples (DATASTREAM_FORMAT_16BIT_SIGNED_XYZ), so that motion sensor
+ * data can be processed in blocks by the streams pipeline.
+ */
+namespace codal
+{
+    class Sample3DSource : public DataSource
+    {
+        private:
+        ManagedBuffer   buffer;                 // The output buffer being filled.
+        ManagedBuffer   output;                 // The last completed buffer, awaiting a pull from our downstream component.
+        int             bufferSize;             // The number of samples in each output buffer.
+        int             position;               // The number of samples written into the buffer being filled.
+        DataSink        *downstream;            // Pointer to our downstream component.
+
+        public:
+
+        /**
+         * Constructor.
+         *
+         * @param bufferSize The number of samples in each output buffer. Defaults to SAMPLE3D_SOURCE_DEFAULT_BUFFER_SIZE.
+         */
+        Sample3DSource(int bufferSize = SAMPLE3D_SOURCE_DEFAULT_BUFFER_SIZE);
+
+        /**
+         * Appends a sample to the stream. Each axis is saturated to the 16 bit signed range.
+         * When a buffer is complete, our downstream component is notified.
+         *
+         * Samples are discarded if no downstream component is connected.
+         *
+         * @param s The sample to append.
+         */
+        void push(const Sample3D &s);
+
+        /**
+         * Provide the next available ManagedBuffer to our downstream caller, if available.
+         */
+        virtual ManagedBuffer pull();
+
+        /**
+         * Allow our downstream component to register itself with us.
+         */
+        virtual void connect(DataSink &sink);
+
+        /**
+         * Remove our downstream component.
+         */
+        virtual void disconnect();
+
+        /**
+         *  Determine the data format of the buffers streamed out of this component.
+         *
+         *  @return DATASTREAM_FORMAT_16BIT_SIGNED_XYZ
+         */
+        virtual int getFormat();
+
+        /**
+         * Defines the data format of the buffers streamed out of this component.
+         * Only DATASTREAM_FORMAT_16BIT_SIGNED_XYZ is supported.
+         *
+         * @return DEVICE_OK if the format is DATASTREAM_FORMAT_16BIT_SIGNED_XYZ, DEVICE_NOT_SUPPORTED otherwise.
+         */
+        virtual int setFormat(int format);
+
+        /**
+         *  Determine the number of samples in each buffer streamed out of this component.
+         *  @return The number of XYZ samples in each output buffer.
+         */
+        int getBufferSize();
+
+        /**
+         *  Defines the number of samples in each buffer streamed out of this component.
+         *  Any partially filled buffer is discarded.
+         *
+         *  @param samples the number of XYZ samples in each output buffer.
+         *  @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if samples is not positive.
+         */
+        int setBufferSize(int samples);
+
+        /**
+         * Destructor.
+         */
+        virtual ~Sample3DSource();
+    };
+}
+#endif
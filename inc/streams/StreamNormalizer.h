@@ -56,8 +56,8 @@ namespace codal{
         DataStream      output;                 // The downstream output stream of this StreamNormalizer.
         ManagedBuffer   buffer;                 // The buffer being processed.
 
-        static SampleReadFn readSample[9];
-        static SampleWriteFn writeSample[9];
+        static SampleReadFn readSample[10];
+        static SampleWriteFn writeSample[10];
 
         /**
           * Creates a component capable of translating one data representation format into another
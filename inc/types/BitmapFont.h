@@ -38,8 +38,9 @@ namespace codal
      * Class definition for a BitmapFont
      * This class represents a font that can be used by the display to render text.
      *
-     * A BitmapFont is typically 5x5, but up to 8x8.
-     * Each Row is represented by a byte in the array.
+     * A BitmapFont is typically 5x5, but may be up to 32 pixels wide and 32 pixels high.
+     * Each Row is represented by (width + 7) / 8 bytes in the array, most significant byte first,
+     * with the rightmost column held in the least significant bit.
      *
      * Row Format:
      *            ================================================================
@@ -52,6 +53,9 @@ namespace codal
      *
      * The above will produce an exclaimation mark on the second column in from the left.
      *
+     * Fonts may optionally be proportional, in which case any empty columns to the left and right of
+     * a glyph are trimmed when text is laid out, so that narrow characters take less space.
+     *
      * We could compress further, but the complexity of decode would likely outweigh the gains.
      */
     class BitmapFont
@@ -65,6 +69,13 @@ namespace codal
 
             int asciiEnd;
 
+            // The width and height of each glyph in this font, in pixels.
+            uint8_t width;
+            uint8_t height;
+
+            // true if glyphs are trimmed to their visible width when laid out, false for fixed width.
+            bool proportional;
+
             /**
              * Constructor.
              *
@@ -73,8 +84,15 @@ namespace codal
              * @param font A pointer to the beginning of the new font.
              *
              * @param asciiEnd the char value at which this font finishes.
+             *
+             * @param width The width of each glyph in pixels (1..32). Defaults to BITMAP_FONT_WIDTH.
+             *
+             * @param height The height of each glyph in pixels (1..32). Defaults to BITMAP_FONT_HEIGHT.
+             *
+             * @param proportional true if empty columns either side of each glyph should be trimmed when
+             *                     text is laid out. Defaults to false.
              */
-            BitmapFont(const unsigned char* font, int asciiEnd = BITMAP_FONT_ASCII_END);
+            BitmapFont(const unsigned char* font, int asciiEnd = BITMAP_FONT_ASCII_END, int width = BITMAP_FONT_WIDTH, int height = BITMAP_FONT_HEIGHT, bool proportional = false);
 
             /**
              * Default Constructor.
@@ -103,6 +121,30 @@ namespace codal
              */
             const uint8_t* get(char c);
 
+            /**
+             * Determines if the given pixel of a glyph is set.
+             *
+             * @param glyph A pointer to the glyph, as returned by get().
+             * @param x The column of the pixel, from 0 (leftmost) to width - 1.
+             * @param y The row of the pixel, from 0 (top) to height - 1.
+             *
+             * @return 1 if the pixel is set, 0 otherwise.
+             */
+            int getPixel(const uint8_t *glyph, int x, int y);
+
+            /**
+             * Renders the given character as a sequence of columns, as used when laying out scrolling text.
+             * Bit n of each column represents the pixel in row n of the glyph.
+             * Characters not present in the font are rendered as blank space.
+             *
+             * @param c The character to render.
+             * @param columns Buffer to receive the rendered columns, at least width entries long, or NULL to
+             *                just measure the character.
+             *
+             * @return The number of columns occupied by the character, excluding any inter-character spacing.
+             */
+            int getColumns(char c, uint32_t *columns = NULL);
+
     };
 }
 
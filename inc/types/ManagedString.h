@@ -37,8 +37,44 @@ namespace codal
         char data[0];
     };
 
+    /**
+      * The layout of a StringData holding a literal of N bytes (including its terminator), used to
+      * place read-only strings in flash. See MANAGED_STRING().
+      */
+    template <int N> struct StringLiteral
+    {
+        uint16_t refCount;
+#if CONFIG_ENABLED(DEVICE_TAG)
+        uint16_t tag;
+#endif
+        uint16_t len;
+        char data[N];
+    };
+
+#if CONFIG_ENABLED(DEVICE_TAG)
+#define MANAGED_STRING_LITERAL_HEADER(s) 0xffff, REF_TAG_STRING, sizeof(s) - 1
+#else
+#define MANAGED_STRING_LITERAL_HEADER(s) 0xffff, sizeof(s) - 1
+#endif
+
+/**
+  * Creates a ManagedString for the given string literal, that refers to a read-only copy held in flash.
+  * No RAM is used to hold the string, and copies of it are never reference counted.
+  *
+  * @code
+  * ManagedString s = MANAGED_STRING("hello");
+  * @endcode
+  */
+#define MANAGED_STRING(s)                                                                          \
+    ([]() -> codal::ManagedString {                                                                \
+        static const codal::StringLiteral<sizeof(s)> literal __attribute__((aligned(4))) = {     \
+            MANAGED_STRING_LITERAL_HEADER(s), s};                                                  \
+        return codal::ManagedString((codal::StringData *)(void *)&literal);                        \
+    }())
+
     // forward declaration required for a friend in a namespace...
     class ManagedString;
+    class ManagedStringBuilder;
     ManagedString (operator+) (const ManagedString& lhs, const ManagedString& rhs);
 
     /**
@@ -404,10 +440,13 @@ namespace codal
         /**
           * Internal constructor helper.
           *
-          * Creates this ManagedString based on a given data.
+          * Creates this ManagedString based on a given data. Empty and single character strings
+          * refer to static, read-only data, rather than being allocated on the heap.
           */
         void initString(const char *str, int len);
 
+        friend class ManagedStringBuilder;
+
         /**
           * Private Constructor.
           *
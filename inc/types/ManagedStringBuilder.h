@@ -0,0 +1,146 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef MANAGED_STRING_BUILDER_H
+#define MANAGED_STRING_BUILDER_H
+
+#include "CodalConfig.h"
+#include "ManagedString.h"
+#include "ManagedBuffer.h"
+
+// The most unused space a builder's buffer may have, for it to be handed over as is by toString().
+#ifndef MANAGED_STRING_BUILDER_SLACK
+#define MANAGED_STRING_BUILDER_SLACK    16
+#endif
+
+namespace codal
+{
+    /**
+      * Builds a ManagedString from many parts, without the intermediate strings created by operator+.
+      *
+      * Parts are appended to a single growable buffer, which becomes the resulting string. If enough space
+      * is reserved up front, a string can be built with a single heap allocation.
+      *
+      * @code
+      * ManagedStringBuilder b(32);
+      * b.append("x=").append(x).append(',').append(name);
+      * ManagedString s = b.toString();
+      * @endcode
+      */
+    class ManagedStringBuilder
+    {
+        StringData *ptr;        // The buffer being built, or NULL if none has been allocated yet.
+        uint16_t capacity;      // The number of characters the buffer can hold, excluding the terminator.
+
+        public:
+
+        /**
+          * Constructor.
+          *
+          * @param capacity The number of characters to reserve space for. Defaults to none.
+          */
+        ManagedStringBuilder(int capacity = 0);
+
+        /**
+          * Destructor. Releases the buffer, if any.
+          */
+        ~ManagedStringBuilder();
+
+        /**
+          * Ensures there is space for at least the given number of characters.
+          *
+          * @param capacity The number of characters to reserve space for.
+          *
+          * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if capacity is too large for a ManagedString.
+          */
+        int reserve(int capacity);
+
+        /**
+          * Appends the given characters.
+          *
+          * @param str The characters to append.
+          * @param len The number of characters to append.
+          *
+          * @return a reference to this builder, so that calls can be chained.
+          */
+        ManagedStringBuilder &append(const char *str, int len);
+
+        /**
+          * Appends the given null terminated string.
+          */
+        ManagedStringBuilder &append(const char *str);
+
+        /**
+          * Appends the given ManagedString.
+          */
+        ManagedStringBuilder &append(const ManagedString &s);
+
+        /**
+          * Appends the contents of the given ManagedBuffer.
+          */
+        ManagedStringBuilder &append(ManagedBuffer buffer);
+
+        /**
+          * Appends the given character.
+          */
+        ManagedStringBuilder &append(char c);
+
+        /**
+          * Appends the decimal representation of the given integer.
+          */
+        ManagedStringBuilder &append(int value);
+
+        /**
+          * @return the number of characters appended so far.
+          */
+        int length() const
+        {
+            return ptr ? ptr->len : 0;
+        }
+
+        /**
+          * Discards the characters appended so far, keeping the buffer for reuse.
+          */
+        void clear();
+
+        /**
+          * Creates a ManagedString from the characters appended so far, and leaves the builder empty.
+          *
+          * The builder's buffer becomes the string, unless it has more than MANAGED_STRING_BUILDER_SLACK
+          * bytes to spare, in which case the characters are copied to a buffer of the exact size.
+          *
+          * @return the string built.
+          */
+        ManagedString toString();
+
+        private:
+
+        // Builders own their buffer outright, so may not be copied.
+        ManagedStringBuilder(const ManagedStringBuilder &);
+        ManagedStringBuilder &operator=(const ManagedStringBuilder &);
+    };
+}
+
+#endif
@@ -0,0 +1,119 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef MANAGED_STRING_TABLE_H
+#define MANAGED_STRING_TABLE_H
+
+#include "CodalConfig.h"
+#include "ManagedString.h"
+
+// The default number of slots in a ManagedStringTable. Rounded up to a power of two.
+#ifndef MANAGED_STRING_TABLE_SIZE
+#define MANAGED_STRING_TABLE_SIZE       32
+#endif
+
+namespace codal
+{
+    /**
+      * A table of interned strings.
+      *
+      * Interning a string returns the table's instance of any equal string, so that equal strings share
+      * a single copy in memory, and compare equal with a single pointer comparison. Strings are hashed with
+      * PearsonHash, and held in an open addressed table which is allocated on first use.
+      *
+      * The table holds a reference to each string it contains, for the lifetime of the table.
+      * String literals added with MANAGED_STRING() stay in flash.
+      */
+    class ManagedStringTable
+    {
+        StringData **entries;       // The interned strings, or NULL for an empty slot.
+        uint16_t capacity;          // The number of slots, a power of two.
+        uint16_t count;             // The number of slots in use.
+
+        /**
+          * Finds the slot holding the given string, or the empty slot it should be placed in.
+          *
+          * @return the index of the slot, or DEVICE_NO_RESOURCES if the string is not present and the table is full.
+          */
+        int lookup(const char *str, int len);
+
+        public:
+
+        /**
+          * Constructor.
+          *
+          * @param capacity The maximum number of strings the table can hold.
+          */
+        ManagedStringTable(int capacity = MANAGED_STRING_TABLE_SIZE);
+
+        /**
+          * Destructor. Releases the strings held by the table.
+          */
+        ~ManagedStringTable();
+
+        /**
+          * Interns the given string.
+          *
+          * @param s The string to intern.
+          *
+          * @return the table's instance of s. If the table is full, s itself is returned.
+          */
+        ManagedString intern(ManagedString s);
+
+        /**
+          * Interns the given null terminated string. No memory is allocated if the string is already in the table.
+          *
+          * @param s The string to intern.
+          *
+          * @return the table's instance of s. If the table is full, a new ManagedString holding s is returned.
+          */
+        ManagedString intern(const char *s);
+
+        /**
+          * Determines if an equal string has been interned.
+          *
+          * @param s The string to look for.
+          *
+          * @return true if the table holds a string equal to s, false otherwise.
+          */
+        bool contains(ManagedString s);
+
+        /**
+          * @return the number of strings in the table.
+          */
+        int size()
+        {
+            return count;
+        }
+
+        private:
+
+        // The table holds references to its strings, so may not be copied.
+        ManagedStringTable(const ManagedStringTable &);
+        ManagedStringTable &operator=(const ManagedStringTable &);
+    };
+}
+
+#endif
@@ -32,6 +32,12 @@ DEALINGS IN THE SOFTWARE.
 
 static uint32_t random_value;
 
+// CRC-32 lookup table, indexed by nibble to keep the table small.
+static const uint32_t crc32_table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
 /**
   * Performs an in buffer reverse of a given char array.
   *
@@ -146,4 +152,28 @@ int codal::random(int max)
     } while (result > (uint32_t)max);
 
     return result;
-}
\ No newline at end of file
+}
+
+/**
+ * Calculates the CRC-32 (as used by zlib and Ethernet) of the given data.
+ *
+ * @param data The data to checksum.
+ * @param len The number of bytes to checksum.
+ * @param crc The CRC of any preceding data, allowing a checksum to be computed in several parts. Defaults to 0.
+ * @return The CRC-32 of the data.
+ */
+uint32_t codal::crc32(const void *data, uint32_t len, uint32_t crc)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    crc = ~crc;
+
+    while (len--)
+    {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc32_table[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32_table[crc & 0x0F];
+    }
+
+    return ~crc;
+}
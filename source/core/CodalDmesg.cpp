@@ -31,6 +31,12 @@ DEALINGS IN THE SOFTWARE.
 CodalLogStore codalLogStore;
 static void (*dmesg_flush_fn)(void) = NULL;
 
+#if CONFIG_ENABLED(DEVICE_DMESG_BINARY)
+CodalBinaryLogStore codalBinaryLogStore;
+#define DMESG_RING_MASK (DEVICE_DMESG_BINARY_SIZE - 1)
+static void codal_dmesg_drain();
+#endif
+
 using namespace codal;
 
 static void logwrite(const char *msg);
@@ -131,11 +137,19 @@ void codal_dmesg_set_flush_fn(void (*fn)(void))
 
 void codal_dmesg_flush()
 {
+#if CONFIG_ENABLED(DEVICE_DMESG_BINARY)
+    codal_dmesg_drain();
+#endif
+
     if (dmesg_flush_fn)
         dmesg_flush_fn();
 }
 
-void codal_vdmesg(const char *format, bool crlf, va_list ap)
+/**
+  * Formats a message into codalLogStore. Arguments are taken from ap if given, or else from a binary record,
+  * ending at argsEnd. A record truncated to DMESG_RECORD_MAX_WORDS ends its message with "...".
+  */
+static void logformat(const char *format, bool crlf, va_list *ap, const uint32_t *args, const uint32_t *argsEnd)
 {
     const char *end = format;
 
@@ -144,8 +158,28 @@ void codal_vdmesg(const char *format, bool crlf, va_list ap)
         if (*end++ == '%')
         {
             logwriten(format, end - format - 1);
-            uint32_t val = va_arg(ap, uint32_t);
-            switch (*end++)
+
+            char type = *end++;
+
+            if (type == 0)
+            {
+                format = --end;
+                break;
+            }
+
+            uint32_t val = 0;
+
+            if (type != '%' && !ap && args >= argsEnd)
+            {
+                logwrite("...");
+                format = end = "";
+                break;
+            }
+
+            if (type != '%')
+                val = ap ? va_arg(*ap, uint32_t) : *args++;
+
+            switch (type)
             {
             case 'c':
                 logwriten((const char *)&val, 1);
@@ -162,7 +196,17 @@ void codal_vdmesg(const char *format, bool crlf, va_list ap)
                 logwritenum(val, true, true);
                 break;
             case 's':
-                logwrite((char *)(void *)val);
+                if (ap)
+                {
+                    logwrite((char *)(void *)val);
+                }
+                else
+                {
+                    // Binary records hold a copy of the string, as val characters.
+                    val = min(val, (uint32_t)(argsEnd - args) * 4);
+                    logwriten((const char *)args, val);
+                    args += (val + 3) / 4;
+                }
                 break;
             case '%':
                 logwrite("%");
@@ -180,4 +224,169 @@ void codal_vdmesg(const char *format, bool crlf, va_list ap)
         logwrite("\r\n");
 }
 
+#if CONFIG_ENABLED(DEVICE_DMESG_BINARY)
+
+/**
+  * Reserves space for a record of the given number of words in the binary ring.
+  * Writers never block each other: if another writer reserves space first, we simply try again.
+  *
+  * @return the index of the first word reserved, or -1 if the ring is full.
+  */
+REAL_TIME_FUNC
+static int32_t reserve(uint32_t words)
+{
+    uint32_t head;
+
+    do
+    {
+        head = codalBinaryLogStore.head;
+
+        if (head + words - codalBinaryLogStore.tail > DEVICE_DMESG_BINARY_SIZE)
+            return -1;
+    } while (!__sync_bool_compare_and_swap(&codalBinaryLogStore.head, head, head + words));
+
+    return head;
+}
+
+/**
+  * Records the address of the format string and the raw arguments in the binary ring.
+  * Only %s arguments need to be looked at, as the string they refer to may not outlive the call.
+  */
+REAL_TIME_FUNC
+static void logbinary(const char *format, bool crlf, va_list ap)
+{
+    uint32_t record[DMESG_RECORD_MAX_WORDS];
+    uint32_t len = 2;
+
+    for (const char *p = format; *p && len < DMESG_RECORD_MAX_WORDS; p++)
+    {
+        if (*p != '%')
+            continue;
+
+        char type = *++p;
+
+        if (type == 0)
+            break;
+
+        if (type == '%')
+            continue;
+
+        uint32_t val = va_arg(ap, uint32_t);
+
+        if (type == 's')
+        {
+            const char *str = (const char *)(void *)val;
+            uint32_t n = 0;
+            uint32_t max = min(DMESG_RECORD_MAX_STRING, (DMESG_RECORD_MAX_WORDS - len - 1) * 4);
+
+            while (n < max && str[n])
+                n++;
+
+            record[len++] = n;
+            memcpy(&record[len], str, n);
+            len += (n + 3) / 4;
+        }
+        else
+        {
+            record[len++] = val;
+        }
+    }
+
+    int32_t start = reserve(len);
+
+    if (start < 0)
+    {
+        __sync_fetch_and_add(&codalBinaryLogStore.dropped, 1);
+        return;
+    }
+
+    record[0] = (DMESG_RECORD_MAGIC << 24) | (crlf ? DMESG_RECORD_CRLF : 0) | len;
+    record[1] = (uint32_t)(void *)format;
+
+    for (uint32_t i = 1; i < len; i++)
+        codalBinaryLogStore.buffer[(start + i) & DMESG_RING_MASK] = record[i];
+
+    // Publish the record, once its contents are in place.
+    __sync_synchronize();
+    codalBinaryLogStore.buffer[start & DMESG_RING_MASK] = record[0];
+}
+
+/**
+  * Formats all complete records in the binary ring into codalLogStore, oldest first.
+  */
+static void codal_dmesg_drain()
+{
+    static volatile bool draining = false;
+    uint32_t record[DMESG_RECORD_MAX_WORDS];
+
+    if (draining)
+        return;
+
+    draining = true;
+
+    while (codalBinaryLogStore.tail != codalBinaryLogStore.head)
+    {
+        uint32_t tail = codalBinaryLogStore.tail;
+        uint32_t header = codalBinaryLogStore.buffer[tail & DMESG_RING_MASK];
+
+        // Stop at a record that is still being written.
+        if ((header >> 24) != DMESG_RECORD_MAGIC)
+            break;
+
+        uint32_t len = header & 0xff;
+
+        // A corrupt header leaves no way to find the next record, so discard everything written so far.
+        if (len < 2 || len > DMESG_RECORD_MAX_WORDS)
+        {
+            uint32_t head = codalBinaryLogStore.head;
+
+            for (uint32_t i = tail; i != head; i++)
+                codalBinaryLogStore.buffer[i & DMESG_RING_MASK] = 0;
+
+            __sync_fetch_and_add(&codalBinaryLogStore.dropped, 1);
+            __sync_synchronize();
+            codalBinaryLogStore.tail = head;
+            break;
+        }
+
+        // Take a copy, and hand the space back to writers. Every word is cleared, so that stale data is never
+        // mistaken for the header of a record still being written.
+        for (uint32_t i = 0; i < len; i++)
+        {
+            record[i] = codalBinaryLogStore.buffer[(tail + i) & DMESG_RING_MASK];
+            codalBinaryLogStore.buffer[(tail + i) & DMESG_RING_MASK] = 0;
+        }
+
+        __sync_synchronize();
+        codalBinaryLogStore.tail = tail + len;
+
+        logformat((const char *)(void *)record[1], (header & DMESG_RECORD_CRLF) != 0, NULL, &record[2], &record[len]);
+    }
+
+    if (codalBinaryLogStore.dropped)
+    {
+        uint32_t dropped = __sync_fetch_and_and(&codalBinaryLogStore.dropped, 0);
+
+        logwrite("[");
+        logwritenum(dropped, false, false);
+        logwrite(" dropped]\r\n");
+    }
+
+    draining = false;
+}
+
+#endif
+
+void codal_vdmesg(const char *format, bool crlf, va_list ap)
+{
+#if CONFIG_ENABLED(DEVICE_DMESG_BINARY)
+    logbinary(format, crlf, ap);
+#else
+    va_list args;
+    va_copy(args, ap);
+    logformat(format, crlf, &args, NULL, NULL);
+    va_end(args);
+#endif
+}
+
 #endif
@@ -1144,3 +1144,294 @@ int FiberLock::getWaitCount()
 
     return count;
 }
+
+/**
+ * Create a new semaphore.
+ *
+ * @param initialCount The number of units initially available.
+ */
+FiberSemaphore::FiberSemaphore(int initialCount)
+{
+    queue = NULL;
+    count = initialCount;
+}
+
+/**
+ * Block the calling fiber until a unit is available, and take it.
+ *
+ * @return DEVICE_OK on success, or DEVICE_NOT_SUPPORTED if no unit is available and the scheduler is not running.
+ */
+REAL_TIME_FUNC
+int FiberSemaphore::wait()
+{
+    if (tryWait() == DEVICE_OK)
+        return DEVICE_OK;
+
+    // If the scheduler is not running, there is nobody else to release a unit.
+    if (!fiber_scheduler_running())
+        return DEVICE_NOT_SUPPORTED;
+
+    // wait() is a blocking call, so if we're in a fork on block context,
+    // it's time to spawn a new fiber...
+    Fiber *f = handle_fob();
+
+    // Check if we've been raced by something running in interrupt context. If so, take the unit and
+    // put ourself back on the run queue, but still spin the scheduler (in case we performed a fork-on-block).
+    // Otherwise, the unit will be handed to us directly by signal().
+    target_disable_irq();
+
+    dequeue_fiber(f);
+
+    if (count > 0)
+    {
+        count--;
+        queue_fiber(f, &runQueue);
+    }
+    else
+    {
+        queue_fiber(f, &queue);
+    }
+
+    target_enable_irq();
+
+    schedule();
+
+    return DEVICE_OK;
+}
+
+/**
+ * Take a unit if one is available, without blocking.
+ *
+ * @return DEVICE_OK on success, or DEVICE_BUSY if no unit is available.
+ */
+REAL_TIME_FUNC
+int FiberSemaphore::tryWait()
+{
+    int result = DEVICE_BUSY;
+
+    target_disable_irq();
+
+    if (count > 0)
+    {
+        count--;
+        result = DEVICE_OK;
+    }
+
+    target_enable_irq();
+
+    return result;
+}
+
+/**
+ * Release a unit. If any fibers are blocked, the longest waiting fiber is given the unit and made runnable.
+ * Safe to call from interrupt context.
+ */
+REAL_TIME_FUNC
+void FiberSemaphore::signal()
+{
+    target_disable_irq();
+
+    Fiber *f = queue;
+
+    if (f)
+    {
+        dequeue_fiber(f);
+        queue_fiber(f, &runQueue);
+    }
+    else
+    {
+        count++;
+    }
+
+    target_enable_irq();
+}
+
+/**
+ * Determine the number of units currently available.
+ */
+int FiberSemaphore::getCount()
+{
+    return count;
+}
+
+/**
+ * Determine the number of fibers currently blocked on this semaphore.
+ */
+int FiberSemaphore::getWaitCount()
+{
+    int waiting = 0;
+
+    for (Fiber *f = queue; f; f = f->qnext)
+        waiting++;
+
+    return waiting;
+}
+
+/**
+ * Create a new set of event flags, all initially clear.
+ */
+FiberEventFlags::FiberEventFlags()
+{
+    queue = NULL;
+    flags = 0;
+}
+
+/**
+ * Determines if the given wait condition is met by the given flags.
+ */
+static bool event_flags_satisfied(uint32_t flags, uint32_t mask, bool all)
+{
+    return all ? (flags & mask) == mask : (flags & mask) != 0;
+}
+
+/**
+ * Block the calling fiber until the flags given in mask are set.
+ *
+ * @param mask The flags of interest.
+ *
+ * @param mode FIBER_EVENT_FLAGS_WAIT_ANY or FIBER_EVENT_FLAGS_WAIT_ALL, optionally combined with
+ *             FIBER_EVENT_FLAGS_CLEAR_ON_EXIT to atomically clear the flags in mask when the wait completes.
+ *
+ * @return The value of the flags at the point the wait was satisfied, or 0 if the wait could not be satisfied
+ *         without blocking and the scheduler is not running.
+ */
+REAL_TIME_FUNC
+uint32_t FiberEventFlags::wait(uint32_t mask, int mode)
+{
+    bool all = mode & FIBER_EVENT_FLAGS_WAIT_ALL;
+    bool clearOnExit = mode & FIBER_EVENT_FLAGS_CLEAR_ON_EXIT;
+    uint32_t result = 0;
+
+    if (mask == 0)
+        return flags;
+
+    // Fast path: the condition is already met.
+    target_disable_irq();
+    if (event_flags_satisfied(flags, mask, all))
+    {
+        result = flags;
+
+        if (clearOnExit)
+            flags &= ~mask;
+    }
+    target_enable_irq();
+
+    if (result || !fiber_scheduler_running())
+        return result;
+
+    // wait() is a blocking call, so if we're in a fork on block context,
+    // it's time to spawn a new fiber...
+    Fiber *f = handle_fob();
+
+    // Record the wait condition in the fiber, so set() can evaluate it without calling back into us.
+    f->context = mask;
+    f->flags &= ~(DEVICE_FIBER_FLAG_WAIT_ALL | DEVICE_FIBER_FLAG_CLEAR_ON_EXIT);
+    f->flags |= (all ? DEVICE_FIBER_FLAG_WAIT_ALL : 0) | (clearOnExit ? DEVICE_FIBER_FLAG_CLEAR_ON_EXIT : 0);
+
+    target_disable_irq();
+
+    dequeue_fiber(f);
+
+    // Check if we've been raced by something running in interrupt context.
+    if (event_flags_satisfied(flags, mask, all))
+    {
+        f->context = flags;
+
+        if (clearOnExit)
+            flags &= ~mask;
+
+        queue_fiber(f, &runQueue);
+    }
+    else
+    {
+        queue_fiber(f, &queue);
+    }
+
+    target_enable_irq();
+
+    schedule();
+
+    // set() leaves a snapshot of the flags that satisfied our wait in the fiber context.
+    f = currentFiber;
+    f->flags &= ~(DEVICE_FIBER_FLAG_WAIT_ALL | DEVICE_FIBER_FLAG_CLEAR_ON_EXIT);
+
+    return f->context;
+}
+
+/**
+ * Set the given flags, and wake any fibers whose wait condition is now satisfied.
+ * Safe to call from interrupt context.
+ *
+ * @param mask The flags to set.
+ */
+REAL_TIME_FUNC
+void FiberEventFlags::set(uint32_t mask)
+{
+    target_disable_irq();
+
+    flags |= mask;
+
+    // Take a snapshot of the flags, so that fibers clearing flags on exit do not prevent
+    // other fibers woken by the same operation from seeing them.
+    uint32_t snapshot = flags;
+    uint32_t cleared = 0;
+
+    Fiber *f = queue;
+    Fiber *t;
+
+    while (f != NULL)
+    {
+        t = f->qnext;
+
+        if (event_flags_satisfied(snapshot, f->context, f->flags & DEVICE_FIBER_FLAG_WAIT_ALL))
+        {
+            if (f->flags & DEVICE_FIBER_FLAG_CLEAR_ON_EXIT)
+                cleared |= f->context;
+
+            f->context = snapshot;
+
+            dequeue_fiber(f);
+            queue_fiber(f, &runQueue);
+        }
+
+        f = t;
+    }
+
+    flags &= ~cleared;
+
+    target_enable_irq();
+}
+
+/**
+ * Clear the given flags.
+ *
+ * @param mask The flags to clear.
+ */
+REAL_TIME_FUNC
+void FiberEventFlags::clear(uint32_t mask)
+{
+    target_disable_irq();
+    flags &= ~mask;
+    target_enable_irq();
+}
+
+/**
+ * Determine the current value of the flags.
+ */
+uint32_t FiberEventFlags::get()
+{
+    return flags;
+}
+
+/**
+ * Determine the number of fibers currently blocked on these flags.
+ */
+int FiberEventFlags::getWaitCount()
+{
+    int waiting = 0;
+
+    for (Fiber *f = queue; f; f = f->qnext)
+        waiting++;
+
+    return waiting;
+}
@@ -0,0 +1,184 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "CodalFixedMath.h"
+
+using namespace codal;
+
+//
+// atan(i / 64) for i = 0..64, in centidegrees.
+//
+static const int16_t atanTable[65] = {
+    0, 90, 179, 268, 358, 447, 536, 624, 713, 800, 888, 975, 1062,
+    1148, 1234, 1319, 1404, 1488, 1571, 1653, 1735, 1817, 1897, 1977, 2056, 2134,
+    2211, 2287, 2363, 2438, 2511, 2584, 2657, 2728, 2798, 2867, 2936, 3003, 3070,
+    3136, 3201, 3264, 3327, 3390, 3451, 3511, 3571, 3629, 3687, 3744, 3800, 3855,
+    3909, 3963, 4016, 4067, 4119, 4169, 4218, 4267, 4315, 4363, 4409, 4455, 4500
+};
+
+//
+// sin(i) for i = 0..90 degrees, in Q14 fixed point.
+//
+static const int16_t sinTable[91] = {
+    0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563, 2845, 3126, 3406,
+    3686, 3964, 4240, 4516, 4790, 5063, 5334, 5604, 5872, 6138, 6402, 6664, 6924,
+    7182, 7438, 7692, 7943, 8192, 8438, 8682, 8923, 9162, 9397, 9630, 9860, 10087,
+    10311, 10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365, 12551, 12733,
+    12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044, 14189, 14330, 14466, 14598, 14726,
+    14849, 14968, 15082, 15191, 15296, 15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964,
+    16026, 16083, 16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382, 16384
+};
+
+/**
+  * Calculates the angle of the vector (x, y) from the positive x axis, in the same way as atan2().
+  *
+  * Accurate to within 0.02 degrees.
+  *
+  * @param y The y component of the vector.
+  * @param x The x component of the vector.
+  *
+  * @return The angle, in centidegrees, in the range -18000..18000.
+  */
+int32_t codal::fixed_atan2(int32_t y, int32_t x)
+{
+    uint32_t ax = x < 0 ? -(uint32_t)x : x;
+    uint32_t ay = y < 0 ? -(uint32_t)y : y;
+
+    if (ax == 0 && ay == 0)
+        return 0;
+
+    // Only the ratio of the components matters, so scale them down until the division below cannot overflow.
+    while (ax > 0xFFFF || ay > 0xFFFF)
+    {
+        ax >>= 1;
+        ay >>= 1;
+    }
+
+    // Reduce to the first octant, such that the ratio lies in the range 0..1.
+    bool swap = ay > ax;
+    uint32_t ratio = swap ? (ax << FIXED_MATH_SHIFT) / ay : (ay << FIXED_MATH_SHIFT) / ax;
+
+    // Look up and interpolate between the two nearest table entries.
+    uint32_t index = ratio >> 8;
+    uint32_t fraction = ratio & 0xFF;
+    int32_t angle = atanTable[index];
+
+    if (index < 64)
+        angle += ((atanTable[index + 1] - atanTable[index]) * (int32_t)fraction) >> 8;
+
+    // Map back into the original octant.
+    if (swap)
+        angle = 9000 - angle;
+
+    if (x < 0)
+        angle = 18000 - angle;
+
+    return y < 0 ? -angle : angle;
+}
+
+/**
+  * Calculates the sine of the given angle.
+  *
+  * @param angle The angle, in centidegrees. Any value is accepted.
+  *
+  * @return The sine of the angle, as a Q14 fixed point value.
+  */
+int32_t codal::fixed_sin(int32_t angle)
+{
+    bool negative = false;
+
+    // Reduce to the range 0..18000, using sin(-a) == -sin(a).
+    angle %= 36000;
+
+    if (angle < 0)
+        angle += 36000;
+
+    if (angle >= 18000)
+    {
+        angle -= 18000;
+        negative = true;
+    }
+
+    // Reduce to the range 0..9000, using sin(180 - a) == sin(a).
+    if (angle > 9000)
+        angle = 18000 - angle;
+
+    // Look up and interpolate between the two nearest table entries.
+    int32_t index = angle / 100;
+    int32_t fraction = angle - (index * 100);
+    int32_t value = sinTable[index];
+
+    if (index < 90)
+        value += ((sinTable[index + 1] - sinTable[index]) * fraction) / 100;
+
+    return negative ? -value : value;
+}
+
+/**
+  * Calculates the cosine of the given angle.
+  *
+  * @param angle The angle, in centidegrees. Any value is accepted.
+  *
+  * @return The cosine of the angle, as a Q14 fixed point value.
+  */
+int32_t codal::fixed_cos(int32_t angle)
+{
+    return fixed_sin(angle % 36000 + 9000);
+}
+
+/**
+  * Calculates the integer square root of the given value, rounded down.
+  *
+  * @param value The value to take the square root of.
+  *
+  * @return The largest integer whose square is less than or equal to value.
+  */
+uint32_t codal::fixed_sqrt(uint64_t value)
+{
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    // Start from the highest power of four that does not exceed the value.
+    while (bit > value)
+        bit >>= 2;
+
+    // Classic digit-by-digit calculation, one result bit per iteration.
+    while (bit != 0)
+    {
+        if (value >= result + bit)
+        {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return (uint32_t) result;
+}
@@ -32,22 +32,31 @@ using namespace codal;
 
 KeyValueTableEntry* KeyValueTable::find(const uint32_t key) const
 {
-	// Now find the nearest sample range to that specified.
-	KeyValueTableEntry *p = (KeyValueTableEntry *)data + (length - 1);
-	KeyValueTableEntry *result = p;
+	// Binary search for the first entry whose key is not less than that specified.
+	int low = 0;
+	int high = length - 1;
 
-	while (p >= (KeyValueTableEntry *)data)
+	while (low < high)
 	{
-		if (p->key < key)
-			break;
+		int mid = (low + high) / 2;
 
-		result = p;
-		p--;
+		if (data[mid].key < key)
+			low = mid + 1;
+		else
+			high = mid;
 	}
 
-	return result;
+	return (KeyValueTableEntry *)data + low;
 }
 
+KeyValueTableEntry* KeyValueTable::findValue(const uint32_t value) const
+{
+	for (int i = 0; i < length; i++)
+		if (data[i].value == value)
+			return (KeyValueTableEntry *)data + i;
+
+	return NULL;
+}
 
 uint32_t KeyValueTable::get(const uint32_t key) const
 {
@@ -64,4 +73,9 @@ bool KeyValueTable::hasKey(const uint32_t key) const
 	return (find(key)->key == key);
 }
 
+uint32_t KeyValueTable::getKeyForValue(const uint32_t value, const uint32_t defaultKey) const
+{
+	KeyValueTableEntry *p = findValue(value);
 
+	return p ? p->key : defaultKey;
+}
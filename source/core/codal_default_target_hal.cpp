@@ -71,3 +71,75 @@ __attribute__((weak)) short unsigned int __sync_fetch_and_add_2 (volatile void *
 
     return old;
 }
+
+/**
+ * Default implementation of atomic compare and swap operation.
+ * GCC provides this where possible, but this is not supported on some CPU architectures...
+ *
+ * Interrupts are always disabled, as this is used to share data with interrupt handlers.
+ *
+ * @param ptr pointer to the memory to access.
+ * @param oldval the value the memory location is expected to hold.
+ * @param newval the value to store, if the memory location holds oldval.
+ * @return true if newval was stored, false otherwise.
+ */
+__attribute__((weak)) bool __sync_bool_compare_and_swap_4 (volatile void *ptr, unsigned int oldval, unsigned int newval)
+{
+    target_disable_irq();
+
+    volatile uint32_t *p = (volatile uint32_t *)ptr;
+    bool swapped = (*p == oldval);
+
+    if (swapped)
+        *p = newval;
+
+    target_enable_irq();
+
+    return swapped;
+}
+
+/**
+ * Default implementation of 32 bit atomic fetch and add operation.
+ * GCC provides this where possible, but this is not supported on some CPU architectures...
+ *
+ * Interrupts are always disabled, as this is used to share data with interrupt handlers.
+ *
+ * @param ptr pointer to the memory to access.
+ * @param value the value to add to the memory location.
+ * @return the value of the memory location BEFORE the add operation took place.
+ */
+__attribute__((weak)) unsigned int __sync_fetch_and_add_4 (volatile void *ptr, unsigned int value)
+{
+    target_disable_irq();
+
+    volatile uint32_t *p = (volatile uint32_t *)ptr;
+    uint32_t old = *p;
+    *p = old + value;
+
+    target_enable_irq();
+
+    return old;
+}
+
+/**
+ * Default implementation of 32 bit atomic fetch and bitwise and operation.
+ * GCC provides this where possible, but this is not supported on some CPU architectures...
+ *
+ * Interrupts are always disabled, as this is used to share data with interrupt handlers.
+ *
+ * @param ptr pointer to the memory to access.
+ * @param value the value to combine with the memory location.
+ * @return the value of the memory location BEFORE the operation took place.
+ */
+__attribute__((weak)) unsigned int __sync_fetch_and_and_4 (volatile void *ptr, unsigned int value)
+{
+    target_disable_irq();
+
+    volatile uint32_t *p = (volatile uint32_t *)ptr;
+    uint32_t old = *p;
+    *p = old & value;
+
+    target_enable_irq();
+
+    return old;
+}
@@ -27,6 +27,7 @@ DEALINGS IN THE SOFTWARE.
 #include "Event.h"
 #include "CodalCompat.h"
 #include "CodalFiber.h"
+#include "CodalFixedMath.h"
 
 using namespace codal;
 
@@ -49,6 +50,8 @@ Accelerometer::Accelerometer(CoordinateSpace &cspace, uint16_t id) : sample(), s
     // Set a default rate of 50Hz and a +/-2g range.
     this->samplePeriod = 20;
     this->sampleRange = 2;
+    this->batchSize = 1;
+    this->stream = NULL;
 
     // Initialise gesture history
     this->sigma = 0;
@@ -89,12 +92,52 @@ int Accelerometer::update()
     // Update gesture tracking
     updateGesture();
 
+    // Stream the new sample, if anybody is listening.
+    if (stream)
+        stream->push(sample);
+
     // Indicate that a new sample is available
     Event e(id, ACCELEROMETER_EVT_DATA_UPDATE);
 
     return DEVICE_OK;
 };
 
+/**
+  * Stores a batch of samples from the accelerometer sensor, and performs gesture tracking over every sample
+  * in the batch. A single ACCELEROMETER_EVT_DATA_UPDATE event is raised for the whole batch, and the last
+  * sample becomes the current sample.
+  *
+  * @param samples The samples read, in raw ENU format and in the order they were taken.
+  * @param length The number of samples provided.
+  *
+  * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if no samples are provided.
+  */
+int Accelerometer::updateBatch(Sample3D *samples, int length)
+{
+    if (samples == NULL || length <= 0)
+        return DEVICE_INVALID_PARAMETER;
+
+    // Run the gesture recogniser over each sample in turn, so that its filtering behaves exactly
+    // as it would if the samples had been delivered one at a time.
+    for (int i = 0; i < length; i++)
+    {
+        sampleENU = samples[i];
+        sample = coordinateSpace.transform(sampleENU);
+        updateGesture();
+
+        if (stream)
+            stream->push(sample);
+    }
+
+    // Indicate that pitch and roll data is now stale, and needs to be recalculated if needed.
+    status &= ~ACCELEROMETER_IMU_DATA_VALID;
+
+    // Indicate that new samples are available
+    Event e(id, ACCELEROMETER_EVT_DATA_UPDATE);
+
+    return DEVICE_OK;
+}
+
 /**
   * A service function.
   * It calculates the current scalar acceleration of the device (x^2 + y^2 + z^2).
@@ -357,6 +400,30 @@ int Accelerometer::getRange()
     return (int)sampleRange;
 }
 
+/**
+  * Attempts to configure the accelerometer to buffer the given number of samples in hardware (typically
+  * a FIFO) before delivering them to this model as a single batch.
+  *
+  * @param samples The requested number of samples per batch. A value of 1 disables batching.
+  *
+  * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the request fails, or DEVICE_NOT_SUPPORTED
+  * if the hardware has no FIFO.
+  */
+int Accelerometer::setBatchSize(int samples)
+{
+    return samples <= 1 ? DEVICE_OK : DEVICE_NOT_SUPPORTED;
+}
+
+/**
+  * Reads the currently configured batch size of the accelerometer.
+  *
+  * @return The number of samples delivered per batch.
+  */
+int Accelerometer::getBatchSize()
+{
+    return (int)batchSize;
+}
+
 /**
  * Configures the accelerometer for G range and sample rate defined
  * in this object. The nearest values are chosen to those defined
@@ -389,6 +456,21 @@ int Accelerometer::requestUpdate()
     return DEVICE_NOT_SUPPORTED;
 }
 
+/**
+  * Provides a DataSource that streams every sample from this accelerometer as ManagedBuffers of
+  * interleaved 16 bit signed X,Y,Z triples (DATASTREAM_FORMAT_16BIT_SIGNED_XYZ), in the coordinate
+  * system defined in the constructor. The DataSource is created on first use.
+  *
+  * @return The DataSource for this accelerometer.
+  */
+Sample3DSource& Accelerometer::getDataSource()
+{
+    if (stream == NULL)
+        stream = new Sample3DSource();
+
+    return *stream;
+}
+
 /**
  * Reads the last accelerometer value stored, and provides it in the coordinate system requested.
  *
@@ -519,6 +601,25 @@ float Accelerometer::getRollRadians()
   */
 void Accelerometer::recalculatePitchRoll()
 {
+#if CONFIG_ENABLED(CODAL_FIXED_POINT_ORIENTATION)
+    int32_t x = sample.x;
+    int32_t y = sample.y;
+    int32_t z = sample.z;
+
+    int32_t r = fixed_atan2(x, -z);
+    int32_t p = fixed_atan2(y, (x * fixed_sin(r) - z * fixed_cos(r)) >> FIXED_MATH_SHIFT);
+
+    // Handle to the two "negative quadrants", such that we get an output in the +/- 18- degree range.
+    // This ensures that the pitch values are consistent with the roll values.
+    if (z > 0)
+    {
+        int32_t reference = p > 0 ? FIXED_MATH_DEGREES(90) : FIXED_MATH_DEGREES(-90);
+        p = reference + (reference - p);
+    }
+
+    roll = FIXED_MATH_TO_RADIANS(r);
+    pitch = FIXED_MATH_TO_RADIANS(p);
+#else
     double x = (double) sample.x;
     double y = (double) sample.y;
     double z = (double) sample.z;
@@ -533,6 +634,7 @@ void Accelerometer::recalculatePitchRoll()
         double reference = pitch > 0.0 ? (PI / 2.0) : (-PI / 2.0);
         pitch = reference + (reference - pitch);
     }
+#endif
 
     status |= ACCELEROMETER_IMU_DATA_VALID;
 }
@@ -559,5 +661,6 @@ uint16_t Accelerometer::getGesture()
   */
 Accelerometer::~Accelerometer()
 {
+    delete stream;
 }
 
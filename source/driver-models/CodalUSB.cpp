@@ -62,8 +62,8 @@ static const DeviceDescriptor default_device_desc = {
     0x0200, // bcdUSBL
 #endif
 
-#if 0
-    // This should be only used if we implement USB Serial (CDC) with IAD descriptors
+#if CONFIG_ENABLED(DEVICE_USB_IAD)
+    // Required by Windows when interface association descriptors are used, eg by USB Serial (CDC)
     0xEF,            // bDeviceClass:    Misc
     0x02,            // bDeviceSubclass:
     0x01,            // bDeviceProtocol:
@@ -220,6 +220,7 @@ void CodalUSBInterface::fillInterfaceInfo(InterfaceDescriptor *descp)
 int CodalUSB::sendConfig()
 {
     const InterfaceInfo *info;
+    InterfaceAssociationDescriptor assoc;
     int numInterfaces = 0;
     int clen = sizeof(ConfigDescriptor);
 
@@ -230,6 +231,8 @@ int CodalUSB::sendConfig()
         clen += sizeof(InterfaceDescriptor) +
                 info->iface.numEndpoints * sizeof(EndpointDescriptor) +
                 info->supplementalDescriptorSize;
+        if (iface->getAssociation(&assoc) == DEVICE_OK)
+            clen += sizeof(assoc);
         numInterfaces++;
     }
 
@@ -248,6 +251,12 @@ int CodalUSB::sendConfig()
     for (CodalUSBInterface *iface = interfaces; iface; iface = iface->next)
     {
         info = iface->getInterfaceInfo();
+
+        if (iface->getAssociation(&assoc) == DEVICE_OK)
+        {
+            ADD_DESC(assoc);
+        }
+
         InterfaceDescriptor desc;
         iface->fillInterfaceInfo(&desc);
         ADD_DESC(desc);
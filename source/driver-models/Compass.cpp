@@ -27,6 +27,7 @@ DEALINGS IN THE SOFTWARE.
 #include "Event.h"
 #include "CodalCompat.h"
 #include "CodalFiber.h"
+#include "CodalFixedMath.h"
 
 #define CALIBRATED_SAMPLE(sample, axis) (((sample.axis - calibration.centre.axis) * calibration.scale.axis) >> 10)
 
@@ -72,6 +73,7 @@ void Compass::init(uint16_t id)
     // Store our identifiers.
     this->id = id;
     this->status = 0;
+    this->stream = NULL;
 
     // Set a default rate of 50Hz.
     this->samplePeriod = 20;
@@ -127,11 +129,19 @@ int Compass::getFieldStrength()
 {
     Sample3D s = getSample();
 
+#if CONFIG_ENABLED(CODAL_FIXED_POINT_ORIENTATION)
+    int64_t x = s.x;
+    int64_t y = s.y;
+    int64_t z = s.z;
+
+    return (int) fixed_sqrt(x*x + y*y + z*z);
+#else
     double x = s.x;
     double y = s.y;
     double z = s.z;
 
     return (int) sqrt(x*x + y*y + z*z);
+#endif
 }
 
 /**
@@ -321,12 +331,31 @@ int Compass::update()
     // Store the user accessible data, in the requested coordinate space, and taking into account component placement of the sensor.
     sample = coordinateSpace.transform(sampleENU);
 
+    // Stream the new sample, if anybody is listening.
+    if (stream)
+        stream->push(sample);
+
     // Indicate that a new sample is available
     Event e(id, COMPASS_EVT_DATA_UPDATE);
 
     return DEVICE_OK;
 };
 
+/**
+  * Provides a DataSource that streams every sample from this compass as ManagedBuffers of
+  * interleaved 16 bit signed X,Y,Z triples (DATASTREAM_FORMAT_16BIT_SIGNED_XYZ), in the coordinate
+  * system defined in the constructor. The DataSource is created on first use.
+  *
+  * @return The DataSource for this compass.
+  */
+Sample3DSource& Compass::getDataSource()
+{
+    if (stream == NULL)
+        stream = new Sample3DSource();
+
+    return *stream;
+}
+
 /**
  * Reads the last compass value stored, and provides it in the coordinate system requested.
  *
@@ -390,6 +419,45 @@ int Compass::getZ()
  */
 int Compass::tiltCompensatedBearing()
 {
+#if CONFIG_ENABLED(CODAL_FIXED_POINT_ORIENTATION)
+    int32_t phi = FIXED_MATH_FROM_RADIANS(accelerometer->getRollRadians());
+    int32_t theta = FIXED_MATH_FROM_RADIANS(accelerometer->getPitchRadians());
+
+    Sample3D s = getSample(NORTH_EAST_DOWN);
+
+    int32_t x = s.x;
+    int32_t y = s.y;
+    int32_t z = s.z;
+
+    // Only the direction of the field matters, so scale the sample down until the products below cannot overflow.
+    while (x > 32767 || x < -32767 || y > 32767 || y < -32767 || z > 32767 || z < -32767)
+    {
+        x /= 2;
+        y /= 2;
+        z /= 2;
+    }
+
+    // Precompute cos and sin of pitch and roll angles to make the calculation a little more efficient.
+    int32_t sinPhi = fixed_sin(phi);
+    int32_t cosPhi = fixed_cos(phi);
+    int32_t sinTheta = fixed_sin(theta);
+    int32_t cosTheta = fixed_cos(theta);
+
+    int32_t ySinTheta = (y * sinTheta) >> FIXED_MATH_SHIFT;
+    int32_t zSinTheta = (z * sinTheta) >> FIXED_MATH_SHIFT;
+
+    // Calculate the tilt compensated bearing, in centidegrees.
+    int32_t bearing = fixed_atan2((x * cosTheta + ySinTheta * sinPhi + zSinTheta * cosPhi) >> FIXED_MATH_SHIFT, (z * sinPhi - y * cosPhi) >> FIXED_MATH_SHIFT);
+
+    // Handle the 90 degree offset caused by the NORTH_EAST_DOWN based calculation.
+    bearing = FIXED_MATH_DEGREES(90) - bearing;
+
+    // Ensure the calculated bearing is in the 0..359 degree range.
+    if (bearing < 0)
+        bearing += FIXED_MATH_DEGREES(360);
+
+    return (int) (bearing / 100);
+#else
     // Precompute the tilt compensation parameters to improve readability.
     float phi = accelerometer->getRollRadians();
     float theta = accelerometer->getPitchRadians();
@@ -417,6 +485,7 @@ int Compass::tiltCompensatedBearing()
         bearing += 360.0f;
 
     return (int) (bearing);
+#endif
 }
 
 /**
@@ -424,6 +493,16 @@ int Compass::tiltCompensatedBearing()
  */
 int Compass::basicBearing()
 {
+#if CONFIG_ENABLED(CODAL_FIXED_POINT_ORIENTATION)
+    Sample3D cs = this->getSample(SIMPLE_CARTESIAN);
+
+    int32_t bearing = fixed_atan2(cs.x, cs.y);
+
+    if (bearing < 0)
+        bearing += FIXED_MATH_DEGREES(360);
+
+    return (int) (bearing / 100);
+#else
     // Convert to floating point to reduce rounding errors
     Sample3D cs = this->getSample(SIMPLE_CARTESIAN);
     float x = (float) cs.x;
@@ -435,6 +514,7 @@ int Compass::basicBearing()
         bearing += 360.0;
 
     return (int)bearing;
+#endif
 }
 
 /**
@@ -442,6 +522,7 @@ int Compass::basicBearing()
   */
 Compass::~Compass()
 {
+    delete stream;
 }
 
 
@@ -50,6 +50,7 @@ Gyroscope::Gyroscope(CoordinateSpace &cspace, uint16_t id) : sample(), sampleENU
     // Set a default rate of 50Hz and a +/-2g range.
     this->samplePeriod = 20;
     this->sampleRange = 2;
+    this->stream = NULL;
 }
 
 /**
@@ -73,6 +74,10 @@ int Gyroscope::update(Sample3D s)
     // Indicate that pitch and roll data is now stale, and needs to be recalculated if needed.
     status &= ~GYROSCOPE_IMU_DATA_VALID;
 
+    // Stream the new sample, if anybody is listening.
+    if (stream)
+        stream->push(sample);
+
     // Indicate that a new sample is available
     Event e(id, GYROSCOPE_EVT_DATA_UPDATE);
 
@@ -201,6 +206,21 @@ int Gyroscope::requestUpdate()
     return DEVICE_NOT_SUPPORTED;
 }
 
+/**
+  * Provides a DataSource that streams every sample from this gyroscope as ManagedBuffers of
+  * interleaved 16 bit signed X,Y,Z triples (DATASTREAM_FORMAT_16BIT_SIGNED_XYZ), in the coordinate
+  * system defined in the constructor. The DataSource is created on first use.
+  *
+  * @return The DataSource for this gyroscope.
+  */
+Sample3DSource& Gyroscope::getDataSource()
+{
+    if (stream == NULL)
+        stream = new Sample3DSource();
+
+    return *stream;
+}
+
 /**
  * Reads the last accelerometer value stored, and provides it in the coordinate system requested.
  *
@@ -264,5 +284,6 @@ int Gyroscope::getZ()
   */
 Gyroscope::~Gyroscope()
 {
+    delete stream;
 }
 
@@ -24,14 +24,28 @@ DEALINGS IN THE SOFTWARE.
 
 #include "I2C.h"
 #include "ErrorNo.h"
+#include "CodalFiber.h"
+#include "codal_target_hal.h"
 
 namespace codal
 {
+    /**
+     * Completion handler for transactions performed by transact(), which wakes the waiting fiber.
+     */
+    static void i2c_transaction_done(void *arg)
+    {
+        ((FiberSemaphore *)arg)->signal();
+    }
+
     /**
      * Constructor.
      */
     I2C::I2C(Pin &sda, Pin &scl)
     {
+        queueHead = NULL;
+        queueTail = NULL;
+        active = NULL;
+        dispatching = false;
     }
 
     /**
@@ -84,6 +98,208 @@ namespace codal
         return DEVICE_NOT_IMPLEMENTED;
     }
 
+    /**
+     * Performs the given transaction on the bus, blocking until it is complete.
+     *
+     * This is the bulk transfer hook used by the transaction queue. The default implementation issues the
+     * transaction through write() and read(). Drivers for hardware able to perform a complete write/read
+     * sequence in one operation should override this method.
+     *
+     * @param t The transaction to perform.
+     * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the transaction failed.
+     */
+    int I2C::transfer(I2CTransaction *t)
+    {
+        int result = DEVICE_OK;
+        bool repeated = (t->flags & I2C_TRANSACTION_FLAG_REPEATED_START) && t->rxSize > 0;
+
+        // Write phase. The register address (if any) must be sent in the same write as the data.
+        if (t->flags & I2C_TRANSACTION_FLAG_REGISTER)
+        {
+            if (t->txSize == 0)
+            {
+                result = write(t->address, &t->reg, 1, repeated);
+            }
+            else
+            {
+                // Small writes (the common case) are assembled on the stack. Larger ones need a temporary buffer.
+                uint8_t local[I2C_REGISTER_WRITE_BUFFER_SIZE + 1];
+                uint8_t *buffer = local;
+
+                if (t->txSize > I2C_REGISTER_WRITE_BUFFER_SIZE)
+                {
+                    buffer = (uint8_t *)malloc(t->txSize + 1);
+
+                    if (buffer == NULL)
+                        return DEVICE_NO_RESOURCES;
+                }
+
+                buffer[0] = t->reg;
+                memcpy(buffer + 1, t->txBuffer, t->txSize);
+
+                result = write(t->address, buffer, t->txSize + 1, repeated);
+
+                if (buffer != local)
+                    free(buffer);
+            }
+        }
+        else if (t->txSize)
+        {
+            result = write(t->address, (uint8_t *)t->txBuffer, t->txSize, repeated);
+        }
+
+        // Read phase.
+        if (result == DEVICE_OK && t->rxSize)
+            result = read(t->address, t->rxBuffer, t->rxSize);
+
+        return result;
+    }
+
+    /**
+     * Starts the given transaction on the bus. transferComplete() must be called once it has finished.
+     *
+     * The default implementation calls transfer(), and completes the transaction immediately.
+     * Drivers for DMA or interrupt driven hardware should override this method to start the transaction and return
+     * straight away, calling transferComplete() from their interrupt handler.
+     *
+     * @param t The transaction to start.
+     * @return DEVICE_OK on success, or an error code if the transaction could not be started.
+     */
+    int I2C::startTransfer(I2CTransaction *t)
+    {
+        transferComplete(t, transfer(t));
+        return DEVICE_OK;
+    }
+
+    /**
+     * Records the completion of the transaction currently on the bus, notifies its owner, and starts the next
+     * queued transaction (if any).
+     *
+     * @param t The transaction that has completed.
+     * @param result The result of the transaction.
+     */
+    void I2C::transferComplete(I2CTransaction *t, int result)
+    {
+        PVoidCallback handler = t->doneHandler;
+        void *arg = t->arg;
+
+        // Once the result is set, the owner is free to reuse the transaction, so take a copy of the handler first.
+        active = NULL;
+        t->result = result;
+
+        if (handler)
+            handler(arg);
+
+        dispatch();
+    }
+
+    /**
+     * Starts queued transactions until the queue is empty or a transaction is in progress.
+     */
+    void I2C::dispatch()
+    {
+        target_disable_irq();
+
+        // If we're already servicing the queue further up the stack, it will pick up any new work.
+        if (dispatching)
+        {
+            target_enable_irq();
+            return;
+        }
+
+        dispatching = true;
+
+        while (queueHead && active == NULL)
+        {
+            I2CTransaction *t = queueHead;
+
+            queueHead = t->next;
+            if (queueHead == NULL)
+                queueTail = NULL;
+
+            active = t;
+            target_enable_irq();
+
+            int result = startTransfer(t);
+
+            target_disable_irq();
+
+            if (result != DEVICE_OK && active == t)
+            {
+                target_enable_irq();
+                transferComplete(t, result);
+                target_disable_irq();
+            }
+        }
+
+        dispatching = false;
+        target_enable_irq();
+    }
+
+    /**
+     * Queues the given transaction for execution, and returns immediately.
+     *
+     * Transactions are executed in the order they are submitted. On completion, the result is stored in the
+     * transaction and its doneHandler (if any) is called, possibly in IRQ context.
+     *
+     * @param t The transaction to queue. This must remain valid until the transaction completes.
+     * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the transaction is malformed.
+     */
+    int I2C::submit(I2CTransaction *t)
+    {
+        if (t == NULL || (t->txSize && t->txBuffer == NULL) || (t->rxSize && t->rxBuffer == NULL))
+            return DEVICE_INVALID_PARAMETER;
+
+        if (t->txSize == 0 && t->rxSize == 0 && !(t->flags & I2C_TRANSACTION_FLAG_REGISTER))
+            return DEVICE_INVALID_PARAMETER;
+
+        t->next = NULL;
+        t->result = DEVICE_BUSY;
+
+        target_disable_irq();
+
+        if (queueTail)
+            queueTail->next = t;
+        else
+            queueHead = t;
+
+        queueTail = t;
+
+        target_enable_irq();
+
+        dispatch();
+
+        return DEVICE_OK;
+    }
+
+    /**
+     * Queues the given transaction for execution, and blocks the calling fiber until it is complete.
+     * Any doneHandler set on the transaction is replaced.
+     *
+     * @param t The transaction to perform.
+     * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if the transaction is malformed, or DEVICE_I2C_ERROR if the transaction failed.
+     */
+    int I2C::transact(I2CTransaction *t)
+    {
+        FiberSemaphore done;
+
+        t->doneHandler = i2c_transaction_done;
+        t->arg = &done;
+
+        int result = submit(t);
+
+        if (result != DEVICE_OK)
+            return result;
+
+        // If the scheduler isn't running, we can only wait for the hardware to complete the transaction.
+        // Spin on the semaphore itself (rather than t->result, which is set before the handler runs),
+        // so that we cannot return and destroy it while the handler is still signalling it.
+        if (done.wait() != DEVICE_OK)
+            while (done.tryWait() != DEVICE_OK);
+
+        return t->result;
+    }
+
     /**
      * Issues a standard, 2 byte I2C command write to the I2C bus.
      * This consists of:
@@ -164,7 +380,12 @@ namespace codal
         command[0] = reg;
         command[1] = value;
 
-        return write(address, command, 2);
+        I2CTransaction t;
+        t.address = address;
+        t.txBuffer = command;
+        t.txSize = 2;
+
+        return transact(&t);
     }
 
     /**
@@ -233,21 +454,17 @@ namespace codal
     */
     int I2C::readRegister(uint16_t address, uint8_t reg, uint8_t *data, int length, bool repeated)
     {
-        int result;
-
-        if (repeated)
-            result = write(address, &reg, 1, true);
-        else
-            result = write(address, reg);
-
-        if (result != DEVICE_OK)
-            return result;
+        if (data == NULL || length <= 0)
+            return DEVICE_INVALID_PARAMETER;
 
-        result = read(address, data, length);
-        if (result != DEVICE_OK)
-            return result;
+        I2CTransaction t;
+        t.address = address;
+        t.reg = reg;
+        t.flags = I2C_TRANSACTION_FLAG_REGISTER | (repeated ? I2C_TRANSACTION_FLAG_REPEATED_START : 0);
+        t.rxBuffer = data;
+        t.rxSize = length;
 
-        return DEVICE_OK;
+        return transact(&t);
     }
 
     /**
@@ -25,29 +25,58 @@ DEALINGS IN THE SOFTWARE.
 #include "SPI.h"
 #include "ErrorNo.h"
 #include "CodalFiber.h"
+#include "codal_target_hal.h"
 
 namespace codal
 {
 
+/**
+ * Constructor.
+ */
+SPI::SPI()
+{
+    queueHead = 0;
+    queueLength = 0;
+    active = false;
+    dispatching = false;
+    busOwner = NULL;
+}
+
 /**
  * Writes and reads from the SPI bus concurrently. Waits (possibly un-scheduled) for transfer to
  * finish.
  *
+ * The default implementation calls write() for each byte. Drivers for hardware with a FIFO or DMA should
+ * override it to move the whole block at once.
+ *
  * Either buffer can be NULL.
  */
 int SPI::transfer(const uint8_t *txBuffer, uint32_t txSize, uint8_t *rxBuffer, uint32_t rxSize)
 {
-    uint32_t len = txSize;
-    if (rxSize > len)
-        len = rxSize;
-    for (uint32_t i = 0; i < len; ++i)
+    uint32_t both = txSize < rxSize ? txSize : rxSize;
+    uint32_t i = 0;
+    int c;
+
+    // Handle the full duplex part of the transfer, followed by whichever of the transmit or receive phases is longer,
+    // so that we don't need to test the buffer lengths for every byte.
+    for (; i < both; ++i)
+    {
+        if ((c = write(txBuffer[i])) < 0)
+            return DEVICE_SPI_ERROR;
+        rxBuffer[i] = c;
+    }
+
+    for (; i < txSize; ++i)
+        if (write(txBuffer[i]) < 0)
+            return DEVICE_SPI_ERROR;
+
+    for (; i < rxSize; ++i)
     {
-        int c = write(i < txSize ? txBuffer[i] : 0);
-        if (c < 0)
+        if ((c = write(0)) < 0)
             return DEVICE_SPI_ERROR;
-        if (i < rxSize)
-            rxBuffer[i] = c;
+        rxBuffer[i] = c;
     }
+
     return DEVICE_OK;
 }
 
@@ -55,14 +84,183 @@ int SPI::transfer(const uint8_t *txBuffer, uint32_t txSize, uint8_t *rxBuffer, u
  * Writes and reads from the SPI bus concurrently. Finally, calls doneHandler (possibly in IRQ
  * context).
  *
+ * Transfers are queued and performed in order. A doneHandler may safely start another transfer,
+ * which is performed once the handler returns. Completion is delivered from the context that finishes
+ * the transfer (see beginTransfer()), so no fiber is created.
+ *
+ * At most SPI_TRANSFER_QUEUE_SIZE transfers may be queued at once. If the queue is full, the transfer
+ * is not queued and doneHandler will not be called.
+ *
+ * When the bus is shared, callers must hold it (see acquire()) until doneHandler has been called.
+ *
  * Either buffer can be NULL.
+ *
+ * @return DEVICE_OK on success, DEVICE_NO_RESOURCES if SPI_TRANSFER_QUEUE_SIZE transfers are already queued, or
+ * the error returned by beginTransfer() if the transfer was started straight away and failed.
  */
 int SPI::startTransfer(const uint8_t *txBuffer, uint32_t txSize, uint8_t *rxBuffer, uint32_t rxSize,
                        PVoidCallback doneHandler, void *arg)
 {
-    int r = transfer(txBuffer, txSize, rxBuffer, rxSize);
-    // it's important this doesn't get invoked recursievely, since that leads to stack overflow
-    create_fiber(doneHandler, arg);
-    return r;
+    target_disable_irq();
+
+    if (queueLength >= SPI_TRANSFER_QUEUE_SIZE)
+    {
+        target_enable_irq();
+        return DEVICE_NO_RESOURCES;
+    }
+
+    SPITransfer *t = &queue[(queueHead + queueLength) % SPI_TRANSFER_QUEUE_SIZE];
+
+    t->txBuffer = txBuffer;
+    t->txSize = txSize;
+    t->rxBuffer = rxBuffer;
+    t->rxSize = rxSize;
+    t->doneHandler = doneHandler;
+    t->arg = arg;
+
+    // If nothing else is queued or on the bus, this transfer is started by the dispatch() below.
+    bool first = (queueLength == 0 && !active && !dispatching);
+    queueLength++;
+
+    target_enable_irq();
+
+    int r = dispatch();
+
+    return first ? r : DEVICE_OK;
+}
+
+/**
+ * Starts the given queued transfer. transferComplete() must be called once it has finished.
+ *
+ * The default implementation calls transfer(), and then completes the transfer straight away, from the same
+ * context. It yields to other fibers first, so that a doneHandler that starts another transfer (as ST7735 does
+ * for each chunk of a frame) does not hold the processor for the whole chain. It must therefore be called from
+ * fiber context. Drivers for DMA or interrupt driven hardware should override this method to start the transfer
+ * and return straight away, calling transferComplete() from their interrupt handler.
+ *
+ * @param t The transfer to start.
+ * @return DEVICE_OK on success, or an error code if the transfer failed or could not be started, in which case
+ * the caller completes it.
+ */
+int SPI::beginTransfer(SPITransfer *t)
+{
+    if (fiber_scheduler_running())
+        schedule();
+
+    int r = transfer(t->txBuffer, t->txSize, t->rxBuffer, t->rxSize);
+
+    if (r != DEVICE_OK)
+        return r;
+
+    transferComplete();
+
+    return DEVICE_OK;
+}
+
+/**
+ * Records the completion of the transfer currently on the bus, calls its doneHandler, and starts the
+ * next queued transfer (if any).
+ */
+void SPI::transferComplete()
+{
+    target_disable_irq();
+
+    SPITransfer *t = &queue[queueHead];
+    PVoidCallback handler = t->doneHandler;
+    void *arg = t->arg;
+
+    // Free the slot before calling the handler, so that it can queue another transfer.
+    queueHead = (queueHead + 1) % SPI_TRANSFER_QUEUE_SIZE;
+    queueLength--;
+    active = false;
+
+    target_enable_irq();
+
+    if (handler)
+        handler(arg);
+
+    dispatch();
+}
+
+/**
+ * Starts queued transfers until the queue is empty or a transfer is in progress.
+ *
+ * Completion handlers that run inside this loop and start new transfers re-enter here, and simply return;
+ * the outermost call then starts the new transfer, so the stack depth stays constant.
+ *
+ * @return The result of the first transfer started, or DEVICE_OK if none was started.
+ */
+int SPI::dispatch()
+{
+    int result = DEVICE_OK;
+    bool started = false;
+
+    target_disable_irq();
+
+    if (dispatching)
+    {
+        target_enable_irq();
+        return DEVICE_OK;
+    }
+
+    dispatching = true;
+
+    while (queueLength && !active)
+    {
+        active = true;
+        target_enable_irq();
+
+        // If the transfer failed or couldn't be started, drop it but still let its owner know.
+        int r = beginTransfer(&queue[queueHead]);
+
+        if (!started)
+        {
+            result = r;
+            started = true;
+        }
+
+        if (r != DEVICE_OK)
+            transferComplete();
+
+        target_disable_irq();
+    }
+
+    dispatching = false;
+    target_enable_irq();
+
+    return result;
+}
+
+/**
+ * Gains exclusive use of the bus, blocking the calling fiber until any other device has released it.
+ * Used to share a bus between several devices with their own chip selects (see SPIDevice).
+ *
+ * @param owner An identifier for the device requesting the bus.
+ * @return 1 if another device has used the bus since the given owner last held it (so the frequency and mode
+ * must be reapplied), or 0 otherwise.
+ */
+int SPI::acquire(const void *owner)
+{
+    busLock.wait();
+
+    if (busOwner == owner)
+        return 0;
+
+    busOwner = owner;
+    return 1;
+}
+
+/**
+ * Releases the bus after a call to acquire(), allowing the next waiting device to use it.
+ *
+ * @param reconfigure If set, the next device to acquire the bus will be told to reapply its settings,
+ * even if it was the last owner. Defaults to false.
+ */
+void SPI::release(bool reconfigure)
+{
+    if (reconfigure)
+        busOwner = NULL;
+
+    busLock.notify();
 }
 }
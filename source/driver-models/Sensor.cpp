@@ -46,6 +46,9 @@ using namespace codal;
 Sensor::Sensor(uint16_t id, uint16_t sensitivity, uint16_t samplePeriod)
 {
     this->id = id;
+    this->minPeriod = 0;
+    this->maxPeriod = 0;
+    this->adaptiveDelta = SENSOR_ADAPTIVE_DEFAULT_DELTA;
     this->setSensitivity(sensitivity);
 
     // Configure for a 2 Hz update frequency by default.
@@ -79,11 +82,13 @@ int Sensor::getValue()
 void Sensor::updateSample()
 {
     uint32_t value = readValue();
+    uint16_t previousValue = sensorValue;
 
     // If this is the first reading performed, take it a a baseline. Otherwise, perform a decay average to smooth out the data.
     if (!(this->status & SENSOR_INITIALISED))
     {
         sensorValue = (uint16_t)value;
+        previousValue = sensorValue;
         this->status |=  SENSOR_INITIALISED;
     }
     else
@@ -92,6 +97,9 @@ void Sensor::updateSample()
     }
 
     checkThresholding();
+
+    if (this->status & SENSOR_ADAPTIVE_ENABLED)
+        adaptSamplePeriod(previousValue);
 }
 
 /**
@@ -115,6 +123,50 @@ void Sensor::checkThresholding()
     }
 }
 
+/**
+ * Adjust the sample period based on the most recent change in value, and its proximity to any thresholds.
+ *
+ * Uses a multiplicative speed up and gradual back off, so that bursts of activity are tracked quickly
+ * while a stable signal settles at the maximum period.
+ *
+ * @param previousValue the value of the sensor before the most recent sample was taken.
+ */
+void Sensor::adaptSamplePeriod(uint16_t previousValue)
+{
+    int delta = abs((int)sensorValue - (int)previousValue);
+    int distance = 0xFFFF;
+
+    // Find how far we are from the nearest threshold that could still be crossed.
+    if ((this->status & SENSOR_HIGH_THRESHOLD_ENABLED) && !(this->status & SENSOR_HIGH_THRESHOLD_PASSED))
+        distance = min(distance, max(0, (int)highThreshold - (int)sensorValue));
+
+    if ((this->status & SENSOR_LOW_THRESHOLD_ENABLED) && !(this->status & SENSOR_LOW_THRESHOLD_PASSED))
+        distance = min(distance, max(0, (int)sensorValue - (int)lowThreshold));
+
+    // Speed up if the signal is moving, or could reach a threshold within the next couple of samples.
+    int period = samplePeriod;
+
+    if (delta >= adaptiveDelta || distance <= 2 * max(delta, adaptiveDelta))
+        period = max(minPeriod, period / 2);
+    else
+        period = min(maxPeriod, period + period / 4 + 1);
+
+    if (period != samplePeriod)
+    {
+        samplePeriod = period;
+        scheduleSample();
+    }
+}
+
+/**
+ * (Re)schedule the periodic timer event that drives sampling, using the current samplePeriod.
+ */
+void Sensor::scheduleSample()
+{
+    system_timer_cancel_event(this->id, SENSOR_UPDATE_NEEDED);
+    system_timer_event_every(this->samplePeriod, this->id, SENSOR_UPDATE_NEEDED);
+}
+
 /**
  * Set sensitivity value for the data. A decay average is taken of sampled data to smooth it into more accurate information.
  *
@@ -131,6 +183,7 @@ int Sensor::setSensitivity(uint16_t value)
 
 /**
  * Set the automatic sample period of the sensor to the specified value (in ms).
+ * This disables adaptive sampling, if enabled.
  *
  * @param period the requested time between samples, in milliseconds.
  *
@@ -138,12 +191,51 @@ int Sensor::setSensitivity(uint16_t value)
  */
 int Sensor::setPeriod(int period)
 {
+    this->status &= ~SENSOR_ADAPTIVE_ENABLED;
     this->samplePeriod = period > 0 ? period : SENSOR_DEFAULT_SAMPLE_PERIOD;
-    system_timer_event_every(this->samplePeriod, this->id, SENSOR_UPDATE_NEEDED);
+    scheduleSample();
+
+    return DEVICE_OK;
+}
+
+/**
+ * Enables adaptive sampling. The sample period is halved (down to minPeriod) whenever the value changes
+ * by at least delta between samples, or is close enough to an enabled threshold that it could cross it
+ * before the next sample. Otherwise, the period grows gradually back towards maxPeriod.
+ *
+ * @param minPeriod the shortest time between samples, in milliseconds.
+ * @param maxPeriod the longest time between samples, in milliseconds.
+ * @param delta the change in value between samples that is considered significant. Defaults to SENSOR_ADAPTIVE_DEFAULT_DELTA.
+ *
+ * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if minPeriod is not positive or exceeds maxPeriod.
+ */
+int Sensor::setAdaptivePeriod(int minPeriod, int maxPeriod, uint16_t delta)
+{
+    if (minPeriod <= 0 || minPeriod > maxPeriod || maxPeriod > 0xFFFF)
+        return DEVICE_INVALID_PARAMETER;
+
+    this->minPeriod = minPeriod;
+    this->maxPeriod = maxPeriod;
+    this->adaptiveDelta = max(1, delta);
+    this->status |= SENSOR_ADAPTIVE_ENABLED;
+
+    // Start from the fastest rate, and let the period back off as the signal proves stable.
+    this->samplePeriod = minPeriod;
+    scheduleSample();
 
     return DEVICE_OK;
 }
 
+/**
+ * Determines if adaptive sampling is enabled.
+ *
+ * @return true if the sample period adapts to the signal, false if it is fixed.
+ */
+bool Sensor::isAdaptive()
+{
+    return (this->status & SENSOR_ADAPTIVE_ENABLED) != 0;
+}
+
 /**
  * Reads the currently configured sample period.
  *
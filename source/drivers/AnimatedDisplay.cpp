@@ -58,7 +58,7 @@ AnimatedDisplay::AnimatedDisplay(Display& _display, uint16_t id) : display(_disp
     animationMode = AnimationMode::ANIMATION_MODE_NONE;
     animationDelay = 0;
     animationTick = 0;
-    scrollingChar = 0;
+    scrollingStripStride = 1;
     scrollingPosition = 0;
     printingChar = 0;
     scrollingImagePosition = 0;
@@ -115,61 +115,75 @@ void AnimatedDisplay::sendAnimationCompleteEvent()
 }
 
 /**
-  * Internal scrollText update method.
-  * Shift the screen image by one pixel to the left. If necessary, paste in the next char.
+  * Lays out the given string as a strip of packed pixel columns, ready to be scrolled.
+  * Each column occupies scrollingStripStride bytes, least significant byte first, with bit n representing row n.
+  *
+  * @param s The string to render.
   */
-void AnimatedDisplay::updateScrollText()
+void AnimatedDisplay::renderScrollStrip(ManagedString s)
 {
-    /**
-    display.image.shiftLeft(1);
-    scrollingPosition++;
+    uint32_t columns[32];
+    int length = 0;
 
-    if (scrollingPosition == display.getWidth() + DISPLAY_SPACING)
-    {
-        scrollingPosition = 0;
+    scrollingStripStride = (font.height + 7) / 8;
 
-        display.image.print(scrollingChar < scrollingText.length() ? scrollingText.charAt(scrollingChar) : ' ', display.getWidth(), 0);
+    for (int i = 0; i < s.length(); i++)
+        length += font.getColumns(s.charAt(i)) + DISPLAY_SPACING;
 
-        if (scrollingChar > scrollingText.length())
-        {
-            animationMode = ANIMATION_MODE_NONE;
-            this->sendAnimationCompleteEvent();
-            return;
-        }
-        scrollingChar++;
-   }
-   **/
+    scrollingStrip = ManagedBuffer(length * scrollingStripStride);
 
-    display.image.shiftLeft(1);
+    uint8_t *p = scrollingStrip.getBytes();
 
-    if (scrollingPosition < BITMAP_FONT_WIDTH && scrollingChar < scrollingText.length())
+    for (int i = 0; i < s.length(); i++)
     {
-        const uint8_t *v = font.get(scrollingText.charAt(scrollingChar));
-        uint8_t mask = 1 << (BITMAP_FONT_WIDTH - scrollingPosition - 1);
-        uint8_t x = display.getWidth()-1;
+        int width = font.getColumns(s.charAt(i), columns);
 
-        for (int y=0; y<BITMAP_FONT_HEIGHT; y++)
-        {
-            if (*v & mask)
-                display.image.setPixelValue(x, y, 255);
+        for (int x = 0; x < width; x++)
+            for (int b = 0; b < scrollingStripStride; b++)
+                *p++ = columns[x] >> (b * 8);
 
-            v++;
-        }
+        p += DISPLAY_SPACING * scrollingStripStride;
     }
+}
+
+/**
+  * Internal scrollText update method.
+  * Shift the screen image by one pixel to the left, and paste the next column of the pre-rendered text strip
+  * into the right hand edge. Whatever was on the display beforehand scrolls off to the left ahead of the text,
+  * and the animation completes once the text has fully left the display.
+  */
+void AnimatedDisplay::updateScrollText()
+{
+    int width = display.image.getWidth();
+    int height = display.image.getHeight();
+    int columns = scrollingStrip.length() / scrollingStripStride;
+    uint8_t *bitmap = display.image.getBitmap();
+    uint32_t column = 0;
 
-    scrollingPosition++;
+    // The strip column entering the right hand edge of the display.
+    int c = scrollingPosition++;
 
-    if (scrollingPosition == display.getWidth() + DISPLAY_SPACING)
+    if (c < columns)
     {
-        scrollingPosition = 0;
+        uint8_t *p = scrollingStrip.getBytes() + c * scrollingStripStride;
 
-        if (scrollingChar >= scrollingText.length())
-        {
-            animationMode = ANIMATION_MODE_NONE;
-            this->sendAnimationCompleteEvent();
-            return;
-        }
-        scrollingChar++;
+        for (int b = 0; b < scrollingStripStride; b++)
+            column |= (uint32_t) p[b] << (b * 8);
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        uint8_t *row = bitmap + y * width;
+
+        memmove(row, row + 1, width - 1);
+        row[width - 1] = y < font.height && (column >> y) & 1 ? 255 : 0;
+    }
+
+    if (scrollingPosition - width >= columns)
+    {
+        scrollingStrip = ManagedBuffer();
+        animationMode = ANIMATION_MODE_NONE;
+        this->sendAnimationCompleteEvent();
     }
 }
 
@@ -571,9 +585,8 @@ int AnimatedDisplay::scrollAsync(ManagedString s, int delay)
     // If the display is free, it's our turn to display.
     if (animationMode == ANIMATION_MODE_NONE || animationMode == ANIMATION_MODE_STOPPED)
     {
+        renderScrollStrip(s);
         scrollingPosition = 0;
-        scrollingChar = 0;
-        scrollingText = s;
 
         animationDelay = delay;
         animationTick = 0;
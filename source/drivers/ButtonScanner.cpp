@@ -0,0 +1,310 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "ButtonScanner.h"
+#include "Timer.h"
+#include "ErrorNo.h"
+#include "codal_target_hal.h"
+
+using namespace codal;
+
+/**
+ * Constructor.
+ *
+ * @param id The id of this component. Defaults to DEVICE_ID_BUTTON_SCANNER. Events are raised using the id of each button.
+ */
+ButtonScanner::ButtonScanner(uint16_t id)
+{
+    this->id = id;
+
+    portPin = NULL;
+    rowCount = 0;
+    columnCount = 0;
+    buttonCount = 0;
+    matrixStart = 0;
+
+    activeHigh = 0;
+    allEvents = 0;
+    state = 0;
+    holdTriggered = 0;
+
+    // All vertical counters start in their reset state.
+    count0 = 0xFFFFFFFF;
+    count1 = 0xFFFFFFFF;
+
+    for (int i = 0; i < BUTTON_SCANNER_MAX_BUTTONS; i++)
+    {
+        pins[i] = NULL;
+        portMask[i] = 0;
+    }
+
+    status |= DEVICE_COMPONENT_RUNNING | DEVICE_COMPONENT_STATUS_SYSTEM_TICK;
+}
+
+/**
+ * Includes the given pin in the port group if possible.
+ * Pins on the same port as the first port-capable input are grouped. Any others are read individually.
+ *
+ * @return the bit of the pin within a port read, or 0 if it must be read individually.
+ */
+uint32_t ButtonScanner::groupPin(Pin *pin)
+{
+    int port = pin->getPort();
+
+    if (port < 0)
+        return 0;
+
+    if (portPin == NULL)
+        portPin = pin;
+
+    return port == portPin->getPort() ? pin->getPortMask() : 0;
+}
+
+/**
+ * Adds a button connected directly to a pin.
+ *
+ * @param pin The pin the button is connected to.
+ * @param id The id used for events raised by this button.
+ * @param eventConfiguration The events to raise. Defaults to DEVICE_BUTTON_ALL_EVENTS.
+ * @param polarity Whether the button is pressed when the pin is high or low. Defaults to ACTIVE_LOW.
+ * @param mode The pull to apply to the pin. Defaults to PullMode::None.
+ *
+ * @return the index of the button on success, or DEVICE_NO_RESOURCES if the scanner is full.
+ */
+int ButtonScanner::addButton(Pin &pin, uint16_t id, ButtonEventConfiguration eventConfiguration, ButtonPolarity polarity, PullMode mode)
+{
+    if (buttonCount >= BUTTON_SCANNER_MAX_BUTTONS)
+        return DEVICE_NO_RESOURCES;
+
+    int i = buttonCount;
+
+    // Put the pin into input mode with the requested pull.
+    pin.setPull(mode);
+    pin.getDigitalValue();
+
+    pins[i] = &pin;
+    portMask[i] = groupPin(&pin);
+    ids[i] = id;
+    downStartTime[i] = 0;
+
+    if (polarity == ACTIVE_HIGH)
+        activeHigh |= 1UL << i;
+
+    if (eventConfiguration == DEVICE_BUTTON_ALL_EVENTS)
+        allEvents |= 1UL << i;
+
+    buttonCount++;
+
+    return i;
+}
+
+/**
+ * Adds a keypad matrix. Each row is driven low in turn, and the columns (which have pull ups enabled) read
+ * to determine which keys in that row are pressed. Diodes are needed on each key to avoid ghosting if
+ * several keys may be pressed at once.
+ *
+ * @param rows The row pins.
+ * @param rowCount The number of row pins.
+ * @param columns The column pins.
+ * @param columnCount The number of column pins.
+ * @param ids The event id of each key, in row major order (rowCount * columnCount entries).
+ * @param eventConfiguration The events to raise. Defaults to DEVICE_BUTTON_ALL_EVENTS.
+ *
+ * @return DEVICE_OK on success, DEVICE_INVALID_STATE if a matrix has already been added,
+ *         DEVICE_INVALID_PARAMETER if there are too many rows or columns, or DEVICE_NO_RESOURCES if the scanner is full.
+ */
+int ButtonScanner::addMatrix(Pin **rows, int rowCount, Pin **columns, int columnCount, const uint16_t *ids, ButtonEventConfiguration eventConfiguration)
+{
+    if (this->rowCount)
+        return DEVICE_INVALID_STATE;
+
+    if (rowCount <= 0 || columnCount <= 0 || rowCount > BUTTON_SCANNER_MAX_MATRIX_PINS || columnCount > BUTTON_SCANNER_MAX_MATRIX_PINS)
+        return DEVICE_INVALID_PARAMETER;
+
+    if (buttonCount + rowCount * columnCount > BUTTON_SCANNER_MAX_BUTTONS)
+        return DEVICE_NO_RESOURCES;
+
+    // Rows are left floating (as inputs) until they are scanned.
+    for (int r = 0; r < rowCount; r++)
+    {
+        this->rows[r] = rows[r];
+        rows[r]->getDigitalValue();
+    }
+
+    for (int c = 0; c < columnCount; c++)
+    {
+        this->columns[c] = columns[c];
+        columns[c]->setPull(PullMode::Up);
+        columns[c]->getDigitalValue();
+        columnMask[c] = groupPin(columns[c]);
+    }
+
+    this->rowCount = rowCount;
+    this->columnCount = columnCount;
+    matrixStart = buttonCount;
+
+    for (int i = 0; i < rowCount * columnCount; i++)
+    {
+        this->ids[buttonCount] = ids[i];
+        downStartTime[buttonCount] = 0;
+
+        if (eventConfiguration == DEVICE_BUTTON_ALL_EVENTS)
+            allEvents |= 1UL << buttonCount;
+
+        buttonCount++;
+    }
+
+    return DEVICE_OK;
+}
+
+/**
+ * Samples every button once.
+ *
+ * @return a bit mask with bit n set if button n is instantaneously pressed.
+ */
+uint32_t ButtonScanner::sample()
+{
+    uint32_t pressed = 0;
+    uint32_t port = portPin ? portPin->readPort() : 0;
+
+    for (int i = 0; i < buttonCount; i++)
+    {
+        if (pins[i] == NULL)
+            continue;
+
+        int level = portMask[i] ? (port & portMask[i]) != 0 : pins[i]->getDigitalValue();
+
+        if (level == (int)((activeHigh >> i) & 1))
+            pressed |= 1UL << i;
+    }
+
+    int key = matrixStart;
+
+    for (int r = 0; r < rowCount; r++)
+    {
+        rows[r]->setDigitalValue(0);
+        target_wait_us(BUTTON_SCANNER_SETTLE_TIME);
+
+        port = portPin ? portPin->readPort() : 0;
+
+        for (int c = 0; c < columnCount; c++, key++)
+        {
+            int level = columnMask[c] ? (port & columnMask[c]) != 0 : columns[c]->getDigitalValue();
+
+            if (level == 0)
+                pressed |= 1UL << key;
+        }
+
+        // Release the row, so it cannot interfere with the next.
+        rows[r]->getDigitalValue();
+    }
+
+    return pressed;
+}
+
+/**
+ * Periodic callback from the system timer. Samples and debounces all buttons, and raises any events.
+ */
+void ButtonScanner::periodicCallback()
+{
+    if (!(status & DEVICE_COMPONENT_RUNNING) || buttonCount == 0)
+        return;
+
+    //
+    // Two bit vertical counter debounce. Each button has a counter held across count0/count1, which is
+    // reset whenever its sample matches its debounced state, and otherwise counts up. The debounced state
+    // only toggles when the counter rolls over, i.e. after four consecutive samples that disagree with it.
+    //
+    uint32_t delta = sample() ^ state;
+
+    count0 = ~(count0 & delta);
+    count1 = count0 ^ (count1 & delta);
+
+    uint32_t changed = delta & count0 & count1;
+    state ^= changed;
+
+    if ((changed | (state & ~holdTriggered)) == 0)
+        return;
+
+    unsigned long now = system_timer_current_time();
+
+    for (int i = 0; i < buttonCount; i++)
+    {
+        uint32_t bit = 1UL << i;
+
+        if (changed & bit)
+        {
+            if (state & bit)
+            {
+                Event evt(ids[i], DEVICE_BUTTON_EVT_DOWN);
+                downStartTime[i] = now;
+                holdTriggered &= ~bit;
+            }
+            else
+            {
+                Event evt(ids[i], DEVICE_BUTTON_EVT_UP);
+
+                if (allEvents & bit)
+                {
+                    if ((now - downStartTime[i]) >= DEVICE_BUTTON_LONG_CLICK_TIME)
+                        Event evt(ids[i], DEVICE_BUTTON_EVT_LONG_CLICK);
+                    else
+                        Event evt(ids[i], DEVICE_BUTTON_EVT_CLICK);
+                }
+            }
+        }
+        else if ((state & bit) && !(holdTriggered & bit) && (now - downStartTime[i]) >= DEVICE_BUTTON_HOLD_TIME)
+        {
+            holdTriggered |= bit;
+            Event evt(ids[i], DEVICE_BUTTON_EVT_HOLD);
+        }
+    }
+}
+
+/**
+ * Tests if the button with the given id is currently pressed.
+ *
+ * @param id The event id of the button.
+ *
+ * @return 1 if the button is pressed, 0 if not, or DEVICE_INVALID_PARAMETER if no button has the given id.
+ */
+int ButtonScanner::isPressed(uint16_t id)
+{
+    for (int i = 0; i < buttonCount; i++)
+        if (ids[i] == id)
+            return (state >> i) & 1;
+
+    return DEVICE_INVALID_PARAMETER;
+}
+
+/**
+ * Determines the debounced state of every button.
+ *
+ * @return a bit mask with bit n set if button n is pressed, in the order buttons were added.
+ */
+uint32_t ButtonScanner::getState()
+{
+    return state;
+}
@@ -0,0 +1,352 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "EdgeCapture.h"
+#include "EventModel.h"
+#include "Timer.h"
+#include "CodalCompat.h"
+#include "ErrorNo.h"
+
+using namespace codal;
+
+/**
+ * Constructor.
+ *
+ * @param pin The pin to capture edges from.
+ * @param id The id to use for events raised by this component. Defaults to DEVICE_ID_EDGE_CAPTURE.
+ */
+EdgeCapture::EdgeCapture(Pin &p, uint16_t id) : pin(p)
+{
+    this->id = id;
+    this->status = 0;
+
+    head = 0;
+    tail = 0;
+    lastEdge = 0;
+    haveEdge = false;
+    highWidth = 0;
+    lowWidth = 0;
+    dropped = 0;
+
+    for (int i = 0; i < EDGE_CAPTURE_MAX_DECODERS; i++)
+        decoders[i] = NULL;
+
+    downstream = NULL;
+    outputLength = 0;
+}
+
+/**
+ * Begin capturing edges. The pin is configured as a digital input generating edge events.
+ *
+ * @return DEVICE_OK on success.
+ */
+int EdgeCapture::enable()
+{
+    if (status & EDGE_CAPTURE_STATUS_ENABLED)
+        return DEVICE_OK;
+
+    if (EventModel::defaultEventBus == NULL)
+        return DEVICE_NOT_SUPPORTED;
+
+    if (!(status & EDGE_CAPTURE_STATUS_LISTENING))
+        EventModel::defaultEventBus->listen(id, EDGE_CAPTURE_EVT_DATA, this, &EdgeCapture::onData);
+
+    // The first edge after enabling has no meaningful duration.
+    haveEdge = false;
+
+    // The status flags are shared with the pin IRQ.
+    target_disable_irq();
+    status |= EDGE_CAPTURE_STATUS_LISTENING | EDGE_CAPTURE_STATUS_ENABLED;
+    target_enable_irq();
+
+    // Edges are timestamped and queued directly from the pin IRQ.
+    EventModel::defaultEventBus->listen(pin.id, DEVICE_PIN_EVT_RISE, this, &EdgeCapture::onEdge, MESSAGE_BUS_LISTENER_IMMEDIATE);
+    EventModel::defaultEventBus->listen(pin.id, DEVICE_PIN_EVT_FALL, this, &EdgeCapture::onEdge, MESSAGE_BUS_LISTENER_IMMEDIATE);
+    pin.eventOn(DEVICE_PIN_EVENT_ON_EDGE);
+
+    return DEVICE_OK;
+}
+
+/**
+ * Stop capturing edges, and turn off edge events on the pin. Edges already captured are still processed.
+ *
+ * @return DEVICE_OK on success.
+ */
+int EdgeCapture::disable()
+{
+    if (!(status & EDGE_CAPTURE_STATUS_ENABLED))
+        return DEVICE_OK;
+
+    pin.eventOn(DEVICE_PIN_EVENT_NONE);
+
+    EventModel::defaultEventBus->ignore(pin.id, DEVICE_PIN_EVT_RISE, this, &EdgeCapture::onEdge);
+    EventModel::defaultEventBus->ignore(pin.id, DEVICE_PIN_EVT_FALL, this, &EdgeCapture::onEdge);
+
+    target_disable_irq();
+    status &= ~EDGE_CAPTURE_STATUS_ENABLED;
+    target_enable_irq();
+
+    return DEVICE_OK;
+}
+
+/**
+ * Event handler called from the pin IRQ for each edge.
+ * Kept as short as possible: the edge is timestamped and queued, and the first edge of a batch schedules processing.
+ */
+void EdgeCapture::onEdge(Event e)
+{
+#if CONFIG_ENABLED(LIGHTWEIGHT_EVENTS)
+    uint32_t t = (uint32_t) system_timer_current_time_us();
+#else
+    uint32_t t = (uint32_t) e.timestamp;
+#endif
+    uint16_t next = (head + 1) & (EDGE_CAPTURE_BUFFER_SIZE - 1);
+
+    if (next == tail)
+    {
+        dropped++;
+        status |= EDGE_CAPTURE_STATUS_OVERFLOW;
+    }
+    else
+    {
+        buffer[head] = (t << 1) | (e.value == DEVICE_PIN_EVT_RISE ? 1 : 0);
+        head = next;
+    }
+
+    if (!(status & EDGE_CAPTURE_STATUS_PENDING))
+    {
+        status |= EDGE_CAPTURE_STATUS_PENDING;
+        Event(id, EDGE_CAPTURE_EVT_DATA);
+    }
+}
+
+/**
+ * Event handler that processes captured edges in fiber context.
+ * Drains the capture buffer, updating the pulse measurements, running any decoders and queuing edges for a connected DataSink.
+ */
+void EdgeCapture::onData(Event)
+{
+    bool pulse = false;
+    bool overflow = false;
+
+    while (true)
+    {
+        target_disable_irq();
+
+        if (tail == head)
+        {
+            overflow = status & EDGE_CAPTURE_STATUS_OVERFLOW;
+            status &= ~(EDGE_CAPTURE_STATUS_PENDING | EDGE_CAPTURE_STATUS_OVERFLOW);
+            target_enable_irq();
+            break;
+        }
+
+        uint32_t edge = buffer[tail];
+        tail = (tail + 1) & (EDGE_CAPTURE_BUFFER_SIZE - 1);
+
+        target_enable_irq();
+
+        int level = EDGE_CAPTURE_LEVEL(edge);
+        uint32_t duration = haveEdge ? EDGE_CAPTURE_ELAPSED(lastEdge, edge) : 0;
+
+        lastEdge = edge;
+        haveEdge = true;
+
+        if (duration)
+        {
+            // A rising edge ends a low period and completes a pulse, a falling edge ends a high period.
+            if (level)
+            {
+                lowWidth = duration;
+                pulse |= highWidth != 0;
+            }
+            else
+            {
+                highWidth = duration;
+            }
+        }
+
+        for (int i = 0; i < EDGE_CAPTURE_MAX_DECODERS; i++)
+            if (decoders[i])
+                decoders[i]->decode(level, duration);
+
+        if (downstream && outputLength < EDGE_CAPTURE_STREAM_BUFFER_SIZE)
+            ((uint32_t *)output.getBytes())[outputLength++] = edge;
+    }
+
+    if (pulse)
+        Event(id, EDGE_CAPTURE_EVT_PULSE);
+
+    if (overflow)
+        Event(id, EDGE_CAPTURE_EVT_OVERFLOW);
+
+    if (downstream && outputLength)
+        downstream->pullRequest();
+}
+
+/**
+ * Attach a decoder, to be run over every captured edge.
+ *
+ * @param decoder The decoder to add.
+ *
+ * @return DEVICE_OK on success, or DEVICE_NO_RESOURCES if EDGE_CAPTURE_MAX_DECODERS are already attached.
+ */
+int EdgeCapture::addDecoder(EdgeDecoder &decoder)
+{
+    for (int i = 0; i < EDGE_CAPTURE_MAX_DECODERS; i++)
+    {
+        if (decoders[i] == NULL)
+        {
+            decoders[i] = &decoder;
+            return DEVICE_OK;
+        }
+    }
+
+    return DEVICE_NO_RESOURCES;
+}
+
+/**
+ * Detach a previously added decoder.
+ *
+ * @param decoder The decoder to remove.
+ *
+ * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the decoder was not attached.
+ */
+int EdgeCapture::removeDecoder(EdgeDecoder &decoder)
+{
+    for (int i = 0; i < EDGE_CAPTURE_MAX_DECODERS; i++)
+    {
+        if (decoders[i] == &decoder)
+        {
+            decoders[i] = NULL;
+            return DEVICE_OK;
+        }
+    }
+
+    return DEVICE_INVALID_PARAMETER;
+}
+
+/**
+ * Determines the width of the most recent high pulse.
+ *
+ * @return The width of the pulse in microseconds, or 0 if no pulse has been measured.
+ */
+int EdgeCapture::getPulseWidth()
+{
+    return highWidth;
+}
+
+/**
+ * Determines the period of the most recent complete high and low pulse.
+ *
+ * @return The period in microseconds, or 0 if no pulse has been measured.
+ */
+int EdgeCapture::getPeriod()
+{
+    if (highWidth == 0 || lowWidth == 0)
+        return 0;
+
+    return highWidth + lowWidth;
+}
+
+/**
+ * Determines the duty cycle of the most recent complete high and low pulse.
+ *
+ * @return The proportion of the period spent high, in tenths of a percent (0..1000), or 0 if no pulse has been measured.
+ */
+int EdgeCapture::getDutyCycle()
+{
+    int period = getPeriod();
+
+    if (period == 0)
+        return 0;
+
+    return (int)(((uint64_t)highWidth * 1000) / period);
+}
+
+/**
+ * Determines the number of edges lost because the capture buffer was full.
+ *
+ * @return The number of edges dropped since the last call to this method.
+ */
+int EdgeCapture::getDropped()
+{
+    target_disable_irq();
+    int d = dropped;
+    dropped = 0;
+    target_enable_irq();
+
+    return d;
+}
+
+/**
+ * Provide the next available buffer of captured edges to a connected DataSink.
+ */
+ManagedBuffer EdgeCapture::pull()
+{
+    ManagedBuffer b = output.slice(0, outputLength * sizeof(uint32_t));
+    outputLength = 0;
+
+    return b;
+}
+
+/**
+ * Connect a DataSink, which will be passed captured edges as they are processed.
+ */
+void EdgeCapture::connect(DataSink &sink)
+{
+    output = ManagedBuffer(EDGE_CAPTURE_STREAM_BUFFER_SIZE * sizeof(uint32_t), BufferInitialize::None);
+    outputLength = 0;
+    downstream = &sink;
+}
+
+/**
+ * Disconnect the DataSink, if any.
+ */
+void EdgeCapture::disconnect()
+{
+    downstream = NULL;
+    output = ManagedBuffer();
+    outputLength = 0;
+}
+
+/**
+ * Edges are provided as unsigned 32 bit values.
+ */
+int EdgeCapture::getFormat()
+{
+    return DATASTREAM_FORMAT_32BIT_UNSIGNED;
+}
+
+/**
+ * Destructor.
+ */
+EdgeCapture::~EdgeCapture()
+{
+    disable();
+
+    if (status & EDGE_CAPTURE_STATUS_LISTENING)
+        EventModel::defaultEventBus->ignore(id, EDGE_CAPTURE_EVT_DATA, this, &EdgeCapture::onData);
+}
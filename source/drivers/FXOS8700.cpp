@@ -42,18 +42,18 @@ using namespace codal;
 // Configuration table for available g force ranges.
 // Maps g -> XYZ_DATA_CFG bit [0..1]
 //
-static const KeyValueTableEntry accelerometerRangeData[] = {
+static constexpr KeyValueTableEntry accelerometerRangeData[] = {
     {2,0},
     {4,1},
     {8,2}
 };
-CREATE_KEY_VALUE_TABLE(accelerometerRange, accelerometerRangeData);
+CREATE_CHECKED_KEY_VALUE_TABLE(accelerometerRange, accelerometerRangeData);
 
 //
 // Configuration table for available data update frequency.
 // maps microsecond period -> CTRL_REG1 data rate selection bits [3..5]
 //
-static const KeyValueTableEntry accelerometerPeriodData[] = {
+static constexpr KeyValueTableEntry accelerometerPeriodData[] = {
     {2500,0x00},
     {5000,0x08},
     {10000,0x10},
@@ -63,7 +63,7 @@ static const KeyValueTableEntry accelerometerPeriodData[] = {
     {320000,0x30},
     {1280000,0x38}
 };
-CREATE_KEY_VALUE_TABLE(accelerometerPeriod, accelerometerPeriodData);
+CREATE_CHECKED_KEY_VALUE_TABLE(accelerometerPeriod, accelerometerPeriodData);
 
 
 /**
@@ -0,0 +1,526 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "FlashLog.h"
+#include "CodalCompat.h"
+#include "ErrorNo.h"
+
+using namespace codal;
+
+/**
+ * Constructor.
+ *
+ * The flash is not accessed until the log is first used.
+ *
+ * @param flash The flash device holding the log.
+ * @param start The address of the region to use. Must be aligned to SPIFLASH_SMALL_ROW_SIZE.
+ * @param length The size of the region to use, in bytes. Must span at least two small rows.
+ */
+FlashLog::FlashLog(SPIFlash &flash, uint32_t start, uint32_t length) : flash(flash)
+{
+    this->start = start;
+    this->sectorCount = length / SPIFLASH_SMALL_ROW_SIZE;
+    this->sequence = 0;
+    this->head = 0;
+    this->tail = 0;
+    this->page = 0;
+    this->length = 0;
+    this->status = 0;
+}
+
+/**
+ * Reads the header of the given sector.
+ *
+ * @return true if the header is valid.
+ */
+bool FlashLog::readSector(int sector, FlashLogSector &header)
+{
+    if (flash.readBytes(start + sector * SPIFLASH_SMALL_ROW_SIZE, &header, sizeof(header)) != DEVICE_OK)
+        return false;
+
+    return header.magic == FLASH_LOG_MAGIC && header.crc == crc32(&header, sizeof(header) - sizeof(header.crc));
+}
+
+/**
+ * Determines if the given page of the head sector has been written.
+ */
+bool FlashLog::pageUsed(int p)
+{
+    FlashLogPage header;
+
+    if (flash.readBytes(pageAddress(head, p), &header, sizeof(header)) != DEVICE_OK)
+        return true;
+
+    return header.length != 0xFFFF || header.check != 0xFFFF;
+}
+
+/**
+ * Locates the write position in flash, formatting the region if it does not hold a log.
+ */
+int FlashLog::mount()
+{
+    FlashLogSector first, header;
+    int pages = SPIFLASH_SMALL_ROW_PAGES;
+
+    if (sectorCount < 2)
+        return DEVICE_INVALID_PARAMETER;
+
+    if (readSector(0, first))
+    {
+        // Sectors are opened in order, so those written since sector 0 form a run of consecutive sequence numbers.
+        // Binary search for the end of the run.
+        int lo = 0;
+        int hi = sectorCount;
+
+        while (hi - lo > 1)
+        {
+            int mid = (lo + hi) / 2;
+
+            if (readSector(mid, header) && header.sequence == first.sequence + mid)
+                lo = mid;
+            else
+                hi = mid;
+        }
+
+        head = lo;
+        sequence = first.sequence + lo;
+    }
+    else if (readSector(sectorCount - 1, header))
+    {
+        // Sector 0 was being reopened when power was lost.
+        head = sectorCount - 1;
+        sequence = header.sequence;
+    }
+    else
+    {
+        // No log is present, so format the region.
+        return format();
+    }
+
+    // The oldest sector normally follows the head. If it does not hold the expected sequence number, the log has not
+    // yet filled the region (and starts at sector 0), or power was lost as the sector after the head was reopened.
+    tail = (head + 1) % sectorCount;
+
+    if (!readSector(tail, header) || header.sequence != sequence - (sectorCount - 1))
+    {
+        int next = (head + 2) % sectorCount;
+
+        if (readSector(next, header) && header.sequence == sequence - age(next))
+            tail = next;
+        else
+            tail = 0;
+    }
+
+    // Pages are also written in order, so binary search for the first unused page of the head sector.
+    int lo = -1;
+    int hi = pages;
+
+    while (hi - lo > 1)
+    {
+        int mid = (lo + hi) / 2;
+
+        if (pageUsed(mid))
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    page = hi;
+    length = 0;
+    status |= FLASH_LOG_STATUS_MOUNTED;
+
+    return DEVICE_OK;
+}
+
+/**
+ * Starts a new, empty log in sector 0.
+ */
+int FlashLog::format()
+{
+    head = sectorCount - 1;
+    sequence = 0;
+    status |= FLASH_LOG_STATUS_MOUNTED;
+
+    int r = openSector();
+    tail = head;
+
+    return r;
+}
+
+/**
+ * Erases the sector after the head, and makes it the new head.
+ */
+int FlashLog::openSector()
+{
+    FlashLogSector header;
+    int sector = (head + 1) % sectorCount;
+    uint32_t address = start + sector * SPIFLASH_SMALL_ROW_SIZE;
+
+    int r = flash.eraseSmallRow(address);
+    if (r != DEVICE_OK)
+        return r;
+
+    // The oldest records are lost once the log wraps around.
+    if (sector == tail)
+        tail = (tail + 1) % sectorCount;
+
+    header.magic = FLASH_LOG_MAGIC;
+    header.sequence = sequence + 1;
+    header.crc = crc32(&header, sizeof(header) - sizeof(header.crc));
+
+    r = flash.writeBytes(address, &header, sizeof(header));
+    if (r != DEVICE_OK)
+        return r;
+
+    head = sector;
+    sequence++;
+    page = 0;
+    length = 0;
+
+    return DEVICE_OK;
+}
+
+/**
+ * Writes the page being filled to flash, and moves on to the next page.
+ */
+int FlashLog::writePage()
+{
+    FlashLogPage *header = (FlashLogPage *)buffer;
+
+    if (length == 0)
+        return DEVICE_OK;
+
+    header->length = length;
+    header->check = ~length;
+    header->crc = crc32(buffer + sizeof(FlashLogPage), length);
+
+    int r = flash.writeBytes(pageAddress(head, page), buffer, sizeof(FlashLogPage) + length);
+
+    // The page is not reused, even if the write failed, as it may have been partially programmed.
+    page++;
+    length = 0;
+
+    return r;
+}
+
+/**
+ * Appends a record to the log.
+ *
+ * @param data The record to append.
+ * @param len The length of the record, in bytes. At most FLASH_LOG_MAX_RECORD_SIZE.
+ *
+ * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if the length is invalid, or the error reported by the flash device.
+ */
+int FlashLog::append(const void *data, int len)
+{
+    int r = DEVICE_OK;
+
+    if (len <= 0 || len > (int)FLASH_LOG_MAX_RECORD_SIZE)
+        return DEVICE_INVALID_PARAMETER;
+
+    lock.wait();
+
+    if (!(status & FLASH_LOG_STATUS_MOUNTED))
+        r = mount();
+
+    if (r == DEVICE_OK && length + 1 + len > pageCapacity(page))
+        r = writePage();
+
+    if (r == DEVICE_OK && page >= SPIFLASH_SMALL_ROW_PAGES)
+        r = openSector();
+
+    if (r == DEVICE_OK)
+    {
+        uint8_t *record = buffer + sizeof(FlashLogPage) + length;
+
+        record[0] = len;
+        memcpy(record + 1, data, len);
+        length += 1 + len;
+
+        // Program the page as soon as there is no room for another record.
+        if (length + 2 > pageCapacity(page))
+            r = writePage();
+    }
+
+    lock.notify();
+
+    return r;
+}
+
+/**
+ * Writes any records held in RAM to flash.
+ *
+ * @return DEVICE_OK on success, or the error reported by the flash device.
+ */
+int FlashLog::flush()
+{
+    lock.wait();
+    int r = writePage();
+    lock.notify();
+
+    return r;
+}
+
+/**
+ * Discards all records in the log.
+ *
+ * @return DEVICE_OK on success, or the error reported by the flash device.
+ */
+int FlashLog::clear()
+{
+    int r = DEVICE_OK;
+
+    if (sectorCount < 2)
+        return DEVICE_INVALID_PARAMETER;
+
+    lock.wait();
+
+    // Invalidate the log before erasing the rest of it. mount() only finds a log through sector 0 or the last
+    // sector, so once both are erased an interrupted clear is formatted on the next mount rather than reloaded.
+    r = flash.eraseSmallRow(start);
+
+    for (int i = sectorCount - 1; i > 0 && r == DEVICE_OK; i--)
+        r = flash.eraseSmallRow(start + i * SPIFLASH_SMALL_ROW_SIZE);
+
+    if (r == DEVICE_OK)
+        r = format();
+
+    lock.notify();
+
+    return r;
+}
+
+/**
+ * Determines the number of bytes of flash available to the log, including the space used by its headers.
+ */
+uint32_t FlashLog::getCapacity()
+{
+    return sectorCount * SPIFLASH_SMALL_ROW_SIZE;
+}
+
+/**
+ * Destructor.
+ *
+ * Any records held in RAM are written to flash.
+ */
+FlashLog::~FlashLog()
+{
+    flush();
+}
+
+/**
+ * Constructor.
+ *
+ * @param log The log to read. Reading begins with the oldest record.
+ */
+FlashLogReader::FlashLogReader(FlashLog &log) : log(log)
+{
+    downstream = NULL;
+    rewind();
+}
+
+/**
+ * Moves back to the oldest record in the log.
+ */
+void FlashLogReader::rewind()
+{
+    log.lock.wait();
+
+    if (!(log.status & FLASH_LOG_STATUS_MOUNTED))
+        log.mount();
+
+    sector = log.tail;
+    sequence = log.sequence - log.age(log.tail);
+    page = 0;
+    offset = 0;
+    cached = -1;
+
+    log.lock.notify();
+}
+
+/**
+ * Moves to the next record, if not already positioned on one.
+ * The log must be locked by the caller.
+ *
+ * @return a pointer to the length byte of the record, or NULL if there are no more records.
+ */
+const uint8_t *FlashLogReader::next()
+{
+    if (!(log.status & FLASH_LOG_STATUS_MOUNTED) && log.mount() != DEVICE_OK)
+        return NULL;
+
+    // If the sector being read has been reused, continue from the oldest remaining records.
+    if (log.sequence - sequence > log.age(log.tail))
+    {
+        sector = log.tail;
+        sequence = log.sequence - log.age(log.tail);
+        page = 0;
+        offset = 0;
+        cached = -1;
+    }
+
+    while (true)
+    {
+        const uint8_t *records;
+        int available;
+
+        if (sequence == log.sequence && page == log.page)
+        {
+            // Reading the page still being filled.
+            records = log.buffer + sizeof(FlashLogPage);
+            available = log.length;
+        }
+        else
+        {
+            if (cached < 0)
+            {
+                FlashLogPage *header = (FlashLogPage *)cache;
+                int capacity = FlashLog::pageCapacity(page);
+
+                cached = 0;
+
+                if (log.flash.readBytes(log.pageAddress(sector, page), cache, sizeof(FlashLogPage) + capacity) == DEVICE_OK &&
+                    header->check == (uint16_t)~header->length && header->length <= capacity &&
+                    header->crc == crc32(cache + sizeof(FlashLogPage), header->length))
+                    cached = header->length;
+            }
+
+            records = cache + sizeof(FlashLogPage);
+            available = cached;
+        }
+
+        if (offset < available)
+            return records + offset;
+
+        // There is nothing more to read until the log is appended to.
+        if (sequence == log.sequence && (page >= log.page || page == SPIFLASH_SMALL_ROW_PAGES - 1))
+            return NULL;
+
+        offset = 0;
+        cached = -1;
+
+        if (++page == SPIFLASH_SMALL_ROW_PAGES)
+        {
+            page = 0;
+            sector = (sector + 1) % log.sectorCount;
+            sequence++;
+        }
+    }
+}
+
+/**
+ * Reads the next record.
+ *
+ * @param data The buffer to copy the record into.
+ * @param len The size of the buffer. Longer records are truncated.
+ *
+ * @return The length of the record, or DEVICE_NO_DATA if there are no more records.
+ */
+int FlashLogReader::read(void *data, int len)
+{
+    int result = DEVICE_NO_DATA;
+
+    log.lock.wait();
+
+    const uint8_t *record = next();
+
+    if (record)
+    {
+        result = record[0];
+        memcpy(data, record + 1, min(len, result));
+        offset += 1 + result;
+    }
+
+    log.lock.notify();
+
+    return result;
+}
+
+/**
+ * Determines if there are any more records to read.
+ */
+bool FlashLogReader::available()
+{
+    log.lock.wait();
+    bool result = next() != NULL;
+    log.lock.notify();
+
+    return result;
+}
+
+/**
+ * Provide the next record to our downstream caller, or an empty buffer if there are no more records.
+ */
+ManagedBuffer FlashLogReader::pull()
+{
+    uint8_t record[FLASH_LOG_MAX_RECORD_SIZE];
+
+    int len = read(record, sizeof(record));
+
+    if (len < 0)
+        return ManagedBuffer();
+
+    if (downstream && available())
+        downstream->pullRequest();
+
+    return ManagedBuffer(record, len);
+}
+
+/**
+ * Allow our downstream component to register itself with us.
+ * Our downstream component is notified if any records are available.
+ */
+void FlashLogReader::connect(DataSink &sink)
+{
+    downstream = &sink;
+
+    if (available())
+        downstream->pullRequest();
+}
+
+/**
+ * Remove our downstream component.
+ */
+void FlashLogReader::disconnect()
+{
+    downstream = NULL;
+}
+
+/**
+ *  Determine the data format of the buffers streamed out of this component.
+ */
+int FlashLogReader::getFormat()
+{
+    return DATASTREAM_FORMAT_8BIT_UNSIGNED;
+}
+
+/**
+ * Defines the data format of the buffers streamed out of this component.
+ * Only DATASTREAM_FORMAT_8BIT_UNSIGNED is supported.
+ */
+int FlashLogReader::setFormat(int format)
+{
+    return format == DATASTREAM_FORMAT_8BIT_UNSIGNED ? DEVICE_OK : DEVICE_NOT_SUPPORTED;
+}
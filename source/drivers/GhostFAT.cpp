@@ -211,15 +211,51 @@ void GhostFAT::readDirData(uint8_t *dest, int blkno, uint8_t dirid)
     }
 }
 
-#define WRITE_ENT(v)                                                                               \
-    do                                                                                             \
-    {                                                                                              \
-        if (skip++ >= 0)                                                                           \
-            *dest++ = v;                                                                           \
-        if (skip >= 256)                                                                           \
-            return;                                                                                \
-        cl++;                                                                                      \
-    } while (0)
+// locate the entry holding the given cluster, by binary search of the index built by finalizeFiles()
+int GhostFAT::findFile(uint32_t cluster)
+{
+    int lo = 0, hi = numFiles;
+
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (fileIndex[mid]->startCluster <= cluster)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == 0)
+        return -1;
+
+    GFATEntry *p = fileIndex[lo - 1];
+    if (cluster < (uint32_t)(p->startCluster + numClusters(p)))
+        return lo - 1;
+
+    return -1;
+}
+
+// fill one sector of the FAT; each file occupies a chain of consecutive clusters
+void GhostFAT::buildFAT(uint32_t sectionIdx, uint16_t *dest)
+{
+    uint32_t cl = sectionIdx * 256;
+    int i = 0;
+
+    for (; i < 256 && cl < 2; ++i, ++cl)
+        dest[i] = cl == 0 ? 0xfff0 : 0xffff;
+
+    if (i == 256)
+        return;
+
+    for (int f = findFile(cl - 2); i < 256 && f >= 0 && f < numFiles; f++)
+    {
+        GFATEntry *p = fileIndex[f];
+        uint32_t last = p->startCluster + numClusters(p) + 1;
+
+        for (; i < 256 && cl <= last; ++i, ++cl)
+            dest[i] = cl == last ? 0xffff : cl + 1;
+    }
+}
 
 void GhostFAT::buildBlock(uint32_t block_no, uint8_t *data)
 {
@@ -241,19 +277,7 @@ void GhostFAT::buildBlock(uint32_t block_no, uint8_t *data)
         if (sectionIdx >= SECTORS_PER_FAT)
             sectionIdx -= SECTORS_PER_FAT;
 
-        int cl = 0;
-        int skip = -(sectionIdx * 256);
-        uint16_t *dest = (uint16_t *)data;
-
-        WRITE_ENT(0xfff0);
-        WRITE_ENT(0xffff);
-        for (GFATEntry *p = files; p; p = p->next)
-        {
-            int n = numClusters(p) - 1;
-            for (int i = 0; i < n; i++)
-                WRITE_ENT(cl + 1);
-            WRITE_ENT(0xffff);
-        }
+        buildFAT(sectionIdx, (uint16_t *)data);
     }
     else if (block_no < START_CLUSTERS)
     {
@@ -263,37 +287,75 @@ void GhostFAT::buildBlock(uint32_t block_no, uint8_t *data)
     else
     {
         sectionIdx -= START_CLUSTERS;
-        for (GFATEntry *p = files; p; p = p->next)
+        int f = findFile(sectionIdx);
+        if (f >= 0)
         {
-            if (p->startCluster <= sectionIdx && (int)sectionIdx < p->startCluster + numClusters(p))
-            {
-                sectionIdx -= p->startCluster;
-                if (p->attrs & 0x10)
-                    readDirData(data, sectionIdx, (uint32_t)p->userdata);
-                else
-                    p->read(p, sectionIdx, (char *)data);
-                break;
-            }
+            GFATEntry *p = fileIndex[f];
+            sectionIdx -= p->startCluster;
+            if (p->attrs & 0x10)
+                readDirData(data, sectionIdx, (uint32_t)p->userdata);
+            else
+                p->read(p, sectionIdx, (char *)data);
         }
     }
 }
 
-void GhostFAT::readBlocks(int blockAddr, int numBlocks)
+// return the given boot, FAT or root directory block from the cache, building it if needed
+const uint8_t *GhostFAT::cachedBlock(uint32_t block_no)
 {
-    finalizeFiles();
+    // both copies of the FAT are identical
+    if (block_no >= START_FAT1 && block_no < START_ROOTDIR)
+        block_no -= SECTORS_PER_FAT;
 
-    uint8_t *buf = new uint8_t[512];
+    if (cache == NULL)
+    {
+        cache = (GFATCachedBlock *)malloc(GHOSTFAT_CACHE_BLOCKS * sizeof(GFATCachedBlock));
+        if (cache == NULL)
+            return NULL;
 
-    while (numBlocks--)
+        for (int i = 0; i < GHOSTFAT_CACHE_BLOCKS; ++i)
+        {
+            cache[i].blockNo = 0xffffffff;
+            cache[i].lastUsed = 0;
+        }
+    }
+
+    GFATCachedBlock *victim = &cache[0];
+
+    for (int i = 0; i < GHOSTFAT_CACHE_BLOCKS; ++i)
     {
-        buildBlock(blockAddr, buf);
-        writeBulk(buf, 512);
-        blockAddr++;
+        if (cache[i].blockNo == block_no)
+        {
+            cache[i].lastUsed = ++cacheClock;
+            return cache[i].data;
+        }
+
+        if (cache[i].lastUsed < victim->lastUsed)
+            victim = &cache[i];
     }
 
-    delete buf;
+    buildBlock(block_no, victim->data);
+    victim->blockNo = block_no;
+    victim->lastUsed = ++cacheClock;
 
-    finishReadWrite();
+    return victim->data;
+}
+
+int GhostFAT::readBlock(uint32_t blockAddr, uint8_t *dest)
+{
+    finalizeFiles();
+
+    const uint8_t *data = NULL;
+
+    if (GHOSTFAT_CACHE_BLOCKS > 0 && blockAddr < START_CLUSTERS)
+        data = cachedBlock(blockAddr);
+
+    if (data)
+        memcpy(dest, data, 512);
+    else
+        buildBlock(blockAddr, dest);
+
+    return DEVICE_OK;
 }
 
 
@@ -336,6 +398,10 @@ void GhostFAT::writeBlocks(int blockAddr, int numBlocks)
 GhostFAT::GhostFAT()
 {
     files = NULL;
+    fileIndex = NULL;
+    numFiles = 0;
+    cacheClock = 0;
+    cache = NULL;
 }
 
 bool GhostFAT::filesFinalized()
@@ -366,7 +432,15 @@ void GhostFAT::finalizeFiles()
         files = n;
     }
 
-    files = regFiles;
+    if (regFiles)
+    {
+        files = regFiles;
+    }
+    else
+    {
+        files = dirs;
+        dirs = NULL;
+    }
 
     int cl = 0;
     for (GFATEntry *p = files; p; p = p->next)
@@ -389,7 +463,20 @@ void GhostFAT::finalizeFiles()
             p->next = dirs;
             dirs = NULL;
         }
+        numFiles++;
     }
+
+    // entries are laid out in list order, so the index is sorted by startCluster
+    fileIndex = (GFATEntry **)malloc(numFiles * sizeof(GFATEntry *));
+    if (fileIndex == NULL)
+    {
+        numFiles = 0;
+        return;
+    }
+
+    int i = 0;
+    for (GFATEntry *p = files; p; p = p->next)
+        fileIndex[i++] = p;
 }
 
 GFATEntry *GhostFAT::addFile(GFATReadCallback read, void *userdata, const char *filename,
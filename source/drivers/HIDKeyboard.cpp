@@ -158,6 +158,9 @@ void USBHIDKeyboard::initReports()
 
     memset(keyStateGeneric, 0, HID_KEYBOARD_KEYSTATE_SIZE_GENERIC);
     memset(keyStateConsumer, 0, HID_KEYBOARD_KEYSTATE_SIZE_CONSUMER);
+
+    queueLength = 0;
+    queueing = false;
 }
 
 /**
@@ -194,7 +197,7 @@ int USBHIDKeyboard::setKeyMap(KeyMap& m)
 }
 
 /**
-  * Writes the given report out over USB.
+  * Writes the given report out over USB, or adds it to the report queue while typing.
   *
   * @param report A pointer to the report to copy to USB
   */
@@ -203,6 +206,23 @@ int USBHIDKeyboard::updateReport(HIDKeyboardReport* report)
     if(report == NULL)
         return DEVICE_INVALID_PARAMETER;
 
+    if (queueing)
+    {
+        if (queueLength == HID_KEYBOARD_QUEUE_LENGTH)
+        {
+            int status = sendQueue();
+
+            if (status != DEVICE_OK)
+                return status;
+        }
+
+        queue[queueLength][0] = report->reportID;
+        memcpy(&queue[queueLength][1], report->keyState, report->reportSize);
+        queueLength++;
+
+        return DEVICE_OK;
+    }
+
     if (!in)
         return DEVICE_INVALID_STATE;
 
@@ -212,6 +232,27 @@ int USBHIDKeyboard::updateReport(HIDKeyboardReport* report)
     return in->write(reportBuf, sizeof(reportBuf));
 }
 
+/**
+  * Writes all queued reports out over USB, in order.
+  *
+  * @return DEVICE_OK on success, or the error reported by the endpoint.
+  */
+int USBHIDKeyboard::sendQueue()
+{
+    int status = DEVICE_OK;
+
+    if (!in)
+        status = DEVICE_INVALID_STATE;
+
+    // Each write completes when the host polls for the report, so reports go out at the polling interval.
+    for (int i = 0; i < queueLength && status == DEVICE_OK; i++)
+        status = in->write(queue[i], reports[queue[i][0]].reportSize + 1);
+
+    queueLength = 0;
+
+    return status;
+}
+
 
 /**
   * sets the media key buffer to the given Key, without affecting the state of other media keys.
@@ -297,7 +338,7 @@ int USBHIDKeyboard::standardKeyPress(Key k, KeyActionType action)
     if(report->keyPressedCount == 0 && action == ReleaseKey)
         return DEVICE_INVALID_PARAMETER;
 
-    if(report->keyPressedCount == report->reportSize && action == PressKey)
+    if(report->keyPressedCount == report->reportSize - HID_KEYBOARD_MODIFIER_OFFSET && action == PressKey)
         return DEVICE_NO_RESOURCES;
 
     // firstly iterate through the array to determine if we are raising a key
@@ -340,6 +381,24 @@ int USBHIDKeyboard::standardKeyPress(Key k, KeyActionType action)
     return status;
 }
 
+/**
+  * Presses or releases the given Key, without any delay.
+  *
+  * @param k A valid Key
+  *
+  * @return DEVICE_OK on success.
+  */
+int USBHIDKeyboard::keyAction(Key k, KeyActionType action)
+{
+    if(k.bit.isModifier)
+        return modifierKeyPress(k, action);
+
+    if(k.bit.isMedia)
+        return mediaKeyPress(k, action);
+
+    return standardKeyPress(k, action);
+}
+
 /**
   * Releases the given Key.
   *
@@ -349,14 +408,7 @@ int USBHIDKeyboard::standardKeyPress(Key k, KeyActionType action)
   */
 int USBHIDKeyboard::keyUp(Key k)
 {
-    int status = DEVICE_OK;
-
-    if(k.bit.isModifier)
-        status = modifierKeyPress(k, ReleaseKey);
-    else if(k.bit.isMedia)
-        status = mediaKeyPress(k, ReleaseKey);
-    else
-        status = standardKeyPress(k, ReleaseKey);
+    int status = keyAction(k, ReleaseKey);
 
     fiber_sleep(HID_KEYBOARD_DELAY_DEFAULT);
 
@@ -372,14 +424,7 @@ int USBHIDKeyboard::keyUp(Key k)
   */
 int USBHIDKeyboard::keyDown(Key k)
 {
-    int status = DEVICE_OK;
-
-    if(k.bit.isModifier)
-        status = modifierKeyPress(k, PressKey);
-    else if(k.bit.isMedia)
-        status = mediaKeyPress(k, PressKey);
-    else
-        status = standardKeyPress(k, PressKey);
+    int status = keyAction(k, PressKey);
 
     fiber_sleep(HID_KEYBOARD_DELAY_DEFAULT);
 
@@ -573,18 +618,45 @@ int USBHIDKeyboard::flush()
 }
 
 /**
-  * Type a sequence of keys
+  * Determines if the given sequence is a single key pressed with (optional) modifiers, that may be
+  * merged with its neighbours when typing.
   *
-  * @param seq A valid pointer to a KeySequence containing multiple keys. See ASCIIKeyMap.cpp for example usage.
+  * @param seq A valid pointer to a KeySequence.
+  * @param modifiers Set to the modifiers used by the sequence.
+  * @param code Set to the key code used by the sequence.
   *
-  * @return DEVICE_OK on success.
+  * @return true if the sequence may be merged, false otherwise.
   */
-int USBHIDKeyboard::type(const KeySequence *seq)
+static bool isMergeable(const KeySequence *seq, uint8_t &modifiers, uint8_t &code)
 {
-    if(seq == NULL)
-        return DEVICE_INVALID_PARAMETER;
+    modifiers = 0;
+    code = HID_KEYBOARD_KEY_OFF;
 
-    //send each keystroke in the sequence
+    for(int i = 0; i < seq->length; i++)
+    {
+        Key k = seq->seq[i];
+
+        if(!k.bit.isKeyDown || k.bit.allKeysUp || k.bit.isMedia)
+            return false;
+
+        if(k.bit.isModifier)
+            modifiers |= k.bit.code;
+        else if(code == HID_KEYBOARD_KEY_OFF)
+            code = k.bit.code;
+        else
+            return false;
+    }
+
+    return code != HID_KEYBOARD_KEY_OFF;
+}
+
+/**
+  * Queues the reports for the given sequence, followed by all keys up.
+  *
+  * @param seq A valid pointer to a KeySequence.
+  */
+void USBHIDKeyboard::queueSequence(const KeySequence *seq)
+{
     for(int i = 0; i < seq->length; i++)
     {
         Key k = seq->seq[i];
@@ -592,22 +664,39 @@ int USBHIDKeyboard::type(const KeySequence *seq)
         if(k.bit.allKeysUp)
             flush();
 
-        if(k.bit.isKeyDown)
-            keyDown(k);
-        else
-            keyUp(k);
+        keyAction(k, k.bit.isKeyDown ? PressKey : ReleaseKey);
     }
 
     //all keys up is implicit at the end of each sequence
     flush();
-    fiber_sleep(HID_KEYBOARD_DELAY_DEFAULT);
+}
 
-    return DEVICE_OK;
+/**
+  * Type a sequence of keys
+  *
+  * @param seq A valid pointer to a KeySequence containing multiple keys. See ASCIIKeyMap.cpp for example usage.
+  *
+  * @return DEVICE_OK on success.
+  */
+int USBHIDKeyboard::type(const KeySequence *seq)
+{
+    if(seq == NULL)
+        return DEVICE_INVALID_PARAMETER;
+
+    queueing = true;
+    queueSequence(seq);
+    queueing = false;
+
+    return sendQueue();
 }
 
 /**
   * Type a sequence of characters
   *
+  * Characters that share the same modifiers are merged into as few reports as rollover allows:
+  * each character adds its key to those already held, until a key repeats or all six slots are used.
+  * Reports are computed ahead, and sent back to back at the rate the host polls for them.
+  *
   * @param s A valid pointer to a char array
   *
   * @param len The length of s.
@@ -616,15 +705,66 @@ int USBHIDKeyboard::type(const KeySequence *seq)
   */
 int USBHIDKeyboard::type(const char* s, uint32_t len)
 {
-    int status;
+    int status = DEVICE_OK;
+    HIDKeyboardReport *report = &reports[HID_KEYBOARD_REPORT_GENERIC];
+    uint8_t *keyState = report->keyState;
+    uint8_t modifiers, code;
+
+    queueing = true;
 
     for(uint32_t i = 0; i < len; i++)
     {
-        if((status = type(currentMap->mapCharacter(s[i]))) != DEVICE_OK)
-           return status;
+        const KeySequence *seq = currentMap->mapCharacter(s[i]);
+
+        if(seq == NULL)
+        {
+            status = DEVICE_INVALID_PARAMETER;
+            break;
+        }
+
+        if(!isMergeable(seq, modifiers, code))
+        {
+            if(report->keyPressedCount > 0 || keyState[0] != 0)
+                flush();
+
+            queueSequence(seq);
+            continue;
+        }
+
+        bool held = false;
+
+        for(int j = HID_KEYBOARD_MODIFIER_OFFSET; j < report->reportSize; j++)
+            if(keyState[j] == code)
+                held = true;
+
+        // A new key press can only be seen if the key is not already held, and there is a free slot for it.
+        // Modifiers are changed in a report of their own, so that they apply before the key is pressed.
+        if(held || keyState[0] != modifiers || report->keyPressedCount == report->reportSize - HID_KEYBOARD_MODIFIER_OFFSET)
+        {
+            if(report->keyPressedCount > 0 || keyState[0] != 0)
+            {
+                memset(keyState, 0, report->reportSize);
+                report->keyPressedCount = 0;
+                updateReport(report);
+            }
+
+            if(modifiers)
+            {
+                keyState[0] = modifiers;
+                updateReport(report);
+            }
+        }
+
+        keyState[HID_KEYBOARD_MODIFIER_OFFSET + report->keyPressedCount++] = code;
+        updateReport(report);
     }
 
-    return DEVICE_OK;
+    flush();
+    queueing = false;
+
+    int result = sendQueue();
+
+    return status == DEVICE_OK ? result : status;
 }
 
 /**
@@ -0,0 +1,220 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "IRDecoder.h"
+#include "Event.h"
+
+using namespace codal;
+
+#define IR_NEC_STATE_IDLE           0
+#define IR_NEC_STATE_LEADER         1
+#define IR_NEC_STATE_MARK           2
+#define IR_NEC_STATE_SPACE          3
+
+#define IR_RC5_HALF_BITS            28
+
+/**
+ * Determines if a measured duration matches a nominal protocol timing, within IR_DECODER_TOLERANCE.
+ */
+static bool matches(uint32_t duration, uint32_t nominal)
+{
+    uint32_t tolerance = (nominal * IR_DECODER_TOLERANCE) >> 8;
+
+    return duration >= nominal - tolerance && duration <= nominal + tolerance;
+}
+
+/**
+ * Constructor.
+ *
+ * @param id The id to use for events raised by this decoder. Defaults to DEVICE_ID_EDGE_CAPTURE.
+ * @param activeLow true if the receiver output is low while IR is received, as with most demodulating receivers. Defaults to true.
+ */
+NECDecoder::NECDecoder(uint16_t id, bool activeLow)
+{
+    this->id = id;
+    this->markLevel = activeLow ? 0 : 1;
+    this->state = IR_NEC_STATE_IDLE;
+    this->bits = 0;
+    this->data = 0;
+    this->address = 0;
+    this->command = 0;
+}
+
+/**
+ * Process the next edge.
+ *
+ * A frame is a 9ms leader mark and 4.5ms space, followed by 32 bits sent least significant bit first
+ * (address, inverted address or address high byte, command, inverted command), and a final stop mark.
+ * Each bit is a 562us mark followed by a 562us (0) or 1687us (1) space.
+ *
+ * @param level The level of the pin after the edge.
+ * @param duration The time the pin spent at the previous level, in microseconds.
+ */
+void NECDecoder::decode(int level, uint32_t duration)
+{
+    bool mark = level != markLevel;
+
+    switch (state)
+    {
+        case IR_NEC_STATE_LEADER:
+            if (!mark && matches(duration, IR_NEC_LEADER_SPACE))
+            {
+                bits = 0;
+                data = 0;
+                state = IR_NEC_STATE_MARK;
+                return;
+            }
+
+            if (!mark && matches(duration, IR_NEC_REPEAT_SPACE))
+                Event(id, IR_DECODER_EVT_NEC_REPEAT);
+
+            break;
+
+        case IR_NEC_STATE_MARK:
+            if (mark && matches(duration, IR_NEC_BIT_MARK))
+            {
+                if (bits < 32)
+                {
+                    state = IR_NEC_STATE_SPACE;
+                    return;
+                }
+
+                // This was the stop mark. Validate the command against its inverse.
+                if ((((data >> 16) ^ (data >> 24)) & 0xFF) == 0xFF)
+                {
+                    address = data & 0xFFFF;
+                    command = (data >> 16) & 0xFF;
+                    Event(id, IR_DECODER_EVT_NEC);
+                }
+            }
+            break;
+
+        case IR_NEC_STATE_SPACE:
+            if (!mark && (matches(duration, IR_NEC_ZERO_SPACE) || matches(duration, IR_NEC_ONE_SPACE)))
+            {
+                if (duration > (IR_NEC_ZERO_SPACE + IR_NEC_ONE_SPACE) / 2)
+                    data |= 1UL << bits;
+
+                bits++;
+                state = IR_NEC_STATE_MARK;
+                return;
+            }
+            break;
+    }
+
+    // Anything unexpected returns us to idle, although it may itself be the start of a new frame.
+    state = (mark && matches(duration, IR_NEC_LEADER_MARK)) ? IR_NEC_STATE_LEADER : IR_NEC_STATE_IDLE;
+}
+
+/**
+ * Constructor.
+ *
+ * @param id The id to use for events raised by this decoder. Defaults to DEVICE_ID_EDGE_CAPTURE.
+ * @param activeLow true if the receiver output is low while IR is received, as with most demodulating receivers. Defaults to true.
+ */
+RC5Decoder::RC5Decoder(uint16_t id, bool activeLow)
+{
+    this->id = id;
+    this->markLevel = activeLow ? 0 : 1;
+    this->halfBits = 0;
+    this->marks = 0;
+    this->address = 0;
+    this->command = 0;
+    this->toggle = 0;
+}
+
+/**
+ * Process the next edge.
+ *
+ * RC5 is Manchester encoded with 889us half bits: a space followed by a mark is a 1, and a mark followed
+ * by a space is a 0. Each level therefore lasts one or two half bits, and the 28 half bits of a frame are
+ * rebuilt from the edges. The frame always starts with a 1, so its leading space merges with the idle line,
+ * as may the trailing space of a final 0.
+ *
+ * @param level The level of the pin after the edge.
+ * @param duration The time the pin spent at the previous level, in microseconds.
+ */
+void RC5Decoder::decode(int level, uint32_t duration)
+{
+    bool mark = level != markLevel;
+    int n = matches(duration, IR_RC5_HALF_BIT) ? 1 : matches(duration, 2 * IR_RC5_HALF_BIT) ? 2 : 0;
+
+    if (n == 0 || (halfBits == 0 && !mark))
+    {
+        halfBits = 0;
+        return;
+    }
+
+    // The first mark of a frame is preceded by the (implicit) space of the first start bit.
+    if (halfBits == 0)
+    {
+        marks = 0;
+        halfBits = 1;
+    }
+
+    while (n-- && halfBits < IR_RC5_HALF_BITS)
+    {
+        if (mark)
+            marks |= 1UL << halfBits;
+
+        halfBits++;
+    }
+
+    // If only the final half bit remains after a mark, it is a space that merges with the idle line.
+    if (halfBits == IR_RC5_HALF_BITS - 1 && mark)
+        halfBits++;
+
+    if (halfBits == IR_RC5_HALF_BITS)
+        complete();
+}
+
+/**
+ * Decode the 28 half bits received, and raise an event if they form a valid frame.
+ */
+void RC5Decoder::complete()
+{
+    uint16_t frame = 0;
+
+    halfBits = 0;
+
+    for (int i = 0; i < IR_RC5_HALF_BITS; i += 2)
+    {
+        int first = (marks >> i) & 1;
+        int second = (marks >> (i + 1)) & 1;
+
+        // Each bit must contain a transition.
+        if (first == second)
+            return;
+
+        frame = (frame << 1) | second;
+    }
+
+    // Frame format: S1 S2 T A4..A0 C5..C0, where S2 is the inverse of the seventh command bit.
+    command = (frame & 0x3F) | ((frame & 0x1000) ? 0 : 0x40);
+    address = (frame >> 6) & 0x1F;
+    toggle = (frame >> 11) & 1;
+
+    Event(id, IR_DECODER_EVT_RC5);
+}
@@ -30,10 +30,13 @@ DEALINGS IN THE SOFTWARE.
 
 #include "CodalConfig.h"
 #include "KeyValueStorage.h"
+#include "PearsonHash.h"
 #include "CodalCompat.h"
 
 using namespace codal;
 
+// The size of a record holding the given number of key and value bytes, rounded up to a whole number of words.
+#define KEY_VALUE_RECORD_SIZE(n)    (sizeof(KeyValueRecord) + (((n) + 3) & ~3))
 
 /**
   * Constructor.
@@ -43,114 +46,501 @@ using namespace codal;
   * 
   * @param controller The non-volatile storage controller to use
   * @param pageNumber The logical page number for this KeyValueStorage
-  *                   Optionally use negative number to count from end of address space.
+  *                   Optionally use negative number to count from end of address space, in which case
+  *                   this is the last page of the store, and any further pages are taken below it.
+  * @param pageCount The number of consecutive pages to use. Defaults to KEY_VALUE_STORAGE_PAGE_COUNT, and must be at least 2.
   */
-KeyValueStorage::KeyValueStorage(NVMController& controller, int pageNumber) : controller(controller)
+KeyValueStorage::KeyValueStorage(NVMController& controller, int pageNumber, int pageCount) : controller(controller)
 {
-    scratch = NULL;
+    this->pageSize = controller.getPageSize();
+    this->pageCount = max(pageCount, 2);
+    this->index = NULL;
+    this->indexLength = 0;
+    this->indexCapacity = 0;
+
+    // Determine the logical address of the start of the key/value storage pages.
+    // Pages beyond the first are taken below a page counted from the end of flash, so that the store
+    // does not encroach on pages reserved above it.
+    if (pageNumber < 0)
+        flashPagePtr = controller.getFlashEnd() + (pageSize * (pageNumber - (this->pageCount - 1)));
+    else
+        flashPagePtr = controller.getFlashStart() + (pageSize * pageNumber);
 
-    // Determine the logival address of the start of the key/value storage page
+    // Earlier versions subtracted a negative page number from the end of flash. Remember where they
+    // kept their data, so that it can be imported.
     if (pageNumber < 0)
-        flashPagePtr = controller.getFlashEnd() - (controller.getPageSize() * pageNumber);
+        legacyPagePtr = controller.getFlashEnd() - (pageSize * pageNumber);
     else
-        flashPagePtr = controller.getFlashStart() + (controller.getPageSize() * pageNumber);   
+        legacyPagePtr = flashPagePtr;
 
-    size();
+    mount();
 }
 
+/**
+  * Locates the live data in flash, and rebuilds the RAM index from it.
+  * Flash that holds no valid store is formatted, importing any data held in the original fixed size format.
+  */
+void KeyValueStorage::mount()
+{
+    KeyValueStoragePage header;
+    KeyValueRecord record;
+    char key[KEY_VALUE_STORAGE_MAX_KEY_LENGTH + 1];
+    int found = 0;
+
+    indexLength = 0;
+
+    // The live page is the valid page with the most recent sequence number.
+    for (int i = 0; i < pageCount; i++)
+    {
+        controller.read((uint32_t *)&header, pageAddress(i), sizeof(header) / 4);
+
+        if (header.magic == KEY_VALUE_STORAGE_LOG_MAGIC && (!found || (int32_t)(header.sequence - sequence) > 0))
+        {
+            found = 1;
+            activePage = i;
+            sequence = header.sequence;
+        }
+    }
+
+    if (!found)
+    {
+        if (!importLegacy())
+        {
+            sequence = 0;
+            beginPage(0);
+            commitPage(0);
+        }
+
+        return;
+    }
+
+    // Replay the log, so that the index refers to the latest record of each key.
+    uint32_t offset = sizeof(KeyValueStoragePage);
+
+    while (offset + sizeof(KeyValueRecord) <= pageSize)
+    {
+        int result = readRecord(offset, record, key);
+
+        if (result == DEVICE_NO_DATA)
+            break;
+
+        if (result != DEVICE_OK)
+        {
+            // An update was interrupted. Nothing more can be written to this page, so compact before the next update.
+            offset = pageSize;
+            break;
+        }
+
+        uint16_t hash = PearsonHash::hash16(key);
+        int i = find(key, record.keyLength, hash);
+
+        if (record.flags & KEY_VALUE_RECORD_FLAG_TOMBSTONE)
+        {
+            if (i >= 0)
+                index[i] = index[--indexLength];
+        }
+        else
+        {
+            if (i < 0)
+            {
+                if (indexLength == indexCapacity)
+                {
+                    KeyValueIndexEntry *e = (KeyValueIndexEntry *) realloc(index, (indexCapacity + 4) * sizeof(KeyValueIndexEntry));
+                    if (e != NULL)
+                    {
+                        index = e;
+                        indexCapacity += 4;
+                    }
+                }
+
+                if (indexLength < indexCapacity)
+                {
+                    i = indexLength++;
+                    index[i].hash = hash;
+                }
+            }
+
+            if (i >= 0)
+                index[i].offset = offset / 4;
+        }
+
+        offset += KEY_VALUE_RECORD_SIZE(record.keyLength + record.valueLength);
+    }
+
+    writeOffset = offset;
+}
 
 /**
-  * Places a given key, and it's corresponding value into flash at the earliest
-  * available point.
+  * Imports the key value pairs held in the original fixed size format, if any.
   *
-  * @param key the unique name that should be used as an identifier for the given data.
-  *            The key is presumed to be null terminated.
-  *
-  * @param data a pointer to the beginning of the data to be persisted.
-  *
-  * @param dataSize the size of the data to be persisted
-  *
-  * @return DEVICE_OK on success, KEY_VALUE_INVALID_PARAMETER if the key or size is too large,
-  *         KEY_VALUE_NO_RESOURCES if the storage page is full
+  * @return true if an existing store was found and imported.
   */
-int KeyValueStorage::put(const char *key, uint8_t *data, int dataSize)
+bool KeyValueStorage::importLegacy()
 {
+    KeyValueStore store;
     KeyValuePair pair;
-    int keySize = strlen(key) + 1;
 
-    if(keySize > (int)sizeof(pair.key) || dataSize > (int)sizeof(pair.value) || dataSize < 0)
-        return DEVICE_INVALID_PARAMETER;
+    controller.read((uint32_t *)&store, legacyPagePtr, sizeof(KeyValueStore) / 4);
 
-    KeyValuePair *currentValue = get(key);
+    if (store.magic != KEY_VALUE_STORAGE_MAGIC || store.size > KEY_VALUE_STORAGE_MAX_PAIRS)
+        return false;
 
-    int upToDate = currentValue && (memcmp(currentValue->value, data, dataSize) == 0);
+    // Build the new store alongside the original, which remains valid until the new page is committed.
+    int page = legacyPagePtr == pageAddress(0) ? 1 : 0;
 
-    if(currentValue)
-        delete currentValue;
+    sequence = 0;
+    beginPage(page);
 
-    if(upToDate)
-        return DEVICE_OK;
+    for (uint32_t i = 0; i < store.size; i++)
+    {
+        controller.read((uint32_t *)&pair, legacyPagePtr + sizeof(KeyValueStore) + i * sizeof(KeyValuePair), sizeof(KeyValuePair) / 4);
+        pair.key[KEY_VALUE_STORAGE_KEY_SIZE - 1] = 0;
 
-    memcpy(pair.key, key, keySize);
-    memcpy(pair.value, data, dataSize);
+        char *key = (char *)pair.key;
+        if (*key)
+            append(key, strlen(key), PearsonHash::hash16(key), pair.value, sizeof(pair.value), 0);
+    }
 
-    uint32_t flashPointer = flashPagePtr;
+    commitPage(page);
 
-    int storeSize = size();
+    return true;
+}
 
-    //our KeyValueStore struct is always at 0
-    flashPointer += sizeof(KeyValueStore);
-    int scratchPtr = sizeof(KeyValueStore) / 4;
+/**
+  * Erases the given page, ready to receive records.
+  */
+int KeyValueStorage::beginPage(int page)
+{
+    uint32_t s = sequence + 1;
 
-    KeyValuePair storedPair = KeyValuePair();
-    int found = 0;
+    controller.erase(pageAddress(page));
+    controller.write(pageAddress(page), &s, 1);
+
+    activePage = page;
+    writeOffset = sizeof(KeyValueStoragePage);
+
+    return DEVICE_OK;
+}
+
+/**
+  * Writes the header of the given page, making it the active page.
+  */
+int KeyValueStorage::commitPage(int page)
+{
+    uint32_t magic = KEY_VALUE_STORAGE_LOG_MAGIC;
 
-    scratchReset();
+    controller.write(pageAddress(page) + sizeof(uint32_t), &magic, 1);
+    sequence++;
 
-    //iterate through key value pairs in flash, writing them to the scratch page.
-    for(int i = 0; i < storeSize; i++)
+    return DEVICE_OK;
+}
+
+/**
+  * Copies the latest record of every live key into the next page, and makes that the active page.
+  * The new page is not committed, so the previous page remains the valid copy of the store until
+  * the caller has appended any new record and called commitPage().
+  *
+  * @param reserve The number of bytes that must be free in the new page.
+  * @param replace The position in the index of a key about to be rewritten, or -1. Its current record is only
+  *                dropped if the new page would otherwise not have enough space.
+  * @return DEVICE_OK on success, or DEVICE_NO_RESOURCES if there is not enough space.
+  */
+int KeyValueStorage::compact(uint32_t reserve, int replace)
+{
+    KeyValueRecord record;
+    uint32_t buffer[KEY_VALUE_STORAGE_CHUNK_WORDS];
+    uint32_t used = sizeof(KeyValueStoragePage) + reserve;
+    uint32_t replaced = 0;
+    uint32_t source = pageAddress(activePage);
+
+    for (int i = 0; i < indexLength; i++)
     {
-        controller.read((uint32_t *)&storedPair, flashPointer, sizeof(KeyValuePair)/4);
+        controller.read((uint32_t *)&record, source + index[i].offset * 4, sizeof(record) / 4);
+        used += KEY_VALUE_RECORD_SIZE(record.keyLength + record.valueLength);
+
+        if (i == replace)
+            replaced = KEY_VALUE_RECORD_SIZE(record.keyLength + record.valueLength);
+    }
+
+    if (used > pageSize)
+    {
+        if (replace < 0 || used - replaced > pageSize)
+            return DEVICE_NO_RESOURCES;
+
+        index[replace] = index[--indexLength];
+    }
+
+    int page = (activePage + 1) % pageCount;
+    uint32_t dest = pageAddress(page);
+
+    beginPage(page);
 
-        //check if the keys match...
-        if(strcmp((char *)storedPair.key, (char *)pair.key) == 0)
+    for (int i = 0; i < indexLength; i++)
+    {
+        uint32_t from = source + index[i].offset * 4;
+        controller.read((uint32_t *)&record, from, sizeof(record) / 4);
+
+        uint32_t words = KEY_VALUE_RECORD_SIZE(record.keyLength + record.valueLength) / 4;
+        index[i].offset = writeOffset / 4;
+
+        while (words)
         {
-            found = 1;
-            //scratch our KeyValueStore struct so that it is preserved.
-            scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_MAGIC, storeSize));
-            scratchKeyValuePair(pair, scratchPtr);
+            uint32_t n = min(words, KEY_VALUE_STORAGE_CHUNK_WORDS);
+
+            controller.read(buffer, from, n);
+            controller.write(dest + writeOffset, buffer, n);
+
+            from += n * 4;
+            writeOffset += n * 4;
+            words -= n;
         }
-        else
+    }
+
+    return DEVICE_OK;
+}
+
+/**
+  * Appends a record to the active page, and updates the index.
+  *
+  * @return DEVICE_OK on success, or DEVICE_NO_RESOURCES if the page is full.
+  */
+int KeyValueStorage::append(const char *key, int keyLength, uint16_t hash, const uint8_t *data, int dataSize, uint8_t flags)
+{
+    KeyValueRecord record;
+    uint32_t buffer[KEY_VALUE_STORAGE_CHUNK_WORDS];
+    uint32_t size = KEY_VALUE_RECORD_SIZE(keyLength + dataSize);
+    uint32_t address = pageAddress(activePage) + writeOffset;
+
+    if (writeOffset + size > pageSize)
+        return DEVICE_NO_RESOURCES;
+
+    int i = find(key, keyLength, hash);
+
+    if (i < 0 && !(flags & KEY_VALUE_RECORD_FLAG_TOMBSTONE) && indexLength == indexCapacity)
+    {
+        KeyValueIndexEntry *e = (KeyValueIndexEntry *) realloc(index, (indexCapacity + 4) * sizeof(KeyValueIndexEntry));
+        if (e == NULL)
+            return DEVICE_NO_RESOURCES;
+
+        index = e;
+        indexCapacity += 4;
+    }
+
+    record.valueLength = dataSize;
+    record.keyLength = keyLength;
+    record.flags = flags;
+    record.crc = crc32(&record, 4);
+    record.crc = crc32(key, keyLength, record.crc);
+    record.crc = crc32(data, dataSize, record.crc);
+
+    // Write the header first, so that an interrupted write is detected by its CRC.
+    controller.write(address, (uint32_t *)&record, sizeof(record) / 4);
+    address += sizeof(record);
+
+    // Stream the key and value into flash, padding the final word.
+    int total = keyLength + dataSize;
+    int position = 0;
+
+    while (position < total)
+    {
+        int n = min(total - position, KEY_VALUE_STORAGE_CHUNK_WORDS * 4);
+
+        memset(buffer, 0xFF, sizeof(buffer));
+
+        for (int b = 0; b < n; b++, position++)
+            ((uint8_t *)buffer)[b] = position < keyLength ? key[position] : data[position - keyLength];
+
+        controller.write(address, buffer, (n + 3) / 4);
+        address += (n + 3) & ~3;
+    }
+
+    if (flags & KEY_VALUE_RECORD_FLAG_TOMBSTONE)
+    {
+        if (i >= 0)
+            index[i] = index[--indexLength];
+    }
+    else
+    {
+        if (i < 0)
         {
-            scratchKeyValuePair(storedPair, scratchPtr);
+            i = indexLength++;
+            index[i].hash = hash;
         }
 
-        flashPointer += sizeof(KeyValuePair);
-        scratchPtr += sizeof(KeyValuePair) / 4;
+        index[i].offset = writeOffset / 4;
     }
 
-    if(!found)
+    writeOffset += size;
+
+    return DEVICE_OK;
+}
+
+/**
+  * Determines the position of the given key in the index.
+  *
+  * @return the position in the index, or -1 if the key is not present.
+  */
+int KeyValueStorage::find(const char *key, int keyLength, uint16_t hash)
+{
+    KeyValueRecord record;
+    char storedKey[KEY_VALUE_STORAGE_MAX_KEY_LENGTH];
+
+    for (int i = 0; i < indexLength; i++)
     {
-        //if we haven't got a match for the key, check we can add a new KeyValuePair
-        if(storeSize == KEY_VALUE_STORAGE_MAX_PAIRS)
-            return DEVICE_NO_RESOURCES;
+        if (index[i].hash != hash)
+            continue;
+
+        // Confirm the match, as different keys may share a hash.
+        uint32_t address = pageAddress(activePage) + index[i].offset * 4;
+        controller.read((uint32_t *)&record, address, sizeof(record) / 4);
+
+        if (record.keyLength != keyLength)
+            continue;
 
-        storeSize += 1;
+        readBytes(address + sizeof(record), storedKey, keyLength);
 
-        //scratch our updated values.
-        scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_MAGIC, storeSize));
-        scratchKeyValuePair(pair, scratchPtr);
+        if (memcmp(storedKey, key, keyLength) == 0)
+            return i;
     }
 
-    //erase our storage page
-    controller.erase(flashPagePtr);
+    return -1;
+}
 
-    //copy from scratch to storage.
-    controller.write(flashPagePtr, scratch, KEY_VALUE_STORAGE_SCRATCH_WORD_SIZE);
+/**
+  * Reads and validates the record at the given offset of the active page.
+  *
+  * @return DEVICE_OK if a valid record is present, DEVICE_NO_DATA if the space is unused,
+  *         or DEVICE_INVALID_PARAMETER if the record is corrupt.
+  */
+int KeyValueStorage::readRecord(uint32_t offset, KeyValueRecord &record, char *key)
+{
+    uint8_t buffer[KEY_VALUE_STORAGE_CHUNK_WORDS * 4];
+    uint32_t address = pageAddress(activePage) + offset;
+
+    controller.read((uint32_t *)&record, address, sizeof(record) / 4);
+
+    if (*(uint32_t *)&record == 0xFFFFFFFF)
+        return DEVICE_NO_DATA;
+
+    if (record.keyLength == 0 || record.keyLength > KEY_VALUE_STORAGE_MAX_KEY_LENGTH || offset + KEY_VALUE_RECORD_SIZE(record.keyLength + record.valueLength) > pageSize)
+        return DEVICE_INVALID_PARAMETER;
+
+    address += sizeof(record);
+    readBytes(address, key, record.keyLength);
+    key[record.keyLength] = 0;
+
+    uint32_t crc = crc32(&record, 4);
+    crc = crc32(key, record.keyLength, crc);
+
+    address += record.keyLength;
+
+    for (int remaining = record.valueLength; remaining > 0;)
+    {
+        int n = min(remaining, sizeof(buffer));
+
+        readBytes(address, buffer, n);
+        crc = crc32(buffer, n, crc);
+
+        address += n;
+        remaining -= n;
+    }
+
+    return crc == record.crc ? DEVICE_OK : DEVICE_INVALID_PARAMETER;
+}
+
+/**
+  * Reads any number of bytes from any address in flash.
+  */
+int KeyValueStorage::readBytes(uint32_t address, void *buffer, uint32_t length)
+{
+    uint32_t chunk[KEY_VALUE_STORAGE_CHUNK_WORDS];
+    uint8_t *dest = (uint8_t *)buffer;
+
+    while (length)
+    {
+        uint32_t skip = address & 3;
+        uint32_t n = min(length, sizeof(chunk) - skip);
+
+        controller.read(chunk, address - skip, (skip + n + 3) / 4);
+        memcpy(dest, (uint8_t *)chunk + skip, n);
+
+        address += n;
+        dest += n;
+        length -= n;
+    }
 
     return DEVICE_OK;
 }
 
+/**
+  * Places a given key, and it's corresponding value into flash at the earliest
+  * available point.
+  *
+  * @param key the unique name that should be used as an identifier for the given data.
+  *            The key is presumed to be null terminated.
+  *
+  * @param data a pointer to the beginning of the data to be persisted.
+  *
+  * @param dataSize the size of the data to be persisted
+  *
+  * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if the key or size is too large,
+  *         DEVICE_NO_RESOURCES if the storage is full
+  */
+int KeyValueStorage::put(const char *key, uint8_t *data, int dataSize)
+{
+    int keyLength = strlen(key);
+    uint32_t size = KEY_VALUE_RECORD_SIZE(keyLength + dataSize);
+
+    if (keyLength == 0 || keyLength > KEY_VALUE_STORAGE_MAX_KEY_LENGTH || dataSize < 0 || dataSize > 0xFFFF || size > pageSize - sizeof(KeyValueStoragePage))
+        return DEVICE_INVALID_PARAMETER;
+
+    uint16_t hash = PearsonHash::hash16(key);
+    int i = find(key, keyLength, hash);
+
+    // Avoid wearing the flash if the stored value is already up to date.
+    if (i >= 0)
+    {
+        KeyValueRecord record;
+        uint8_t buffer[KEY_VALUE_STORAGE_CHUNK_WORDS * 4];
+        uint32_t address = pageAddress(activePage) + index[i].offset * 4;
+
+        controller.read((uint32_t *)&record, address, sizeof(record) / 4);
+
+        if (record.valueLength == dataSize)
+        {
+            int position = 0;
+            address += sizeof(record) + keyLength;
+
+            while (position < dataSize)
+            {
+                int n = min(dataSize - position, sizeof(buffer));
+
+                readBytes(address + position, buffer, n);
+                if (memcmp(buffer, data + position, n) != 0)
+                    break;
+
+                position += n;
+            }
+
+            if (position == dataSize)
+                return DEVICE_OK;
+        }
+    }
+
+    if (writeOffset + size <= pageSize)
+        return append(key, keyLength, hash, data, dataSize, 0);
+
+    int result = compact(size, i);
+    if (result != DEVICE_OK)
+        return result;
+
+    // Only commit the compacted page once it holds the new record, so that the key survives a power failure.
+    result = append(key, keyLength, hash, data, dataSize, 0);
+    commitPage(activePage);
+
+    return result;
+}
+
 /**
   * Places a given key, and it's corresponding value into flash at the earliest
   * available point.
@@ -161,8 +551,8 @@ int KeyValueStorage::put(const char *key, uint8_t *data, int dataSize)
   *
   * @param dataSize the size of the data to be persisted
   *
-  * @return DEVICE_OK on success, KEY_VALUE_INVALID_PARAMETER if the key or size is too large,
-  *         KEY_VALUE_NO_RESOURCES if the storage page is full
+  * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if the key or size is too large,
+  *         DEVICE_NO_RESOURCES if the storage is full
   */
 int KeyValueStorage::put(ManagedString key, uint8_t* data, int dataSize)
 {
@@ -170,50 +560,63 @@ int KeyValueStorage::put(ManagedString key, uint8_t* data, int dataSize)
 }
 
 /**
-  * Retreives a KeyValuePair identified by a given key.
+  * Retreives the value identified by a given key, without any heap allocation.
   *
-  * @param key the unique name used to identify a KeyValuePair in flash.
+  * @param key the unique name used to identify the value in flash.
   *
-  * @return a pointer to a heap allocated KeyValuePair struct, this pointer will be
-  *         NULL if the key was not found in storage.
+  * @param buffer the buffer to copy the value into. May be NULL to just determine the length of the value.
   *
-  * @note it is up to the user to free memory after use.
+  * @param bufferSize the size of the buffer. Values larger than the buffer are truncated.
+  *
+  * @return the length of the stored value, or DEVICE_NO_DATA if the key was not found in storage.
   */
-KeyValuePair* KeyValueStorage::get(const char* key)
+int KeyValueStorage::get(const char* key, uint8_t *buffer, int bufferSize)
 {
-    //calculate our offsets for our storage page
-    int storeSize = size();
+    int keyLength = strlen(key);
 
-    //we haven't got anything stored, so return...
-    if(storeSize == 0)
-        return NULL;
+    if (keyLength > KEY_VALUE_STORAGE_MAX_KEY_LENGTH)
+        return DEVICE_NO_DATA;
 
-    uint32_t flashPtr = this->flashPagePtr;
+    int i = find(key, keyLength, PearsonHash::hash16(key));
 
-    //our KeyValueStore struct is always at 0
-    flashPtr += sizeof(KeyValueStore);
+    if (i < 0)
+        return DEVICE_NO_DATA;
 
-    KeyValuePair *pair = new KeyValuePair();
+    KeyValueRecord record;
+    uint32_t address = pageAddress(activePage) + index[i].offset * 4;
 
-    int i;
+    controller.read((uint32_t *)&record, address, sizeof(record) / 4);
 
-    //iterate through flash until we have a match, or drop out.
-    for(i = 0; i < storeSize; i++)
-    {
-        controller.read((uint32_t *)pair, flashPtr, sizeof(KeyValuePair)/4);
-        if(strcmp(key,(char *)pair->key) == 0)
-            break;
+    if (buffer && bufferSize > 0)
+        readBytes(address + sizeof(record) + keyLength, buffer, min(bufferSize, record.valueLength));
 
-        flashPtr += sizeof(KeyValuePair);
-    }
+    return record.valueLength;
+}
 
-    //clean up
-    if(i == storeSize)
+/**
+  * Retreives a KeyValuePair identified by a given key.
+  *
+  * @param key the unique name used to identify a KeyValuePair in flash.
+  *
+  * @return a pointer to a heap allocated KeyValuePair struct, this pointer will be
+  *         NULL if the key was not found in storage. Values longer than KEY_VALUE_STORAGE_VALUE_SIZE are truncated.
+  *
+  * @note it is up to the user to free memory after use.
+  */
+KeyValuePair* KeyValueStorage::get(const char* key)
+{
+    KeyValuePair *pair = new KeyValuePair();
+
+    memset(pair, 0, sizeof(KeyValuePair));
+
+    if (get(key, pair->value, sizeof(pair->value)) < 0)
     {
         delete pair;
         return NULL;
     }
 
+    strncpy((char *)pair->key, key, sizeof(pair->key) - 1);
+
     return pair;
 }
 
@@ -223,7 +626,7 @@ KeyValuePair* KeyValueStorage::get(const char* key)
   * @param key the unique name used to identify a KeyValuePair in flash.
   *
   * @return a pointer to a heap allocated KeyValuePair struct, this pointer will be
-  *         NULL if the key was not found in storage.
+  *         NULL if the key was not found in storage. Values longer than KEY_VALUE_STORAGE_VALUE_SIZE are truncated.
   *
   * @note it is up to the user to free memory after use.
   */
@@ -242,61 +645,32 @@ KeyValuePair* KeyValueStorage::get(ManagedString key)
   */
 int KeyValueStorage::remove(const char* key)
 {
-    int storeSize = size();
+    int keyLength = strlen(key);
 
-    //if we have no data, we have nothing to do.
-    if(storeSize == 0)
+    if (keyLength > KEY_VALUE_STORAGE_MAX_KEY_LENGTH)
         return DEVICE_NO_DATA;
 
-    uint32_t flashPointer = this->flashPagePtr;
-
-    //our KeyValueStore struct is always at 0
-    flashPointer += sizeof(KeyValueStore);
-    int scratchPointer = sizeof(KeyValueStore) / 4;
-
-    KeyValuePair storedPair = KeyValuePair();
-
-    int found = 0;
-
-    scratchReset();
+    uint16_t hash = PearsonHash::hash16(key);
+    int i = find(key, keyLength, hash);
 
-    // scratch the old size (it will be updated later if required).
-    scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_MAGIC, storeSize));
+    if (i < 0)
+        return DEVICE_NO_DATA;
 
-    //iterate through our flash copy pairs to scratch, unless there is a key patch
-    for(int i = 0; i < storeSize; i++)
-    {
-        controller.read((uint32_t *)&storedPair, flashPointer, sizeof(KeyValuePair)/4);
+    if (writeOffset + KEY_VALUE_RECORD_SIZE(keyLength) <= pageSize)
+        return append(key, keyLength, hash, NULL, 0, KEY_VALUE_RECORD_FLAG_TOMBSTONE);
 
-        //if we have a match, don't increment our scratchPointer
-        if(strcmp((char *)storedPair.key, (char *)key) == 0)
-        {
-            found = 1;
-            //write our new KeyValueStore data
-            scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_MAGIC, storeSize - 1));
-        }
-        else
-        {
-            //otherwise copy the KeyValuePair from our storage page.
-            scratchKeyValuePair(storedPair, scratchPointer);
-            scratchPointer += sizeof(KeyValuePair) / 4;
-        }
+    // No room for a tombstone, so compact the store without the key instead.
+    KeyValueIndexEntry removed = index[i];
+    index[i] = index[--indexLength];
 
-        flashPointer += sizeof(KeyValuePair);
-    }
+    int result = compact(0);
 
-    //if we haven't got a match, write our old KeyValueStore struct
-    if(!found)
-    {
-        scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_MAGIC, storeSize));
-        return DEVICE_NO_DATA;
-    }
+    if (result != DEVICE_OK)
+        index[indexLength++] = removed;
+    else
+        commitPage(activePage);
 
-    //copy scratch to our storage page
-    controller.erase(flashPagePtr);
-    controller.write(flashPagePtr, scratch, (sizeof(KeyValueStore) / 4) + (storeSize * (sizeof(KeyValuePair) / 4)));
-    
-    return DEVICE_OK;
+    return result;
 }
 
 /**
@@ -319,27 +693,7 @@ int KeyValueStorage::remove(ManagedString key)
   */
 int KeyValueStorage::size()
 {
-    KeyValueStore store = KeyValueStore();
-
-    //read our data!
-    controller.read((uint32_t *)&store, flashPagePtr, sizeof(KeyValueStore)/4);
-
-    //if we haven't used flash before, we need to configure it
-    if(store.magic != KEY_VALUE_STORAGE_MAGIC)
-    {
-        store.magic = KEY_VALUE_STORAGE_MAGIC;
-        store.size = 0;
-
-        //erase the scratch page and write our new KeyValueStore
-        scratchReset();
-        scratchKeyValueStore(store);
-
-        //erase flash, and copy the scratch page over
-        controller.erase(flashPagePtr);
-        controller.write(flashPagePtr, scratch, KEY_VALUE_STORAGE_SCRATCH_WORD_SIZE);
-    }
-
-    return store.size;
+    return indexLength;
 }
 
 /**
@@ -347,43 +701,23 @@ int KeyValueStorage::size()
  */
 int KeyValueStorage::wipe()
 {
-    controller.erase(flashPagePtr);
-    size();
-    return DEVICE_OK;
-}
-
-/**
- * Function to lazily instatiate a scratch buffer
- */
-void KeyValueStorage::scratchReset()
-{
-    if (scratch == NULL)
-        scratch = (uint32_t *)malloc(KEY_VALUE_STORAGE_SCRATCH_WORD_SIZE * 4);
+    // Page 0 is erased as it is formatted below.
+    for (int i = 1; i < pageCount; i++)
+        controller.erase(pageAddress(i));
 
-    memset(scratch, 0, KEY_VALUE_STORAGE_SCRATCH_WORD_SIZE * 4);
-}
+    indexLength = 0;
+    sequence = 0;
 
+    beginPage(0);
+    commitPage(0);
 
-/**
-  * Function for populating the scratch page with a KeyValueStore.
-  *
-  * @param store the KeyValueStore struct to write to the scratch page.
-  */
-void KeyValueStorage::scratchKeyValueStore(KeyValueStore store)
-{
-    memcpy(this->scratch, &store, sizeof(KeyValueStore));
+    return DEVICE_OK;
 }
 
 /**
-  * Function for populating the scratch page with a KeyValuePair.
-  *
-  * @param pair the KeyValuePair struct to write to the scratch page.
-  *
-  * @param flashPointer the pointer in flash where this KeyValuePair resides. This pointer
-  * is used to determine the offset into the scratch page, where the KeyValuePair should
-  * be written.
+  * Destructor.
   */
-void KeyValueStorage::scratchKeyValuePair(KeyValuePair pair, int scratchOffset)
+KeyValueStorage::~KeyValueStorage()
 {
-    memcpy(this->scratch + scratchOffset, &pair, sizeof(KeyValuePair));
+    free(index);
 }
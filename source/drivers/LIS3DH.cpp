@@ -40,19 +40,19 @@ using namespace codal;
 // Configuration table for available g force ranges.
 // Maps g -> LIS3DH_CTRL_REG4 [5..4]
 //
-static const KeyValueTableEntry accelerometerRangeData[] = {
+static constexpr KeyValueTableEntry accelerometerRangeData[] = {
     {2, 0},
     {4, 1},
     {8, 2},
     {16, 3}
 };
-CREATE_KEY_VALUE_TABLE(accelerometerRange, accelerometerRangeData);
+CREATE_CHECKED_KEY_VALUE_TABLE(accelerometerRange, accelerometerRangeData);
 
 //
 // Configuration table for available data update frequency.
 // maps microsecond period -> LIS3DH_CTRL_REG1 data rate selection bits
 //
-static const KeyValueTableEntry accelerometerPeriodData[] = {
+static constexpr KeyValueTableEntry accelerometerPeriodData[] = {
     {2500,      0x70},
     {5000,      0x60},
     {10000,     0x50},
@@ -61,7 +61,7 @@ static const KeyValueTableEntry accelerometerPeriodData[] = {
     {100000,    0x20},
     {1000000,   0x10}
 };
-CREATE_KEY_VALUE_TABLE(accelerometerPeriod, accelerometerPeriodData);
+CREATE_CHECKED_KEY_VALUE_TABLE(accelerometerPeriod, accelerometerPeriodData);
 
 /**
   * Constructor.
@@ -85,6 +85,7 @@ LIS3DH::LIS3DH(I2C& _i2c, Pin &_int1, CoordinateSpace &coordinateSpace, uint16_t
     this->id = id;
     this->status = 0;
     this->address = address;
+    this->batch = NULL;
 
     // Configure and enable the accelerometer.
     configure();
@@ -114,8 +115,8 @@ int LIS3DH::configure()
     if (result != 0)
         return DEVICE_I2C_ERROR;
 
-    // Enable the INT1 interrupt pin when XYZ data is available.
-    value = 0x10;
+    // Enable the INT1 interrupt pin when XYZ data is available, or when the FIFO reaches its watermark if batching.
+    value = batchSize > 1 ? 0x04 : 0x10;
     result = i2c.writeRegister(address, LIS3DH_CTRL_REG3, value);
     if (result != 0)
         return DEVICE_I2C_ERROR;
@@ -126,15 +127,91 @@ int LIS3DH::configure()
     if (result != 0)
         return DEVICE_I2C_ERROR;
 
-    // Configure for a latched interrupt request.
-    value = 0x08;
+    // Configure for a latched interrupt request, and enable the FIFO if batching.
+    value = batchSize > 1 ? 0x48 : 0x08;
     result = i2c.writeRegister(address, LIS3DH_CTRL_REG5, value);
     if (result != 0)
         return DEVICE_I2C_ERROR;
 
+    // Place the FIFO in stream mode with a watermark of one batch, or bypass it entirely.
+    value = batchSize > 1 ? LIS3DH_FIFO_MODE_STREAM | (batchSize - 1) : LIS3DH_FIFO_MODE_BYPASS;
+    result = i2c.writeRegister(address, LIS3DH_FIFO_CTRL_REG, value);
+    if (result != 0)
+        return DEVICE_I2C_ERROR;
+
     return DEVICE_OK;
 }
 
+/**
+  * Configures the LIS3DH hardware FIFO to deliver the given number of samples per batch.
+  * When enabled, the INT1 line signals the FIFO watermark rather than each new sample, and
+  * the whole FIFO is drained in a single burst read.
+  *
+  * @param samples The requested number of samples per batch, up to LIS3DH_FIFO_DEPTH. A value of 1 disables batching.
+  *
+  * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the accelerometer could not be configured,
+  *         or DEVICE_NO_RESOURCES if the sample buffer could not be allocated.
+  */
+int LIS3DH::setBatchSize(int samples)
+{
+    uint8_t previous = batchSize;
+
+    samples = max(1, min(samples, min(LIS3DH_FIFO_DEPTH, ACCELEROMETER_MAX_BATCH_SIZE)));
+
+    if (samples > 1 && batch == NULL)
+    {
+        batch = (Sample3D *) malloc(LIS3DH_FIFO_DEPTH * sizeof(Sample3D));
+
+        if (batch == NULL)
+            return DEVICE_NO_RESOURCES;
+    }
+
+    batchSize = samples;
+
+    int result = configure();
+
+    // Leave the previous configuration in place if the new one could not be applied.
+    if (result != DEVICE_OK)
+    {
+        batchSize = previous;
+        configure();
+    }
+
+    return result;
+}
+
+/**
+  * Converts a single raw XYZ frame read from the LIS3DH into a sample in milli-g.
+  */
+static Sample3D lis3dh_decode(int8_t *data, int range)
+{
+    Sample3D s;
+
+    // read MSB values...
+    s.x = data[1];
+    s.y = data[3];
+    s.z = data[5];
+
+    // Normalize the data in the 0..1024 range.
+    s.x *= 8;
+    s.y *= 8;
+    s.z *= 8;
+
+#if CONFIG_ENABLED(USE_ACCEL_LSB)
+    // Add in LSB values.
+    s.x += (data[0] / 64);
+    s.y += (data[2] / 64);
+    s.z += (data[4] / 64);
+#endif
+
+    // Scale into millig (approx!). (LIS3DH is ENU aligned)
+    s.x *= range;
+    s.y *= range;
+    s.z *= range;
+
+    return s;
+}
+
 
 /**
   * Attempts to read the 8 bit ID from the accelerometer, this can be used for
@@ -179,46 +256,61 @@ int LIS3DH::requestUpdate()
     // Poll interrupt line from accelerometer.
     if(int1.getDigitalValue() == 1)
     {
-        int8_t data[6];
-        uint8_t src;
         int result;
 
-        // read the XYZ data (16 bit)
-        // n.b. we need to set the MSB bit to enable multibyte transfers from this device (WHY? Who Knows!)
-        result = i2c.readRegister(address, 0x80 | LIS3DH_OUT_X_L, (uint8_t *)data, 6);
+        if (batchSize > 1)
+        {
+            int8_t *data;
+            int src;
+            int count;
 
-        if (result !=0)
-            return DEVICE_I2C_ERROR;
+            // Determine how many samples are waiting in the FIFO.
+            src = i2c.readRegister(address, LIS3DH_FIFO_SRC_REG);
+            if (src < 0)
+                return DEVICE_I2C_ERROR;
 
-        target_wait_us(3);
+            count = (src & LIS3DH_FIFO_SRC_OVRN) ? LIS3DH_FIFO_DEPTH : (src & LIS3DH_FIFO_SRC_FSS);
+            if (count == 0)
+                return DEVICE_OK;
 
-        // Acknowledge the interrupt.
-        i2c.readRegister(address, LIS3DH_INT1_SRC, &src, 1);
+            // Drain the FIFO in a single burst. In FIFO mode the register address wraps back to
+            // LIS3DH_OUT_X_L after LIS3DH_OUT_Z_H, so each successive frame is a new sample.
+            // The raw frames are read into the end of the sample buffer, and decoded in place. Each sample
+            // is larger than its raw frame, so decoding a sample never overwrites a frame yet to be decoded.
+            data = (int8_t *)(batch + LIS3DH_FIFO_DEPTH) - count * 6;
+            result = i2c.readRegister(address, 0x80 | LIS3DH_OUT_X_L, (uint8_t *)data, count * 6);
 
-        // read MSB values...
-        sampleENU.x = data[1];
-        sampleENU.y = data[3];
-        sampleENU.z = data[5];
+            if (result !=0)
+                return DEVICE_I2C_ERROR;
 
-        // Normalize the data in the 0..1024 range.
-        sampleENU.x *= 8;
-        sampleENU.y *= 8;
-        sampleENU.z *= 8;
+            for (int i = 0; i < count; i++)
+                batch[i] = lis3dh_decode(&data[i * 6], this->sampleRange);
 
-#if CONFIG_ENABLED(USE_ACCEL_LSB)
-        // Add in LSB values.
-        sampleENU.x += (data[0] / 64);
-        sampleENU.y += (data[2] / 64);
-        sampleENU.z += (data[4] / 64);
-#endif
+            // Indicate that new samples are available
+            updateBatch(batch, count);
+        }
+        else
+        {
+            int8_t data[6];
+            uint8_t src;
+
+            // read the XYZ data (16 bit)
+            // n.b. we need to set the MSB bit to enable multibyte transfers from this device (WHY? Who Knows!)
+            result = i2c.readRegister(address, 0x80 | LIS3DH_OUT_X_L, (uint8_t *)data, 6);
+
+            if (result !=0)
+                return DEVICE_I2C_ERROR;
+
+            target_wait_us(3);
+
+            // Acknowledge the interrupt.
+            i2c.readRegister(address, LIS3DH_INT1_SRC, &src, 1);
+
+            sampleENU = lis3dh_decode(data, this->sampleRange);
 
-        // Scale into millig (approx!). (LIS3DH is ENU aligned)
-        sampleENU.x *= this->sampleRange;
-        sampleENU.y *= this->sampleRange;
-        sampleENU.z *= this->sampleRange;
- 
-        // Indicate that a new sample is available
-        update();
+            // Indicate that a new sample is available
+            update();
+        }
     }
 
     return DEVICE_OK;
@@ -240,6 +332,7 @@ void LIS3DH::idleCallback()
   */
 LIS3DH::~LIS3DH()
 {
+    free(batch);
 }
 
 int LIS3DH::setSleep(bool sleepMode)
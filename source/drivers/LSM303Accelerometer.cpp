@@ -42,19 +42,19 @@ using namespace codal;
 // Configuration table for available g force ranges.
 // Maps g ->  CTRL_REG4 full scale selection bits [4..5]
 //
-static const KeyValueTableEntry accelerometerRangeData[] = {
+static constexpr KeyValueTableEntry accelerometerRangeData[] = {
     {2, 0x00},
     {4, 0x10},
     {8, 0x20},
     {16, 0x30}
 };
-CREATE_KEY_VALUE_TABLE(accelerometerRange, accelerometerRangeData);
+CREATE_CHECKED_KEY_VALUE_TABLE(accelerometerRange, accelerometerRangeData);
 
 //
 // Configuration table for available data update frequency.
 // maps microsecond period -> CTRL_REG1 data rate selection bits [4..7]
 //
-static const KeyValueTableEntry accelerometerPeriodData[] = {
+static constexpr KeyValueTableEntry accelerometerPeriodData[] = {
     {617, 0x80},
     {744, 0x90},
     {2500, 0x70},
@@ -65,7 +65,7 @@ static const KeyValueTableEntry accelerometerPeriodData[] = {
     {100000, 0x20},
     {1000000, 0x10}
 };
-CREATE_KEY_VALUE_TABLE(accelerometerPeriod, accelerometerPeriodData);
+CREATE_CHECKED_KEY_VALUE_TABLE(accelerometerPeriod, accelerometerPeriodData);
 
 
 /**
@@ -81,6 +81,7 @@ LSM303Accelerometer::LSM303Accelerometer(I2C& _i2c, Pin &_int1, CoordinateSpace
     // Store our identifiers.
     this->status = 0;
     this->address = address;
+    this->batch = NULL;
 
     // Configure and enable the accelerometer.
     configure();
@@ -115,14 +116,30 @@ int LSM303Accelerometer::configure()
         return DEVICE_I2C_ERROR;
     }
 
-    // Enable the DRDY1 interrupt on INT1 pin.
-    result = i2c.writeRegister(address, LSM303_CTRL_REG3_A, 0x10);
+    // Enable the DRDY1 interrupt on INT1 pin, or the FIFO watermark interrupt if batching.
+    result = i2c.writeRegister(address, LSM303_CTRL_REG3_A, batchSize > 1 ? 0x04 : 0x10);
     if (result != 0)
     {
         DMESG("LSM303 INIT: ERROR WRITING LSM303_CTRL_REG3_A");
         return DEVICE_I2C_ERROR;
     }
 
+    // Enable the FIFO if batching.
+    result = i2c.writeRegister(address, LSM303_CTRL_REG5_A, batchSize > 1 ? 0x40 : 0x00);
+    if (result != 0)
+    {
+        DMESG("LSM303 INIT: ERROR WRITING LSM303_CTRL_REG5_A");
+        return DEVICE_I2C_ERROR;
+    }
+
+    // Place the FIFO in stream mode with a watermark of one batch, or bypass it entirely.
+    result = i2c.writeRegister(address, LSM303_FIFO_CTRL_REG_A, batchSize > 1 ? LSM303_A_FIFO_MODE_STREAM | (batchSize - 1) : LSM303_A_FIFO_MODE_BYPASS);
+    if (result != 0)
+    {
+        DMESG("LSM303 INIT: ERROR WRITING LSM303_FIFO_CTRL_REG_A");
+        return DEVICE_I2C_ERROR;
+    }
+
     // Select the g range to that requested, using little endian data format and disable self-test and high rate functions.
     result = i2c.writeRegister(address, LSM303_CTRL_REG4_A, 0x80 | accelerometerRange.get(sampleRange));
     if (result != 0)
@@ -134,6 +151,64 @@ int LSM303Accelerometer::configure()
     return DEVICE_OK;
 }
 
+/**
+ * Configures the hardware FIFO to deliver the given number of samples per batch.
+ * When enabled, the INT1 line signals the FIFO watermark rather than each new sample, and
+ * the whole FIFO is drained in a single burst read.
+ *
+ * @param samples The requested number of samples per batch, up to LSM303_A_FIFO_DEPTH. A value of 1 disables batching.
+ *
+ * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the accelerometer could not be configured,
+ *         or DEVICE_NO_RESOURCES if the sample buffer could not be allocated.
+ */
+int LSM303Accelerometer::setBatchSize(int samples)
+{
+    uint8_t previous = batchSize;
+
+    samples = max(1, min(samples, min(LSM303_A_FIFO_DEPTH, ACCELEROMETER_MAX_BATCH_SIZE)));
+
+    if (samples > 1 && batch == NULL)
+    {
+        batch = (Sample3D *) malloc(LSM303_A_FIFO_DEPTH * sizeof(Sample3D));
+
+        if (batch == NULL)
+            return DEVICE_NO_RESOURCES;
+    }
+
+    batchSize = samples;
+
+    int result = configure();
+
+    // Leave the previous configuration in place if the new one could not be applied.
+    if (result != DEVICE_OK)
+    {
+        batchSize = previous;
+        configure();
+    }
+
+    return result;
+}
+
+/**
+ * Converts a single raw XYZ frame read from the device into a sample in milli-g, in ENU format.
+ */
+Sample3D LSM303Accelerometer::decodeSample(uint8_t *data)
+{
+    Sample3D s;
+
+    // Read in each reading as a 16 bit little endian value, and scale to 10 bits.
+    int16_t x = ((int16_t) (data[0] | (data[1] << 8))) / 32;
+    int16_t y = ((int16_t) (data[2] | (data[3] << 8))) / 32;
+    int16_t z = ((int16_t) (data[4] | (data[5] << 8))) / 32;
+
+    // Scale into millig (approx) and align to ENU coordinate system
+    s.x = -((int)y) * sampleRange;
+    s.y = -((int)x) * sampleRange;
+    s.z =  ((int)z) * sampleRange;
+
+    return s;
+}
+
 /**
  * Poll to see if new data is available from the hardware. If so, update it.
  * n.b. it is not necessary to explicitly call this funciton to update data
@@ -168,9 +243,6 @@ int LSM303Accelerometer::requestUpdate()
         {
             uint8_t data[6];
             int result;
-            int16_t *x;
-            int16_t *y;
-            int16_t *z;
 
     #if CONFIG_ENABLED(DEVICE_I2C_IRQ_SHARED)
             // Determine if this device has all its data ready (we may be on a shared IRQ line)
@@ -184,29 +256,53 @@ int LSM303Accelerometer::requestUpdate()
             }
     #endif
 
-            // Read the combined accelerometer and magnetometer data.
-            result = i2c.readRegister(address, LSM303_OUT_X_L_A | 0x80, data, 6);
-            awaitSample = false;
+            if (batchSize > 1)
+            {
+                uint8_t *fifo;
+                int src;
+                int count;
+
+                // Determine how many samples are waiting in the FIFO.
+                src = i2c.readRegister(address, LSM303_FIFO_SRC_REG_A);
+                awaitSample = false;
 
-            if (result !=0)
-                return DEVICE_I2C_ERROR;
+                if (src < 0)
+                    return DEVICE_I2C_ERROR;
 
-            // Read in each reading as a 16 bit little endian value, and scale to 10 bits.
-            x = ((int16_t *) &data[0]);
-            y = ((int16_t *) &data[2]);
-            z = ((int16_t *) &data[4]);
+                count = (src & LSM303_A_FIFO_SRC_OVRN) ? LSM303_A_FIFO_DEPTH : (src & LSM303_A_FIFO_SRC_FSS);
+                if (count == 0)
+                    return DEVICE_OK;
+
+                // Drain the FIFO in a single burst. In FIFO mode the register address wraps back to
+                // LSM303_OUT_X_L_A after LSM303_OUT_Z_H_A, so each successive frame is a new sample.
+                // The raw frames are read into the end of the sample buffer, and decoded in place. Each sample
+                // is larger than its raw frame, so decoding a sample never overwrites a frame yet to be decoded.
+                fifo = (uint8_t *)(batch + LSM303_A_FIFO_DEPTH) - count * 6;
+                result = i2c.readRegister(address, LSM303_OUT_X_L_A | 0x80, fifo, count * 6);
 
-            *x = *x / 32;
-            *y = *y / 32;
-            *z = *z / 32;
+                if (result !=0)
+                    return DEVICE_I2C_ERROR;
 
-            // Scale into millig (approx) and align to ENU coordinate system
-            sampleENU.x = -((int)(*y)) * sampleRange;
-            sampleENU.y = -((int)(*x)) * sampleRange;
-            sampleENU.z =  ((int)(*z)) * sampleRange;
+                for (int i = 0; i < count; i++)
+                    batch[i] = decodeSample(&fifo[i * 6]);
 
-            // indicate that new data is available.
-            update();
+                // indicate that new data is available.
+                updateBatch(batch, count);
+            }
+            else
+            {
+                // Read the combined accelerometer and magnetometer data.
+                result = i2c.readRegister(address, LSM303_OUT_X_L_A | 0x80, data, 6);
+                awaitSample = false;
+
+                if (result !=0)
+                    return DEVICE_I2C_ERROR;
+
+                sampleENU = decodeSample(data);
+
+                // indicate that new data is available.
+                update();
+            }
         }
     } while (awaitSample);
 
@@ -261,5 +357,6 @@ int LSM303Accelerometer::isDetected(I2C &i2c, uint16_t address)
  */
 LSM303Accelerometer::~LSM303Accelerometer()
 {
+    free(batch);
 }
 
@@ -43,13 +43,13 @@ using namespace codal;
 // Configuration table for available data update frequency.
 // maps microsecond period -> LSM303_CFG_REG_A_M data rate selection bits [2..3]
 //
-static const KeyValueTableEntry magnetometerPeriodData[] = {
+static constexpr KeyValueTableEntry magnetometerPeriodData[] = {
     {10000, 0x0C},             // 100 Hz
     {20000, 0x08},             // 50 Hz
     {50000, 0x04},             // 20 Hz
     {100000, 0x00}             // 10 Hz
 };
-CREATE_KEY_VALUE_TABLE(magnetometerPeriod, magnetometerPeriodData);
+CREATE_CHECKED_KEY_VALUE_TABLE(magnetometerPeriod, magnetometerPeriodData);
 
 
 /**
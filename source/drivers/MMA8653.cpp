@@ -33,8 +33,36 @@ DEALINGS IN THE SOFTWARE.
 #include "CodalComponent.h"
 #include "MMA8653.h"
 #include "ErrorNo.h"
+#include "CodalUtil.h"
 
 using namespace codal;
+
+//
+// Configuration table for available g force ranges.
+// Maps g -> XYZ_DATA_CFG bit [0..1]
+//
+static constexpr KeyValueTableEntry accelerometerRangeData[] = {
+    {2, 0},
+    {4, 1},
+    {8, 2}
+};
+CREATE_CHECKED_KEY_VALUE_TABLE(accelerometerRange, accelerometerRangeData);
+
+//
+// Configuration table for available data update frequency.
+// Maps microsecond period -> CTRL_REG1 data rate selection bits [3..5]
+//
+static constexpr KeyValueTableEntry accelerometerPeriodData[] = {
+    {1250,      0x00},
+    {2500,      0x08},
+    {5000,      0x10},
+    {10000,     0x18},
+    {20000,     0x20},
+    {80000,     0x28},
+    {160000,    0x30},
+    {640000,    0x38}
+};
+CREATE_CHECKED_KEY_VALUE_TABLE(accelerometerPeriod, accelerometerPeriodData);
 /**
   * Configures the accelerometer for G range and sample rate defined
   * in this object. The nearest values are chosen to those defined
@@ -45,33 +73,15 @@ using namespace codal;
   */
 int MMA8653::configure()
 {
-    const MMA8653SampleRangeConfig  *actualSampleRange;
-    const MMA8653SampleRateConfig  *actualSampleRate;
     int result;
 
-    // First find the nearest sample rate to that specified.
-    actualSampleRate = &MMA8653SampleRate[MMA8653_SAMPLE_RATES-1];
-    for (int i=MMA8653_SAMPLE_RATES-1; i>=0; i--)
-    {
-        if(MMA8653SampleRate[i].sample_period < this->samplePeriod * 1000)
-            break;
-
-        actualSampleRate = &MMA8653SampleRate[i];
-    }
-
-    // Now find the nearest sample range to that specified.
-    actualSampleRange = &MMA8653SampleRange[MMA8653_SAMPLE_RANGES-1];
-    for (int i=MMA8653_SAMPLE_RANGES-1; i>=0; i--)
-    {
-        if(MMA8653SampleRange[i].sample_range < this->sampleRange)
-            break;
-
-        actualSampleRange = &MMA8653SampleRange[i];
-    }
+    // First find the nearest sample rate and range to those specified.
+    const KeyValueTableEntry *actualSampleRate = accelerometerPeriod.find(this->samplePeriod * 1000);
+    const KeyValueTableEntry *actualSampleRange = accelerometerRange.find(this->sampleRange);
 
     // OK, we have the correct data. Update our local state.
-    this->samplePeriod = actualSampleRate->sample_period / 1000;
-    this->sampleRange = actualSampleRange->sample_range;
+    this->samplePeriod = actualSampleRate->key / 1000;
+    this->sampleRange = actualSampleRange->key;
 
     // Now configure the accelerometer accordingly.
     // First place the device into standby mode, so it can be configured.
@@ -95,12 +105,12 @@ int MMA8653::configure()
         return DEVICE_I2C_ERROR;
 
     // Configure for the selected g range.
-    result = i2c.writeRegister(this->address, MMA8653_XYZ_DATA_CFG, actualSampleRange->xyz_data_cfg);
+    result = i2c.writeRegister(this->address, MMA8653_XYZ_DATA_CFG, actualSampleRange->value);
     if (result != DEVICE_OK)
         return DEVICE_I2C_ERROR;
 
     // Bring the device back online, with 10bit wide samples at the requested frequency.
-    result = i2c.writeRegister(this->address, MMA8653_CTRL_REG1, actualSampleRate->ctrl_reg1 | 0x01);
+    result = i2c.writeRegister(this->address, MMA8653_CTRL_REG1, actualSampleRate->value | 0x01);
     if (result != DEVICE_OK)
         return DEVICE_I2C_ERROR;
 
@@ -228,21 +238,3 @@ int MMA8653::setSleep(bool sleepMode)
     else
         return configure();
 }
-
-
-const MMA8653SampleRangeConfig MMA8653SampleRange[MMA8653_SAMPLE_RANGES] = {
-    {2, 0},
-    {4, 1},
-    {8, 2}
-};
-
-const MMA8653SampleRateConfig MMA8653SampleRate[MMA8653_SAMPLE_RATES] = {
-    {1250,      0x00},
-    {2500,      0x08},
-    {5000,      0x10},
-    {10000,     0x18},
-    {20000,     0x20},
-    {80000,     0x28},
-    {160000,    0x30},
-    {640000,    0x38}
-};
@@ -175,7 +175,7 @@ void MessageBus::queueEvent(Event &evt)
     if (queueLength >= MESSAGE_BUS_LISTENER_MAX_QUEUE_DEPTH)
     {
         // Note that this can lead to strange lockups, where we await an event that never arrives.
-        DMESG("evt %d/%d: overflow!", evt.source, evt.value);
+        DMESG_WARN(BUS, "evt %d/%d: overflow!", evt.source, evt.value);
         return;
     }
 
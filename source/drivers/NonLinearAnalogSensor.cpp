@@ -28,6 +28,8 @@ DEALINGS IN THE SOFTWARE.
  */
 
 #include "NonLinearAnalogSensor.h"
+#include "CodalCompat.h"
+#include <math.h>
 
 using namespace codal;
 
@@ -50,6 +52,110 @@ NonLinearAnalogSensor::NonLinearAnalogSensor(Pin &pin, uint16_t id, float nomina
     this->beta = beta;
     this->seriesResistor = seriesResistor;
     this->zeroOffset = zeroOffset;
+
+#if CONFIG_ENABLED(NON_LINEAR_ANALOG_SENSOR_LUT)
+    buildLookupTable();
+#endif
+}
+
+#if CONFIG_ENABLED(NON_LINEAR_ANALOG_SENSOR_LUT)
+/**
+ * Converts the given value into 24.8 fixed point.
+ */
+static int32_t toFixedPoint(float v)
+{
+    // Keep the fixed point representation within range.
+    if (v != v)
+        v = 0.0f;
+
+    v = fmaxf(-32768.0f, fminf(32767.0f, v));
+
+    return (int32_t)(v * 256.0f);
+}
+
+/**
+ * Populates the lookup table from the Beta equation.
+ *
+ * The curve is too steep in the first and last segments to interpolate linearly across them, so those are
+ * covered by separate entries whose spacing halves towards each end of the range. Readings of 0 and 1023,
+ * where the equation is degenerate, take the value at 1 and 1022 respectively.
+ */
+void NonLinearAnalogSensor::buildLookupTable()
+{
+    for (int i = 0; i < NON_LINEAR_ANALOG_SENSOR_LUT_SIZE; i++)
+        lut[i] = toFixedPoint(convertReading(i << NON_LINEAR_ANALOG_SENSOR_LUT_SHIFT));
+
+    for (int k = 0; k <= NON_LINEAR_ANALOG_SENSOR_LUT_SHIFT; k++)
+    {
+        lutEnds[0][k] = toFixedPoint(convertReading(1 << k));
+        lutEnds[1][k] = toFixedPoint(convertReading(1023 - (1 << k)));
+    }
+}
+#endif
+
+/**
+ * Converts a raw reading into SI units by evaluating the Beta equation directly, in floating point.
+ * This is the reference conversion from which the lookup table is built.
+ *
+ * @param reading The raw reading from the sensor, in the range 0..1023.
+ *
+ * @return The sensed value, in SI units.
+ */
+float NonLinearAnalogSensor::convertReading(int reading)
+{
+    float sensorReading;
+
+    sensorReading = (((1023.0f) * this->seriesResistor) / reading) - this->seriesResistor;
+    return (1.0f / ((log(sensorReading / this->nominalReading) / this->beta) + (1.0f / (this->nominalValue + this->zeroOffset)))) - this->zeroOffset;
+}
+
+/**
+ * Converts a raw reading into SI units, using the lookup table if enabled.
+ *
+ * @param reading The raw reading from the sensor, in the range 0..1023.
+ *
+ * @return The sensed value, in SI units.
+ */
+int NonLinearAnalogSensor::convert(int reading)
+{
+#if CONFIG_ENABLED(NON_LINEAR_ANALOG_SENSOR_LUT)
+    reading = max(0, min(1023, reading));
+
+    int i = reading >> NON_LINEAR_ANALOG_SENSOR_LUT_SHIFT;
+    const int32_t *nodes = lut;
+    int fraction;
+    int shift;
+
+    if (i == 0 || i == NON_LINEAR_ANALOG_SENSOR_LUT_SIZE - 2)
+    {
+        // Interpolate by the distance from the nearer end, between the entries either side of it.
+        int distance = max(1, i ? 1023 - reading : reading);
+
+        nodes = lutEnds[i ? 1 : 0];
+        shift = 0;
+
+        while (distance >> (shift + 1))
+            shift++;
+
+        if (shift == NON_LINEAR_ANALOG_SENSOR_LUT_SHIFT)
+            return nodes[shift] / 256;
+
+        i = shift;
+        fraction = distance - (1 << shift);
+    }
+    else
+    {
+        fraction = reading & ((1 << NON_LINEAR_ANALOG_SENSOR_LUT_SHIFT) - 1);
+        shift = NON_LINEAR_ANALOG_SENSOR_LUT_SHIFT;
+    }
+
+    // The product may exceed 32 bits when the table is coarse.
+    int32_t value = nodes[i] + (int32_t)(((int64_t)(nodes[i + 1] - nodes[i]) * fraction) >> shift);
+
+    return value / 256;
+#else
+    return (int)convertReading(reading);
+#endif
 }
 
 /**
@@ -59,16 +165,14 @@ NonLinearAnalogSensor::NonLinearAnalogSensor(Pin &pin, uint16_t id, float nomina
  */
 void NonLinearAnalogSensor::updateSample()
 {
-    float sensorReading;
-    float value;
-
-    sensorReading = (((1023.0f) * this->seriesResistor) / this->readValue()) - this->seriesResistor;
-    value = (1.0f / ((log(sensorReading / this->nominalReading) / this->beta) + (1.0f / (this->nominalValue + this->zeroOffset)))) - this->zeroOffset;
+    int value = convert(this->readValue());
+    uint16_t previousValue = this->sensorValue;
 
     // If this is the first reading performed, take it a a baseline. Otherwise, perform a decay average to smooth out the data.
     if (!(status & ANALOG_SENSOR_INITIALISED))
     {
         this->sensorValue = value;
+        previousValue = this->sensorValue;
         this->status |=  ANALOG_SENSOR_INITIALISED;
     }
     else
@@ -77,4 +181,7 @@ void NonLinearAnalogSensor::updateSample()
     }
 
     checkThresholding();
+
+    if (this->status & SENSOR_ADAPTIVE_ENABLED)
+        adaptSamplePeriod(previousValue);
 }
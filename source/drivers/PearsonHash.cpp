@@ -23,48 +23,66 @@ const unsigned char hashTable[256] = {
 };
 
 // REF: https://en.wikipedia.org/wiki/Pearson_hashing
-inline unsigned char eightBitHash(const char* s)
+// Hashes the string formed by the character first, followed by the string rest.
+inline unsigned char eightBitHash(char first, const char* rest)
 {
     unsigned char hash = 0;
-    for (char c = *s++; c; c = *s++) hash = hashTable[hash ^ c];
+
+    if (first == 0)
+        return hash;
+
+    hash = hashTable[hash ^ first];
+
+    for (char c = *rest++; c; c = *rest++) hash = hashTable[hash ^ c];
     return hash;
 }
 
-uint32_t PearsonHash::hashN(ManagedString s, uint8_t byteCount)
+uint32_t PearsonHash::hashN(const char *s, uint8_t byteCount)
 {
-    unsigned char hash;
-    uint32_t length = s.length() + 1;
-    char *buffer = (char *)malloc(length);
-
-    memcpy(buffer, s.toCharArray(), length);
+    // Each successive byte of the hash is calculated with the first character of the string incremented,
+    // which we apply on the fly rather than modifying a copy of the string.
+    char first = s[0];
+    const char *rest = first ? s + 1 : s;
 
     uint32_t res = 0;
     uint32_t i = 0;
 
     while (i < byteCount)
     {
-        hash = eightBitHash(buffer);
-        res |= (hash << (i * 8));
-        buffer[0] = (buffer[0] + 1) % 255;
+        res |= (eightBitHash(first, rest) << (i * 8));
+        first = (first + 1) % 255;
         i++;
     }
 
-    free(buffer);
-
     return res;
 }
 
 uint8_t PearsonHash::hash8(ManagedString s)
 {
-    return (uint8_t)hashN(s, 1);
+    return (uint8_t)hashN(s.toCharArray(), 1);
 }
 
 uint16_t PearsonHash::hash16(ManagedString s)
 {
-    return (uint16_t)hashN(s,2);
+    return (uint16_t)hashN(s.toCharArray(), 2);
 }
 
 uint32_t PearsonHash::hash32(ManagedString s)
 {
-    return (uint32_t)hashN(s,4);
-}
\ No newline at end of file
+    return (uint32_t)hashN(s.toCharArray(), 4);
+}
+
+uint8_t PearsonHash::hash8(const char *s)
+{
+    return (uint8_t)hashN(s, 1);
+}
+
+uint16_t PearsonHash::hash16(const char *s)
+{
+    return (uint16_t)hashN(s, 2);
+}
+
+uint32_t PearsonHash::hash32(const char *s)
+{
+    return (uint32_t)hashN(s, 4);
+}
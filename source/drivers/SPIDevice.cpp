@@ -0,0 +1,107 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "SPIDevice.h"
+#include "ErrorNo.h"
+
+using namespace codal;
+
+/**
+ * Constructor.
+ *
+ * @param spi The SPI bus the device is attached to.
+ * @param cs The chip select pin of the device.
+ * @param frequency The bus frequency to use with this device, in hertz.
+ * @param mode The SPI mode to use with this device (0 - 3). Defaults to 0.
+ * @param bits The number of bits per SPI frame. Defaults to 8.
+ */
+SPIDevice::SPIDevice(SPI &spi, Pin &cs, uint32_t frequency, int mode, int bits) : spi(spi), cs(cs)
+{
+    this->frequency = frequency;
+    this->mode = mode;
+    this->bits = bits;
+
+    cs.setDigitalValue(1);
+}
+
+/**
+ * Gains exclusive use of the bus, configures it for this device, and asserts the chip select.
+ * Blocks the calling fiber until the bus is available.
+ *
+ * @return DEVICE_OK on success, or an error code if the bus could not be configured.
+ */
+int SPIDevice::begin()
+{
+    if (spi.acquire(this))
+    {
+        int result = spi.setFrequency(frequency);
+
+        if (result == DEVICE_OK)
+            result = spi.setMode(mode, bits);
+
+        if (result != DEVICE_OK)
+        {
+            spi.release(true);
+            return result;
+        }
+    }
+
+    cs.setDigitalValue(0);
+
+    return DEVICE_OK;
+}
+
+/**
+ * Releases the chip select, and releases the bus for use by other devices.
+ *
+ * @return DEVICE_OK.
+ */
+int SPIDevice::end()
+{
+    cs.setDigitalValue(1);
+    spi.release();
+
+    return DEVICE_OK;
+}
+
+/**
+ * Performs a complete transaction with this device: begin(), SPI::transfer(), end().
+ *
+ * Either buffer can be NULL.
+ *
+ * @return DEVICE_OK on success, or DEVICE_SPI_ERROR if the transfer failed.
+ */
+int SPIDevice::transfer(const uint8_t *txBuffer, uint32_t txSize, uint8_t *rxBuffer, uint32_t rxSize)
+{
+    int result = begin();
+
+    if (result != DEVICE_OK)
+        return result;
+
+    result = spi.transfer(txBuffer, txSize, rxBuffer, rxSize);
+    end();
+
+    return result;
+}
@@ -0,0 +1,233 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "SPIFlashMSC.h"
+
+#if CONFIG_ENABLED(DEVICE_USB)
+
+#include "EventModel.h"
+#include "Timer.h"
+#include "ErrorNo.h"
+
+using namespace codal;
+
+#define BLOCKS_PER_SECTOR (SPIFLASH_SMALL_ROW_SIZE / USBMSC_BLOCK_SIZE)
+
+SPIFlashMSC::SPIFlashMSC(SPIFlash &flash, uint32_t start, uint32_t length) : flash(flash)
+{
+    // Only expose whole sectors, so that erasing a sector never reaches outside of the region.
+    uint32_t offset = (SPIFLASH_SMALL_ROW_SIZE - start % SPIFLASH_SMALL_ROW_SIZE) % SPIFLASH_SMALL_ROW_SIZE;
+    length = length > offset ? length - offset : 0;
+
+    this->start = start + offset;
+    this->blocks = (length / SPIFLASH_SMALL_ROW_SIZE) * BLOCKS_PER_SECTOR;
+    this->cachedSector = -1;
+    this->dirty = 0;
+    this->needsErase = false;
+    this->listening = false;
+    this->cache = NULL;
+}
+
+uint32_t SPIFlashMSC::getCapacity()
+{
+    return blocks;
+}
+
+/**
+ * Reads the given sector into cache, unless it is already held there.
+ */
+int SPIFlashMSC::loadSector(int sector)
+{
+    if (sector == cachedSector)
+        return DEVICE_OK;
+
+    int r = writeBack();
+    if (r != DEVICE_OK)
+        return r;
+
+    if (cache == NULL)
+    {
+        cache = (uint8_t *)malloc(SPIFLASH_SMALL_ROW_SIZE);
+        if (cache == NULL)
+            return DEVICE_NO_RESOURCES;
+    }
+
+    cachedSector = -1;
+
+    r = flash.readBytes(start + sector * SPIFLASH_SMALL_ROW_SIZE, cache, SPIFLASH_SMALL_ROW_SIZE);
+    if (r != DEVICE_OK)
+        return r;
+
+    cachedSector = sector;
+
+    return DEVICE_OK;
+}
+
+/**
+ * Writes any modified pages of the cached sector to flash.
+ */
+int SPIFlashMSC::writeBack()
+{
+    int r = DEVICE_OK;
+
+    if (cachedSector < 0 || dirty == 0)
+        return DEVICE_OK;
+
+    uint32_t address = start + cachedSector * SPIFLASH_SMALL_ROW_SIZE;
+
+    if (needsErase)
+    {
+        r = flash.eraseSmallRow(address);
+
+        // Every page that is not blank must now be programmed.
+        for (int p = 0; p < SPIFLASH_SMALL_ROW_PAGES; p++)
+        {
+            uint32_t *data = (uint32_t *)(cache + p * SPIFLASH_PAGE_SIZE);
+            dirty &= ~(1 << p);
+
+            for (unsigned i = 0; i < SPIFLASH_PAGE_SIZE / 4; i++)
+            {
+                if (data[i] != 0xFFFFFFFF)
+                {
+                    dirty |= 1 << p;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int p = 0; p < SPIFLASH_SMALL_ROW_PAGES && r == DEVICE_OK; p++)
+        if (dirty & (1 << p))
+            r = flash.writeBytes(address + p * SPIFLASH_PAGE_SIZE, cache + p * SPIFLASH_PAGE_SIZE, SPIFLASH_PAGE_SIZE);
+
+    // On failure, the cache no longer reflects flash, so discard it rather than retrying indefinitely.
+    if (r != DEVICE_OK)
+        cachedSector = -1;
+
+    dirty = 0;
+    needsErase = false;
+
+    return r;
+}
+
+int SPIFlashMSC::readBlock(uint32_t blockAddr, uint8_t *dest)
+{
+    int r = DEVICE_OK;
+
+    if (blockAddr >= blocks)
+        return DEVICE_INVALID_PARAMETER;
+
+    lock.wait();
+
+    if ((int32_t)(blockAddr / BLOCKS_PER_SECTOR) == cachedSector)
+        memcpy(dest, cache + (blockAddr % BLOCKS_PER_SECTOR) * USBMSC_BLOCK_SIZE, USBMSC_BLOCK_SIZE);
+    else
+        r = flash.readBytes(start + blockAddr * USBMSC_BLOCK_SIZE, dest, USBMSC_BLOCK_SIZE);
+
+    lock.notify();
+
+    return r;
+}
+
+int SPIFlashMSC::writeBlock(uint32_t blockAddr, const uint8_t *src)
+{
+    if (blockAddr >= blocks)
+        return DEVICE_INVALID_PARAMETER;
+
+    lock.wait();
+
+    int r = loadSector(blockAddr / BLOCKS_PER_SECTOR);
+
+    if (r == DEVICE_OK)
+    {
+        uint32_t offset = (blockAddr % BLOCKS_PER_SECTOR) * USBMSC_BLOCK_SIZE;
+        uint8_t *dest = cache + offset;
+
+        for (int i = 0; i < USBMSC_BLOCK_SIZE; i++)
+        {
+            if (dest[i] != src[i])
+            {
+                // Programming can only clear bits.
+                if ((dest[i] & src[i]) != src[i])
+                    needsErase = true;
+
+                dirty |= 1 << ((offset + i) / SPIFLASH_PAGE_SIZE);
+                dest[i] = src[i];
+            }
+        }
+    }
+
+    lock.notify();
+
+    return r;
+}
+
+void SPIFlashMSC::writeBlocks(int blockAddr, int numBlocks)
+{
+    USBMSC::writeBlocks(blockAddr, numBlocks);
+
+    // Write the cached sector back once the host has been idle for a while.
+    if (dirty)
+    {
+        if (!listening)
+        {
+            listening = true;
+            EventModel::defaultEventBus->listen(DEVICE_ID_MSC, DEVICE_MSC_EVT_FLUSH, this, &SPIFlashMSC::flushHandler);
+        }
+
+        system_timer_cancel_event(DEVICE_ID_MSC, DEVICE_MSC_EVT_FLUSH);
+        system_timer_event_after(SPIFLASH_MSC_FLUSH_DELAY_MS, DEVICE_ID_MSC, DEVICE_MSC_EVT_FLUSH);
+    }
+}
+
+void SPIFlashMSC::flushHandler(Event)
+{
+    flush();
+}
+
+/**
+ * Writes any data held in cache to flash.
+ *
+ * @return DEVICE_OK on success, or the error reported by the flash device.
+ */
+int SPIFlashMSC::flush()
+{
+    lock.wait();
+    int r = writeBack();
+    lock.notify();
+
+    return r;
+}
+
+SPIFlashMSC::~SPIFlashMSC()
+{
+    if (listening)
+        EventModel::defaultEventBus->ignore(DEVICE_ID_MSC, DEVICE_MSC_EVT_FLUSH, this, &SPIFlashMSC::flushHandler);
+
+    flush();
+    free(cache);
+}
+
+#endif
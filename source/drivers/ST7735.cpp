@@ -268,6 +268,7 @@ void ST7735::sendColorsStep(ST7735 *st)
     {
         if (work->srcLeft == 0)
         {
+            // The bus is released by sendDone().
             st->endCS();
             Event(DEVICE_ID_DISPLAY, 100);
         }
@@ -295,7 +296,7 @@ void ST7735::startRAMWR(int cmd)
     if (cmd == 0)
         cmd = ST7735_RAMWR;
     cmdBuf[0] = cmd;
-    sendCmd(cmdBuf, 1);
+    sendCmdCore(cmdBuf, 1);
 
     setData();
     beginCS();
@@ -305,6 +306,7 @@ void ST7735::sendDone(Event)
 {
     // this executes outside of interrupt context, so we don't get a race
     // with waitForSendDone
+    io.release();
     work->inProgress = false;
     Event(DEVICE_ID_DISPLAY, 101);
 }
@@ -373,6 +375,10 @@ int ST7735::sendIndexedImage(const uint8_t *src, unsigned width, unsigned height
         work->srcLeft *= width;
     work->x = 0;
 
+    // Hold the bus for the whole frame, as other devices must not interleave with the chunks sent by
+    // sendColorsStep(). It is released by sendDone().
+    io.acquire();
+
     sendColorsStep(this);
 
     return DEVICE_OK;
@@ -380,6 +386,14 @@ int ST7735::sendIndexedImage(const uint8_t *src, unsigned width, unsigned height
 
 // we don't modify *buf, but it cannot be in flash, so no const as a hint
 void ST7735::sendCmd(uint8_t *buf, int len)
+{
+    io.acquire();
+    sendCmdCore(buf, len);
+    io.release();
+}
+
+// as sendCmd(), for use while the bus is already held
+void ST7735::sendCmdCore(uint8_t *buf, int len)
 {
     // make sure cmd isn't on stack
     if (buf != cmdBuf)
@@ -3,7 +3,12 @@
 namespace codal
 {
 
-SPIScreenIO::SPIScreenIO(SPI &spi) : spi(spi) {}
+SPIScreenIO::SPIScreenIO(SPI &spi) : frequency(0), mode(0), bits(8), spi(spi) {}
+
+SPIScreenIO::SPIScreenIO(SPI &spi, uint32_t frequency, int mode, int bits)
+    : frequency(frequency), mode(mode), bits(bits), spi(spi)
+{
+}
 
 void SPIScreenIO::send(const void *txBuffer, uint32_t txSize)
 {
@@ -16,4 +21,19 @@ void SPIScreenIO::startSend(const void *txBuffer, uint32_t txSize, PVoidCallback
     spi.startTransfer((const uint8_t *)txBuffer, txSize, NULL, 0, doneHandler, handlerArg);
 }
 
+void SPIScreenIO::acquire()
+{
+    // If another device has used the bus, restore our settings (when we know them).
+    if (spi.acquire(this) && frequency)
+    {
+        spi.setFrequency(frequency);
+        spi.setMode(mode, bits);
+    }
+}
+
+void SPIScreenIO::release()
+{
+    spi.release();
+}
+
 } // namespace codal
\ No newline at end of file
@@ -0,0 +1,700 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+/**
+  * Class definition for SensorFusion.
+  *
+  * Combines the readings of an Accelerometer, Gyroscope and (optionally) a Compass into a single
+  * orientation estimate, using a Mahony style complementary filter.
+  */
+
+#include "SensorFusion.h"
+#include "EventModel.h"
+#include "Timer.h"
+#include "CodalFixedMath.h"
+
+using namespace codal;
+
+#if CONFIG_ENABLED(CODAL_FIXED_POINT_ORIENTATION)
+
+// The value 1.0, and PI/180, in the fixed point format used by the filter.
+#define SENSOR_FUSION_ONE           ((int32_t)1 << SENSOR_FUSION_Q)
+#define SENSOR_FUSION_DEG_TO_RAD    4685082
+
+/**
+  * Multiplies two fixed point values.
+  */
+static inline int32_t fusion_mul(int32_t a, int32_t b)
+{
+    return (int32_t)(((int64_t)a * b) >> SENSOR_FUSION_Q);
+}
+
+/**
+  * Scales the given vector to unit length, in fixed point.
+  *
+  * @return true on success, false if the vector has no length.
+  */
+static bool fusion_normalise(int32_t &x, int32_t &y, int32_t &z)
+{
+    int64_t n = fixed_sqrt((int64_t)x*x + (int64_t)y*y + (int64_t)z*z);
+
+    if (n == 0)
+        return false;
+
+    x = (int32_t)(((int64_t)x << SENSOR_FUSION_Q) / n);
+    y = (int32_t)(((int64_t)y << SENSOR_FUSION_Q) / n);
+    z = (int32_t)(((int64_t)z << SENSOR_FUSION_Q) / n);
+
+    return true;
+}
+
+#else
+
+/**
+  * Scales the given vector to unit length.
+  *
+  * @return true on success, false if the vector has no length.
+  */
+static bool fusion_normalise(float &x, float &y, float &z)
+{
+    float n = sqrtf(x*x + y*y + z*z);
+
+    if (n == 0.0f)
+        return false;
+
+    x /= n;
+    y /= n;
+    z /= n;
+
+    return true;
+}
+
+#endif
+
+/**
+  * Constructor.
+  * Create a software abstraction of a sensor fusion filter, using the given accelerometer and gyroscope.
+  * The yaw reported is relative to the device orientation when the filter started.
+  *
+  * @param accelerometer The accelerometer to use.
+  * @param gyroscope The gyroscope to use.
+  * @param id The id to use for the message bus when transmitting events.
+  */
+SensorFusion::SensorFusion(Accelerometer &accelerometer, Gyroscope &gyroscope, uint16_t id) : accelerometer(accelerometer), gyroscope(gyroscope)
+{
+    this->id = id;
+    this->compass = NULL;
+
+    setup();
+}
+
+/**
+  * Constructor.
+  * Create a software abstraction of a sensor fusion filter, using the given accelerometer, gyroscope and compass.
+  * The yaw reported is the heading of the device relative to magnetic north.
+  *
+  * @param accelerometer The accelerometer to use.
+  * @param gyroscope The gyroscope to use.
+  * @param compass The compass to use.
+  * @param id The id to use for the message bus when transmitting events.
+  */
+SensorFusion::SensorFusion(Accelerometer &accelerometer, Gyroscope &gyroscope, Compass &compass, uint16_t id) : accelerometer(accelerometer), gyroscope(gyroscope)
+{
+    this->id = id;
+    this->compass = &compass;
+
+    setup();
+}
+
+/**
+  * Common initialisation for the constructors.
+  */
+void SensorFusion::setup()
+{
+    kp = SENSOR_FUSION_DEFAULT_KP;
+    ki = SENSOR_FUSION_DEFAULT_KI;
+    gyroSensitivity = SENSOR_FUSION_DEFAULT_GYRO_SENSITIVITY;
+    threshold = FIXED_MATH_DEGREES(SENSOR_FUSION_DEFAULT_THRESHOLD);
+
+    reset();
+
+    if (EventModel::defaultEventBus)
+    {
+        // Accelerometer and compass updates only mark new data as available, so can safely run in interrupt context.
+        // The gyroscope handler reads from the sensors, which may raise further updates, so these are dropped while it is busy.
+        EventModel::defaultEventBus->listen(accelerometer.id, ACCELEROMETER_EVT_DATA_UPDATE, this, &SensorFusion::onAccelerometerUpdate, MESSAGE_BUS_LISTENER_IMMEDIATE);
+        EventModel::defaultEventBus->listen(gyroscope.id, GYROSCOPE_EVT_DATA_UPDATE, this, &SensorFusion::onGyroscopeUpdate, MESSAGE_BUS_LISTENER_DROP_IF_BUSY);
+
+        if (compass)
+            EventModel::defaultEventBus->listen(compass->id, COMPASS_EVT_DATA_UPDATE, this, &SensorFusion::onCompassUpdate, MESSAGE_BUS_LISTENER_IMMEDIATE);
+    }
+}
+
+/**
+  * Configures the gains of the filter.
+  *
+  * @param kp The proportional gain, in thousandths. Larger values trust the accelerometer and compass more.
+  * @param ki The integral gain, in thousandths. Set to zero to disable gyroscope bias estimation.
+  *
+  * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if either gain is negative.
+  */
+int SensorFusion::setGains(int kp, int ki)
+{
+    if (kp < 0 || ki < 0)
+        return DEVICE_INVALID_PARAMETER;
+
+    this->kp = kp;
+    this->ki = ki;
+
+    if (ki == 0)
+        bias[0] = bias[1] = bias[2] = 0;
+
+    return DEVICE_OK;
+}
+
+/**
+  * Defines the scale of the samples provided by the gyroscope.
+  *
+  * @param sensitivity The number of gyroscope sample units that represent one degree per second.
+  *
+  * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the sensitivity is not positive.
+  */
+int SensorFusion::setGyroscopeSensitivity(int sensitivity)
+{
+    if (sensitivity <= 0)
+        return DEVICE_INVALID_PARAMETER;
+
+    gyroSensitivity = sensitivity;
+
+    return DEVICE_OK;
+}
+
+/**
+  * Defines how far the device must rotate before a SENSOR_FUSION_EVT_ORIENTATION_CHANGE event is raised.
+  *
+  * @param degrees The change in pitch, roll or yaw needed to raise an event, in degrees.
+  *
+  * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the threshold is negative.
+  */
+int SensorFusion::setThreshold(int degrees)
+{
+    if (degrees < 0)
+        return DEVICE_INVALID_PARAMETER;
+
+    threshold = FIXED_MATH_DEGREES(degrees);
+
+    return DEVICE_OK;
+}
+
+/**
+  * Discards the current orientation estimate. The filter is reinitialised from the
+  * accelerometer and compass when the next gyroscope sample arrives.
+  */
+void SensorFusion::reset()
+{
+    status &= ~(SENSOR_FUSION_STATUS_INITIALISED | SENSOR_FUSION_STATUS_ACCEL_VALID | SENSOR_FUSION_STATUS_MAG_VALID);
+
+#if CONFIG_ENABLED(CODAL_FIXED_POINT_ORIENTATION)
+    q[0] = SENSOR_FUSION_ONE;
+#else
+    q[0] = 1.0f;
+#endif
+    q[1] = q[2] = q[3] = 0;
+    bias[0] = bias[1] = bias[2] = 0;
+
+    pitch = roll = yaw = 0;
+    reported[0] = reported[1] = reported[2] = 0;
+    lastUpdate = 0;
+}
+
+/**
+  * Converts a sample from the East North Up format used by the driver models into the device NED frame.
+  */
+Sample3D SensorFusion::toNED(Sample3D s)
+{
+    Sample3D result;
+
+    result.x = s.y;
+    result.y = s.x;
+    result.z = -s.z;
+
+    return result;
+}
+
+/**
+  * Seeds the quaternion directly from the latest accelerometer and compass samples.
+  */
+void SensorFusion::initialise()
+{
+    // The accelerometer measures the reaction to gravity, so gravity itself points the opposite way.
+#if CONFIG_ENABLED(CODAL_FIXED_POINT_ORIENTATION)
+    int32_t gx = -accel.x;
+    int32_t gy = -accel.y;
+    int32_t gz = -accel.z;
+
+    int32_t r = fixed_atan2(gy, gz);
+    int32_t p = fixed_atan2(-gx, (int32_t) fixed_sqrt((int64_t)gy*gy + (int64_t)gz*gz));
+    int32_t y = 0;
+
+    if (status & SENSOR_FUSION_STATUS_MAG_VALID)
+    {
+        int32_t mx = mag.x;
+        int32_t my = mag.y;
+        int32_t mz = mag.z;
+
+        fusion_normalise(mx, my, mz);
+
+        int32_t sinR = fixed_sin(r) << (SENSOR_FUSION_Q - FIXED_MATH_SHIFT);
+        int32_t cosR = fixed_cos(r) << (SENSOR_FUSION_Q - FIXED_MATH_SHIFT);
+        int32_t sinP = fixed_sin(p) << (SENSOR_FUSION_Q - FIXED_MATH_SHIFT);
+        int32_t cosP = fixed_cos(p) << (SENSOR_FUSION_Q - FIXED_MATH_SHIFT);
+
+        int32_t hx = fusion_mul(mx, cosP) + fusion_mul(fusion_mul(my, sinP), sinR) + fusion_mul(fusion_mul(mz, sinP), cosR);
+        int32_t hy = fusion_mul(my, cosR) - fusion_mul(mz, sinR);
+
+        y = fixed_atan2(-hy, hx);
+    }
+
+    int32_t sr = fixed_sin(r / 2) << (SENSOR_FUSION_Q - FIXED_MATH_SHIFT);
+    int32_t cr = fixed_cos(r / 2) << (SENSOR_FUSION_Q - FIXED_MATH_SHIFT);
+    int32_t sp = fixed_sin(p / 2) << (SENSOR_FUSION_Q - FIXED_MATH_SHIFT);
+    int32_t cp = fixed_cos(p / 2) << (SENSOR_FUSION_Q - FIXED_MATH_SHIFT);
+    int32_t sy = fixed_sin(y / 2) << (SENSOR_FUSION_Q - FIXED_MATH_SHIFT);
+    int32_t cy = fixed_cos(y / 2) << (SENSOR_FUSION_Q - FIXED_MATH_SHIFT);
+
+    q[0] = fusion_mul(fusion_mul(cr, cp), cy) + fusion_mul(fusion_mul(sr, sp), sy);
+    q[1] = fusion_mul(fusion_mul(sr, cp), cy) - fusion_mul(fusion_mul(cr, sp), sy);
+    q[2] = fusion_mul(fusion_mul(cr, sp), cy) + fusion_mul(fusion_mul(sr, cp), sy);
+    q[3] = fusion_mul(fusion_mul(cr, cp), sy) - fusion_mul(fusion_mul(sr, sp), cy);
+#else
+    float gx = (float) -accel.x;
+    float gy = (float) -accel.y;
+    float gz = (float) -accel.z;
+
+    float r = atan2f(gy, gz);
+    float p = atan2f(-gx, sqrtf(gy*gy + gz*gz));
+    float y = 0.0f;
+
+    if (status & SENSOR_FUSION_STATUS_MAG_VALID)
+    {
+        float mx = (float) mag.x;
+        float my = (float) mag.y;
+        float mz = (float) mag.z;
+
+        float hx = mx*cosf(p) + my*sinf(p)*sinf(r) + mz*sinf(p)*cosf(r);
+        float hy = my*cosf(r) - mz*sinf(r);
+
+        y = atan2f(-hy, hx);
+    }
+
+    float sr = sinf(r / 2), cr = cosf(r / 2);
+    float sp = sinf(p / 2), cp = cosf(p / 2);
+    float sy = sinf(y / 2), cy = cosf(y / 2);
+
+    q[0] = cr*cp*cy + sr*sp*sy;
+    q[1] = sr*cp*cy - cr*sp*sy;
+    q[2] = cr*sp*cy + sr*cp*sy;
+    q[3] = cr*cp*sy - sr*sp*cy;
+#endif
+
+    status |= SENSOR_FUSION_STATUS_INITIALISED;
+}
+
+/**
+  * Advances the filter by one gyroscope sample.
+  *
+  * @param g The gyroscope sample, in device NED format.
+  * @param dt The time since the previous sample, in microseconds.
+  */
+void SensorFusion::step(Sample3D g, uint32_t dt)
+{
+#if CONFIG_ENABLED(CODAL_FIXED_POINT_ORIENTATION)
+    int32_t q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    int32_t ex = 0, ey = 0, ez = 0;
+
+    // Determine the error between the measured direction of gravity, and that predicted by the current orientation.
+    int32_t ax = -accel.x;
+    int32_t ay = -accel.y;
+    int32_t az = -accel.z;
+
+    if ((status & SENSOR_FUSION_STATUS_ACCEL_VALID) && fusion_normalise(ax, ay, az))
+    {
+        int32_t vx = 2 * (fusion_mul(q1, q3) - fusion_mul(q0, q2));
+        int32_t vy = 2 * (fusion_mul(q0, q1) + fusion_mul(q2, q3));
+        int32_t vz = fusion_mul(q0, q0) - fusion_mul(q1, q1) - fusion_mul(q2, q2) + fusion_mul(q3, q3);
+
+        ex = fusion_mul(ay, vz) - fusion_mul(az, vy);
+        ey = fusion_mul(az, vx) - fusion_mul(ax, vz);
+        ez = fusion_mul(ax, vy) - fusion_mul(ay, vx);
+    }
+
+    // Likewise for the direction of magnetic north.
+    int32_t mx = mag.x;
+    int32_t my = mag.y;
+    int32_t mz = mag.z;
+
+    if ((status & SENSOR_FUSION_STATUS_MAG_VALID) && fusion_normalise(mx, my, mz))
+    {
+        int32_t q0q1 = fusion_mul(q0, q1), q0q2 = fusion_mul(q0, q2), q0q3 = fusion_mul(q0, q3);
+        int32_t q1q1 = fusion_mul(q1, q1), q1q2 = fusion_mul(q1, q2), q1q3 = fusion_mul(q1, q3);
+        int32_t q2q2 = fusion_mul(q2, q2), q2q3 = fusion_mul(q2, q3), q3q3 = fusion_mul(q3, q3);
+
+        int32_t hx = 2 * (fusion_mul(mx, SENSOR_FUSION_ONE / 2 - q2q2 - q3q3) + fusion_mul(my, q1q2 - q0q3) + fusion_mul(mz, q1q3 + q0q2));
+        int32_t hy = 2 * (fusion_mul(mx, q1q2 + q0q3) + fusion_mul(my, SENSOR_FUSION_ONE / 2 - q1q1 - q3q3) + fusion_mul(mz, q2q3 - q0q1));
+        int32_t bz = 2 * (fusion_mul(mx, q1q3 - q0q2) + fusion_mul(my, q2q3 + q0q1) + fusion_mul(mz, SENSOR_FUSION_ONE / 2 - q1q1 - q2q2));
+        int32_t bx = (int32_t) fixed_sqrt((int64_t)hx*hx + (int64_t)hy*hy);
+
+        int32_t wx = 2 * (fusion_mul(bx, SENSOR_FUSION_ONE / 2 - q2q2 - q3q3) + fusion_mul(bz, q1q3 - q0q2));
+        int32_t wy = 2 * (fusion_mul(bx, q1q2 - q0q3) + fusion_mul(bz, q0q1 + q2q3));
+        int32_t wz = 2 * (fusion_mul(bx, q0q2 + q1q3) + fusion_mul(bz, SENSOR_FUSION_ONE / 2 - q1q1 - q2q2));
+
+        ex += fusion_mul(my, wz) - fusion_mul(mz, wy);
+        ey += fusion_mul(mz, wx) - fusion_mul(mx, wz);
+        ez += fusion_mul(mx, wy) - fusion_mul(my, wx);
+    }
+
+    // Learn the gyroscope bias, if requested.
+    if (ki > 0)
+    {
+        bias[0] += (int32_t)((int64_t)ex * ki * dt / 1000000000);
+        bias[1] += (int32_t)((int64_t)ey * ki * dt / 1000000000);
+        bias[2] += (int32_t)((int64_t)ez * ki * dt / 1000000000);
+    }
+
+    // Apply the correction to the measured rate of rotation (in radians per second), and integrate over half of the time step.
+    int64_t gx = (int64_t)g.x * SENSOR_FUSION_DEG_TO_RAD / gyroSensitivity + (int64_t)ex * kp / 1000 + bias[0];
+    int64_t gy = (int64_t)g.y * SENSOR_FUSION_DEG_TO_RAD / gyroSensitivity + (int64_t)ey * kp / 1000 + bias[1];
+    int64_t gz = (int64_t)g.z * SENSOR_FUSION_DEG_TO_RAD / gyroSensitivity + (int64_t)ez * kp / 1000 + bias[2];
+
+    gx = gx * dt / 2000000;
+    gy = gy * dt / 2000000;
+    gz = gz * dt / 2000000;
+
+    int64_t n0 = q0 + ((-q1*gx - q2*gy - q3*gz) >> SENSOR_FUSION_Q);
+    int64_t n1 = q1 + ((q0*gx + q2*gz - q3*gy) >> SENSOR_FUSION_Q);
+    int64_t n2 = q2 + ((q0*gy - q1*gz + q3*gx) >> SENSOR_FUSION_Q);
+    int64_t n3 = q3 + ((q0*gz + q1*gy - q2*gx) >> SENSOR_FUSION_Q);
+
+    // Renormalise, to prevent rounding errors accumulating.
+    int64_t n = fixed_sqrt((uint64_t)(n0*n0 + n1*n1 + n2*n2 + n3*n3));
+
+    if (n == 0)
+        return;
+
+    q[0] = (int32_t)((n0 << SENSOR_FUSION_Q) / n);
+    q[1] = (int32_t)((n1 << SENSOR_FUSION_Q) / n);
+    q[2] = (int32_t)((n2 << SENSOR_FUSION_Q) / n);
+    q[3] = (int32_t)((n3 << SENSOR_FUSION_Q) / n);
+#else
+    float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    float ex = 0.0f, ey = 0.0f, ez = 0.0f;
+    float t = (float) dt * 1e-6f;
+
+    // Determine the error between the measured direction of gravity, and that predicted by the current orientation.
+    float ax = (float) -accel.x;
+    float ay = (float) -accel.y;
+    float az = (float) -accel.z;
+
+    if ((status & SENSOR_FUSION_STATUS_ACCEL_VALID) && fusion_normalise(ax, ay, az))
+    {
+        float vx = 2.0f * (q1*q3 - q0*q2);
+        float vy = 2.0f * (q0*q1 + q2*q3);
+        float vz = q0*q0 - q1*q1 - q2*q2 + q3*q3;
+
+        ex = ay*vz - az*vy;
+        ey = az*vx - ax*vz;
+        ez = ax*vy - ay*vx;
+    }
+
+    // Likewise for the direction of magnetic north.
+    float mx = (float) mag.x;
+    float my = (float) mag.y;
+    float mz = (float) mag.z;
+
+    if ((status & SENSOR_FUSION_STATUS_MAG_VALID) && fusion_normalise(mx, my, mz))
+    {
+        float hx = 2.0f * (mx*(0.5f - q2*q2 - q3*q3) + my*(q1*q2 - q0*q3) + mz*(q1*q3 + q0*q2));
+        float hy = 2.0f * (mx*(q1*q2 + q0*q3) + my*(0.5f - q1*q1 - q3*q3) + mz*(q2*q3 - q0*q1));
+        float bz = 2.0f * (mx*(q1*q3 - q0*q2) + my*(q2*q3 + q0*q1) + mz*(0.5f - q1*q1 - q2*q2));
+        float bx = sqrtf(hx*hx + hy*hy);
+
+        float wx = 2.0f * (bx*(0.5f - q2*q2 - q3*q3) + bz*(q1*q3 - q0*q2));
+        float wy = 2.0f * (bx*(q1*q2 - q0*q3) + bz*(q0*q1 + q2*q3));
+        float wz = 2.0f * (bx*(q0*q2 + q1*q3) + bz*(0.5f - q1*q1 - q2*q2));
+
+        ex += my*wz - mz*wy;
+        ey += mz*wx - mx*wz;
+        ez += mx*wy - my*wx;
+    }
+
+    // Learn the gyroscope bias, if requested.
+    if (ki > 0)
+    {
+        float k = (float) ki * 0.001f * t;
+
+        bias[0] += k * ex;
+        bias[1] += k * ey;
+        bias[2] += k * ez;
+    }
+
+    // Apply the correction to the measured rate of rotation (in radians per second), and integrate over half of the time step.
+    float scale = (float)(PI / 180.0) / (float) gyroSensitivity;
+    float k = (float) kp * 0.001f;
+
+    float gx = ((float) g.x * scale + k * ex + bias[0]) * 0.5f * t;
+    float gy = ((float) g.y * scale + k * ey + bias[1]) * 0.5f * t;
+    float gz = ((float) g.z * scale + k * ez + bias[2]) * 0.5f * t;
+
+    q0 += -q[1]*gx - q[2]*gy - q[3]*gz;
+    q1 += q[0]*gx + q[2]*gz - q[3]*gy;
+    q2 += q[0]*gy - q[1]*gz + q[3]*gx;
+    q3 += q[0]*gz + q[1]*gy - q[2]*gx;
+
+    // Renormalise, to prevent rounding errors accumulating.
+    float n = sqrtf(q0*q0 + q1*q1 + q2*q2 + q3*q3);
+
+    if (n == 0.0f)
+        return;
+
+    q[0] = q0 / n;
+    q[1] = q1 / n;
+    q[2] = q2 / n;
+    q[3] = q3 / n;
+#endif
+}
+
+/**
+  * Recalculates pitch, roll and yaw from the quaternion, and raises any events required.
+  */
+void SensorFusion::recalculateAngles()
+{
+#if CONFIG_ENABLED(CODAL_FIXED_POINT_ORIENTATION)
+    int32_t q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    int32_t s = 2 * (fusion_mul(q0, q2) - fusion_mul(q3, q1));
+
+    s = min(max(s, -SENSOR_FUSION_ONE), SENSOR_FUSION_ONE);
+
+    roll = fixed_atan2(2 * (fusion_mul(q0, q1) + fusion_mul(q2, q3)), SENSOR_FUSION_ONE - 2 * (fusion_mul(q1, q1) + fusion_mul(q2, q2)));
+    pitch = fixed_atan2(s, (int32_t) fixed_sqrt(((int64_t)SENSOR_FUSION_ONE << SENSOR_FUSION_Q) - (int64_t)s*s));
+    yaw = fixed_atan2(2 * (fusion_mul(q0, q3) + fusion_mul(q1, q2)), SENSOR_FUSION_ONE - 2 * (fusion_mul(q2, q2) + fusion_mul(q3, q3)));
+#else
+    float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    float s = 2.0f * (q0*q2 - q3*q1);
+
+    if (s > 1.0f)
+        s = 1.0f;
+
+    if (s < -1.0f)
+        s = -1.0f;
+
+    roll = FIXED_MATH_FROM_RADIANS(atan2f(2.0f * (q0*q1 + q2*q3), 1.0f - 2.0f * (q1*q1 + q2*q2)));
+    pitch = FIXED_MATH_FROM_RADIANS(asinf(s));
+    yaw = FIXED_MATH_FROM_RADIANS(atan2f(2.0f * (q0*q3 + q1*q2), 1.0f - 2.0f * (q2*q2 + q3*q3)));
+#endif
+
+    if (yaw < 0)
+        yaw += FIXED_MATH_DEGREES(360);
+
+    Event(id, SENSOR_FUSION_EVT_DATA_UPDATE);
+
+    // Determine if we've moved far enough from the last reported orientation to raise an event.
+    int32_t angles[3] = {pitch, roll, yaw};
+    bool changed = false;
+
+    for (int i = 0; i < 3; i++)
+    {
+        int32_t delta = angles[i] - reported[i];
+
+        if (delta > FIXED_MATH_DEGREES(180))
+            delta -= FIXED_MATH_DEGREES(360);
+
+        if (delta < -FIXED_MATH_DEGREES(180))
+            delta += FIXED_MATH_DEGREES(360);
+
+        if (delta > threshold || delta < -threshold)
+            changed = true;
+    }
+
+    if (changed)
+    {
+        reported[0] = pitch;
+        reported[1] = roll;
+        reported[2] = yaw;
+
+        Event(id, SENSOR_FUSION_EVT_ORIENTATION_CHANGE);
+    }
+}
+
+/**
+  * Provides the fused pitch of the device.
+  *
+  * @return The pitch of the device, in degrees, in the range -90..90. Positive values indicate the top of the device is raised.
+  */
+int SensorFusion::getPitch()
+{
+    return pitch / 100;
+}
+
+/**
+  * Provides the fused roll of the device.
+  *
+  * @return The roll of the device, in degrees, in the range -180..180. Positive values indicate the right hand side of the device is lowered.
+  */
+int SensorFusion::getRoll()
+{
+    return roll / 100;
+}
+
+/**
+  * Provides the fused yaw (heading) of the device.
+  *
+  * @return The yaw of the device, in degrees, in the range 0..359, measured clockwise when viewed from above.
+  */
+int SensorFusion::getYaw()
+{
+    return (yaw / 100) % 360;
+}
+
+/**
+  * Provides the orientation of the device as a unit quaternion.
+  *
+  * @return A 4x1 matrix holding the w, x, y and z components of the quaternion.
+  */
+Matrix4 SensorFusion::getQuaternion()
+{
+    Matrix4 result(4, 1);
+
+    for (int i = 0; i < 4; i++)
+#if CONFIG_ENABLED(CODAL_FIXED_POINT_ORIENTATION)
+        result.set(i, 0, (float) q[i] / (float) SENSOR_FUSION_ONE);
+#else
+        result.set(i, 0, q[i]);
+#endif
+
+    return result;
+}
+
+/**
+  * Provides the orientation of the device as a rotation matrix.
+  *
+  * @return A 3x3 matrix that rotates a vector from the device frame into the NED world frame.
+  */
+Matrix4 SensorFusion::getRotationMatrix()
+{
+    Matrix4 quaternion = getQuaternion();
+    Matrix4 result(3, 3);
+
+    float q0 = quaternion.get(0, 0);
+    float q1 = quaternion.get(1, 0);
+    float q2 = quaternion.get(2, 0);
+    float q3 = quaternion.get(3, 0);
+
+    result.set(0, 0, 1.0f - 2.0f * (q2*q2 + q3*q3));
+    result.set(0, 1, 2.0f * (q1*q2 - q0*q3));
+    result.set(0, 2, 2.0f * (q1*q3 + q0*q2));
+    result.set(1, 0, 2.0f * (q1*q2 + q0*q3));
+    result.set(1, 1, 1.0f - 2.0f * (q1*q1 + q3*q3));
+    result.set(1, 2, 2.0f * (q2*q3 - q0*q1));
+    result.set(2, 0, 2.0f * (q1*q3 - q0*q2));
+    result.set(2, 1, 2.0f * (q2*q3 + q0*q1));
+    result.set(2, 2, 1.0f - 2.0f * (q1*q1 + q2*q2));
+
+    return result;
+}
+
+/**
+  * Event handler, called whenever the accelerometer reports new data.
+  */
+void SensorFusion::onAccelerometerUpdate(Event)
+{
+    status |= SENSOR_FUSION_STATUS_ACCEL_FRESH;
+}
+
+/**
+  * Event handler, called whenever the compass reports new data.
+  */
+void SensorFusion::onCompassUpdate(Event)
+{
+    status |= SENSOR_FUSION_STATUS_MAG_FRESH;
+}
+
+/**
+  * Event handler, called whenever the gyroscope reports new data. Advances the filter by one step.
+  */
+void SensorFusion::onGyroscopeUpdate(Event)
+{
+    CODAL_TIMESTAMP now = system_timer_current_time_us();
+    Sample3D g = toNED(gyroscope.getSample(EAST_NORTH_UP));
+
+    // Collect any new accelerometer and compass data.
+    if (!(status & SENSOR_FUSION_STATUS_ACCEL_VALID) || (status & SENSOR_FUSION_STATUS_ACCEL_FRESH))
+    {
+        status &= ~SENSOR_FUSION_STATUS_ACCEL_FRESH;
+        accel = toNED(accelerometer.getSample(EAST_NORTH_UP));
+        status |= SENSOR_FUSION_STATUS_ACCEL_VALID;
+    }
+
+    if (compass && (!(status & SENSOR_FUSION_STATUS_MAG_VALID) || (status & SENSOR_FUSION_STATUS_MAG_FRESH)))
+    {
+        status &= ~SENSOR_FUSION_STATUS_MAG_FRESH;
+        mag = toNED(compass->getSample(EAST_NORTH_UP));
+        status |= SENSOR_FUSION_STATUS_MAG_VALID;
+    }
+
+    // The first sample simply seeds the filter from the accelerometer and compass.
+    if (!(status & SENSOR_FUSION_STATUS_INITIALISED))
+    {
+        initialise();
+        lastUpdate = now;
+        recalculateAngles();
+        return;
+    }
+
+    CODAL_TIMESTAMP dt = now - lastUpdate;
+    lastUpdate = now;
+
+    // Don't integrate over long gaps (e.g. if the gyroscope was not being sampled), as the rate of rotation will not have been constant.
+    if (dt > SENSOR_FUSION_MAX_DT)
+        dt = SENSOR_FUSION_MAX_DT;
+
+
+    step(g, (uint32_t) dt);
+    recalculateAngles();
+}
+
+/**
+  * Destructor.
+  */
+SensorFusion::~SensorFusion()
+{
+    if (EventModel::defaultEventBus)
+    {
+        EventModel::defaultEventBus->ignore(accelerometer.id, ACCELEROMETER_EVT_DATA_UPDATE, this, &SensorFusion::onAccelerometerUpdate);
+        EventModel::defaultEventBus->ignore(gyroscope.id, GYROSCOPE_EVT_DATA_UPDATE, this, &SensorFusion::onGyroscopeUpdate);
+
+        if (compass)
+            EventModel::defaultEventBus->ignore(compass->id, COMPASS_EVT_DATA_UPDATE, this, &SensorFusion::onCompassUpdate);
+    }
+}
@@ -23,6 +23,7 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include "StandardSPIFlash.h"
+#include "CodalFiber.h"
 
 using namespace codal;
 
@@ -34,9 +35,21 @@ using namespace codal;
 StandardSPIFlash::StandardSPIFlash(SPI &spi, Pin &ssel, int numPages)
     : _numPages(numPages), spi(spi), ssel(ssel)
 {
+    fastRead = true;
+    combineBuffer = NULL;
+    combineAddr = -1;
+    combineStart = 0;
+    combineEnd = 0;
+
     ssel.setDigitalValue(1);
 }
 
+StandardSPIFlash::~StandardSPIFlash()
+{
+    flushCore();
+    free(combineBuffer);
+}
+
 void StandardSPIFlash::setCommand(uint8_t command, int addr)
 {
     cmdBuf[0] = command;
@@ -63,18 +76,37 @@ void StandardSPIFlash::writeEnable()
     sendCommand(0x06);
 }
 
+/**
+ * Waits for the flash to complete a program or erase operation.
+ *
+ * Short operations (waitMS == 0) yield to other fibers between polls of the status register.
+ * Longer operations sleep for waitMS, doubling the period on each poll up to SPIFLASH_MAX_BACKOFF_MS,
+ * so the bus is not flooded with status reads during a long erase.
+ */
 int StandardSPIFlash::waitBusy(int waitMS)
 {
-    do
+    while (true)
     {
         int r = sendCommand(0x05, -1, &status, 1);
         if (r < 0)
             return r;
+
+        if (!(status & 0x01))
+            return DEVICE_OK;
+
+        if (!fiber_scheduler_running())
+            continue;
+
         if (waitMS)
+        {
             fiber_sleep(waitMS);
-    } while (status & 0x01);
-
-    return DEVICE_OK;
+            waitMS = min(waitMS * 2, SPIFLASH_MAX_BACKOFF_MS);
+        }
+        else
+        {
+            schedule();
+        }
+    }
 }
 
 int StandardSPIFlash::numPages()
@@ -84,62 +116,211 @@ int StandardSPIFlash::numPages()
 
 int StandardSPIFlash::readBytes(uint32_t addr, void *buffer, uint32_t len)
 {
-    check(addr + len <= _numPages * SPIFLASH_PAGE_SIZE);
-    check(addr <= _numPages * SPIFLASH_PAGE_SIZE);
-    return sendCommand(0x03, addr, buffer, len);
+    lock.wait();
+    int r = readCore(addr, buffer, len);
+    lock.notify();
+
+    return r;
 }
 
-int StandardSPIFlash::writeBytes(uint32_t addr, const void *buffer, uint32_t len)
+int StandardSPIFlash::readCore(uint32_t addr, void *buffer, uint32_t len)
 {
-    check(len <= SPIFLASH_PAGE_SIZE);
-    check(addr / SPIFLASH_PAGE_SIZE == (addr + len - 1) / SPIFLASH_PAGE_SIZE);
     check(addr + len <= _numPages * SPIFLASH_PAGE_SIZE);
+    check(addr <= _numPages * SPIFLASH_PAGE_SIZE);
+
+    // Make sure we don't read stale data from a page with pending writes.
+    if (combineAddr >= 0 && addr < (uint32_t)combineAddr + SPIFLASH_PAGE_SIZE && addr + len > (uint32_t)combineAddr)
+    {
+        int r = flushCore();
+        if (r < 0)
+            return r;
+    }
+
+    if (!fastRead)
+        return sendCommand(0x03, addr, buffer, len);
+
+    // Fast read is followed by a single dummy byte before the data.
+    setCommand(0x0B, addr);
+    cmdBuf[4] = 0;
+
+    ssel.setDigitalValue(0);
+    int r = spi.transfer(cmdBuf, 5, NULL, 0);
+    if (r == DEVICE_OK)
+        r = spi.transfer(NULL, 0, (uint8_t *)buffer, len);
+    ssel.setDigitalValue(1);
+
+    return r;
+}
 
+/**
+ * Programs data into a single page, and waits for the operation to complete.
+ */
+int StandardSPIFlash::programPage(uint32_t addr, const uint8_t *data, uint32_t len)
+{
     writeEnable();
 
     setCommand(0x02, addr);
 
     ssel.setDigitalValue(0);
-    for (uint32_t i = 0; i < 4; ++i)
-        if (spi.write(cmdBuf[i]) < 0)
-            goto fail;
-    for (uint32_t i = 0; i < len; ++i)
-        if (spi.write(((const uint8_t *)buffer)[i]) < 0)
-            goto fail;
+    int r = spi.transfer(cmdBuf, 4, NULL, 0);
+    if (r == DEVICE_OK)
+        r = spi.transfer(data, len, NULL, 0);
     ssel.setDigitalValue(1);
 
+    if (r != DEVICE_OK)
+        return DEVICE_SPI_ERROR;
+
     // the typical write time is under 1ms, so we don't bother with fiber_sleep()
     return waitBusy(0);
+}
 
-fail:
-    ssel.setDigitalValue(1);
-    return DEVICE_SPI_ERROR;
+int StandardSPIFlash::writeBytes(uint32_t addr, const void *buffer, uint32_t len)
+{
+    lock.wait();
+    int r = writeCore(addr, buffer, len);
+    lock.notify();
+
+    return r;
 }
 
-int StandardSPIFlash::eraseCore(uint8_t cmd, uint32_t addr)
+int StandardSPIFlash::writeCore(uint32_t addr, const void *buffer, uint32_t len)
 {
+    check(addr + len <= _numPages * SPIFLASH_PAGE_SIZE);
+
+    const uint8_t *data = (const uint8_t *)buffer;
+
+    while (len)
+    {
+        uint32_t offset = addr & (SPIFLASH_PAGE_SIZE - 1);
+        uint32_t n = min(len, SPIFLASH_PAGE_SIZE - offset);
+        int r;
+
+        if (combineBuffer)
+        {
+            uint32_t page = addr - offset;
+
+            if (combineAddr != (int32_t)page)
+            {
+                r = flushCore();
+                if (r < 0)
+                    return r;
+
+                memset(combineBuffer, 0xFF, SPIFLASH_PAGE_SIZE);
+                combineAddr = page;
+                combineStart = offset;
+                combineEnd = offset + n;
+            }
+
+            // Programming can only clear bits, so combining repeated writes to the same byte is a bitwise AND.
+            for (uint32_t i = 0; i < n; i++)
+                combineBuffer[offset + i] &= data[i];
+
+            combineStart = min(combineStart, offset);
+            combineEnd = max(combineEnd, offset + n);
+
+            r = (combineStart == 0 && combineEnd == SPIFLASH_PAGE_SIZE) ? flushCore() : DEVICE_OK;
+        }
+        else
+        {
+            r = programPage(addr, data, n);
+        }
+
+        if (r < 0)
+            return r;
+
+        addr += n;
+        data += n;
+        len -= n;
+    }
+
+    return DEVICE_OK;
+}
+
+int StandardSPIFlash::flush()
+{
+    lock.wait();
+    int r = flushCore();
+    lock.notify();
+
+    return r;
+}
+
+int StandardSPIFlash::flushCore()
+{
+    if (combineAddr < 0)
+        return DEVICE_OK;
+
+    int r = programPage(combineAddr + combineStart, combineBuffer + combineStart, combineEnd - combineStart);
+    combineAddr = -1;
+
+    return r;
+}
+
+void StandardSPIFlash::setFastRead(bool enable)
+{
+    fastRead = enable;
+}
+
+int StandardSPIFlash::setWriteCombining(bool enable)
+{
+    int r = DEVICE_OK;
+
+    lock.wait();
+
+    if (enable && combineBuffer == NULL)
+    {
+        combineBuffer = (uint8_t *)malloc(SPIFLASH_PAGE_SIZE);
+        if (combineBuffer == NULL)
+            r = DEVICE_NO_RESOURCES;
+    }
+
+    if (!enable && combineBuffer)
+    {
+        r = flushCore();
+        free(combineBuffer);
+        combineBuffer = NULL;
+    }
+
+    lock.notify();
+
+    return r;
+}
+
+/**
+ * Erases the given region, dropping any pending writes within it, and waits for the operation to complete.
+ */
+int StandardSPIFlash::eraseCore(uint8_t cmd, uint32_t addr, uint32_t len)
+{
+    lock.wait();
+
+    if (cmd == 0xC7 || (combineAddr >= (int32_t)addr && (uint32_t)combineAddr < addr + len))
+        combineAddr = -1;
+
     writeEnable();
     int r = sendCommand(cmd, addr);
-    if (r < 0)
-        return r;
-    return waitBusy(10);
+    if (r == DEVICE_OK)
+        r = waitBusy(cmd == 0x20 ? 5 : 10);
+
+    lock.notify();
+
+    return r;
 }
 
 int StandardSPIFlash::eraseSmallRow(uint32_t addr)
 {
     check(addr < _numPages * SPIFLASH_PAGE_SIZE);
     check((addr & (SPIFLASH_SMALL_ROW_SIZE - 1)) == 0);
-    return eraseCore(0x20, addr);
+    return eraseCore(0x20, addr, SPIFLASH_SMALL_ROW_SIZE);
 }
 
 int StandardSPIFlash::eraseBigRow(uint32_t addr)
 {
     check(addr < _numPages * SPIFLASH_PAGE_SIZE);
     check((addr & (SPIFLASH_BIG_ROW_SIZE - 1)) == 0);
-    return eraseCore(0xD8, addr);
+    return eraseCore(0xD8, addr, SPIFLASH_BIG_ROW_SIZE);
 }
 
 int StandardSPIFlash::eraseChip()
 {
-    return eraseCore(0xC7, -1); // or 0x60
+    return eraseCore(0xC7, -1, 0); // or 0x60
 }
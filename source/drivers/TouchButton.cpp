@@ -49,6 +49,7 @@ TouchButton::TouchButton(Pin &pin, TouchSensor &sensor, int threshold) : Button(
     // Disable periodic events. These will come from our TouchSensor.
     this->threshold = threshold;
     this->reading = 0;
+    this->baseline = 0;
 
     // register ourselves with the sensor
     touchSensor.addTouchButton(this);
@@ -90,6 +91,7 @@ void TouchButton::calibrate()
  */
 void TouchButton::setThreshold(int threshold)
 {
+    status &= ~TOUCH_BUTTON_DRIFT_COMPENSATION;
     this->threshold = threshold;
 }
 
@@ -135,8 +137,10 @@ void TouchButton::setValue(int reading)
         // We've completed calibration, return to normal mode of operation.
         if (this->reading == 0)
         {
+            this->baseline = this->threshold << 4;
             this->threshold += ((this->threshold * TOUCH_BUTTON_SENSITIVITY) / 100) + TOUCH_BUTTON_CALIBRATION_LINEAR_OFFSET;
             status &= ~TOUCH_BUTTON_CALIBRATING;
+            status |= TOUCH_BUTTON_DRIFT_COMPENSATION;
         }
 
         return;
@@ -147,6 +151,15 @@ void TouchButton::setValue(int reading)
 #ifdef TOUCH_BUTTON_DECAY_AVERAGE
     this->reading = ((this->reading * (100-TOUCH_BUTTON_DECAY_AVERAGE)) / 100) + ((reading * TOUCH_BUTTON_DECAY_AVERAGE) / 100);
 #endif
+
+    // While untouched, let an automatically calibrated baseline (and so its threshold) follow slow environmental drift.
+    if ((status & TOUCH_BUTTON_DRIFT_COMPENSATION) && this->reading < this->threshold)
+    {
+        this->baseline += ((this->reading << 4) - this->baseline) / TOUCH_BUTTON_DRIFT_RATE;
+
+        int b = this->baseline >> 4;
+        this->threshold = b + ((b * TOUCH_BUTTON_SENSITIVITY) / 100) + TOUCH_BUTTON_CALIBRATION_LINEAR_OFFSET;
+    }
 }
 
 
@@ -27,6 +27,7 @@ DEALINGS IN THE SOFTWARE.
 #include "CodalFiber.h"
 #include "Timer.h"
 #include "codal_target_hal.h"
+#include "CodalCompat.h"
 
 using namespace codal;
 
@@ -43,6 +44,11 @@ TouchSensor::TouchSensor(uint16_t id) : drivePin(*(Pin*)NULL)
 {
     this->id = id;
     this->numberOfButtons = 0;
+    this->portPin = NULL;
+    this->drainTime = TOUCH_SENSOR_MAX_DRAIN_TIME;
+    this->chargeTime = TOUCH_SENSOR_MAX_DRAIN_TIME / TOUCH_SENSOR_DRAIN_FACTOR;
+    this->scanTime = 0;
+    this->maxScanTime = 0;
 }
 
 /**
@@ -57,6 +63,13 @@ TouchSensor::TouchSensor(Pin &pin, uint16_t id) : drivePin(pin)
 {
     this->id = id;
     this->numberOfButtons = 0;
+    this->portPin = NULL;
+
+    // Start with a conservative discharge time, which is refined as scans complete.
+    this->drainTime = TOUCH_SENSOR_MAX_DRAIN_TIME;
+    this->chargeTime = TOUCH_SENSOR_MAX_DRAIN_TIME / TOUCH_SENSOR_DRAIN_FACTOR;
+    this->scanTime = 0;
+    this->maxScanTime = 0;
 
     // Initialise output drive low (to drain any residual charge before sampling begins).
     drivePin.setDigitalValue(0);
@@ -94,6 +107,8 @@ int TouchSensor::addTouchButton(TouchButton *button)
     // Put the button into input mode.
     button->_pin.getDigitalValue();
 
+    updatePortGroup();
+
     return DEVICE_OK;
 }
 
@@ -108,9 +123,11 @@ int TouchSensor::removeTouchButton(TouchButton *button)
         if (buttons[i] == button)
         {
             // replace this entry with the last in the list, to ensure the list remains contiguous.
-            buttons[i] = buttons[numberOfButtons];
+            buttons[i] = buttons[numberOfButtons - 1];
             numberOfButtons--;
 
+            updatePortGroup();
+
             return DEVICE_OK;
         }
     }
@@ -118,6 +135,32 @@ int TouchSensor::removeTouchButton(TouchButton *button)
     return DEVICE_INVALID_PARAMETER;
 }
 
+/**
+  * Determine which buttons can be read together with a single port read.
+  * Buttons on the same port as the first port-capable button are grouped. Any others are read individually.
+  */
+void TouchSensor::updatePortGroup()
+{
+    portPin = NULL;
+
+    for (int i=0; i<numberOfButtons; i++)
+    {
+        Pin &pin = buttons[i]->_pin;
+        int port = pin.getPort();
+
+        portMask[i] = 0;
+
+        if (port < 0)
+            continue;
+
+        if (portPin == NULL)
+            portPin = &pin;
+
+        if (port == portPin->getPort())
+            portMask[i] = pin.getPortMask();
+    }
+}
+
 /**
   * Initiate a scan of the sensors.
   */
@@ -126,6 +169,8 @@ void TouchSensor::onSampleEvent(Event)
     int cycles = 0;
     int activeSensors = 0;
 
+    CODAL_TIMESTAMP start = system_timer_current_time_us();
+
     // Drain any residual charge on the receiver pins.
     // TODO: Move this to a platform specific library function (DevicePin).
     for (int i=0; i<numberOfButtons; i++)
@@ -134,9 +179,17 @@ void TouchSensor::onSampleEvent(Event)
         buttons[i]->active = true;
     }
 
-    // Wait for any charge to drain.
-    // TODO: minimise this value.
-    target_wait(1);
+    // Wait for any charge to drain. The wait is scaled from how long the pins have recently taken to charge,
+    // which tracks the capacitance of the attached electrodes.
+    target_wait_us(drainTime);
+
+    // drainPin() leaves the pins driven low. Pins read individually are returned to input by getDigitalValue()
+    // below, but those sampled with readPort() are not reconfigured, so return them to input here.
+    for (int i=0; i<numberOfButtons; i++)
+        if (portMask[i])
+            buttons[i]->_pin.getDigitalValue();
+
+    CODAL_TIMESTAMP charging = system_timer_current_time_us();
 
     // raise the drive pin, and start testing the receiver pins...
     drivePin.setDigitalValue(1);
@@ -145,11 +198,16 @@ void TouchSensor::onSampleEvent(Event)
     {
         activeSensors = 0;
 
+        // Sample all grouped receiver pins at once.
+        uint32_t port = portPin ? portPin->readPort() : 0;
+
         for (int i=0; i<numberOfButtons; i++)
         {
             if (buttons[i]->active)
             {
-                if(buttons[i]->_pin.getDigitalValue() == 1 || cycles >= (buttons[i]->threshold))
+                int value = portMask[i] ? (port & portMask[i]) != 0 : buttons[i]->_pin.getDigitalValue();
+
+                if(value == 1 || cycles >= (buttons[i]->threshold))
                 {
                     buttons[i]->active = false;
                     buttons[i]->setValue(cycles);
@@ -165,6 +223,49 @@ void TouchSensor::onSampleEvent(Event)
     }
 
     drivePin.setDigitalValue(0);
+
+    // Track the longest recent charge time (decaying slowly), and derive the discharge time from it.
+    CODAL_TIMESTAMP end = system_timer_current_time_us();
+    int charge = min((int)(end - charging), 0xFFFF);
+
+    chargeTime = max(charge, chargeTime - chargeTime / 16);
+    drainTime = max(TOUCH_SENSOR_MIN_DRAIN_TIME, min(TOUCH_SENSOR_MAX_DRAIN_TIME, chargeTime * TOUCH_SENSOR_DRAIN_FACTOR));
+
+    scanTime = (uint32_t)(end - start);
+    maxScanTime = max(maxScanTime, scanTime);
+}
+
+/**
+ * Determines the duration of the most recent scan, including the discharge time.
+ *
+ * @return The scan duration, in microseconds.
+ */
+int TouchSensor::getScanTime()
+{
+    return scanTime;
+}
+
+/**
+ * Determines the longest scan duration since this method was last called, and resets it.
+ *
+ * @return The longest scan duration, in microseconds.
+ */
+int TouchSensor::getMaxScanTime()
+{
+    int t = maxScanTime;
+    maxScanTime = 0;
+
+    return t;
+}
+
+/**
+ * Determines the time currently allowed for receiver pins to discharge before each scan.
+ *
+ * @return The discharge time, in microseconds.
+ */
+int TouchSensor::getDrainTime()
+{
+    return drainTime;
 }
 
 /**
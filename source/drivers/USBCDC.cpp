@@ -0,0 +1,579 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "USBCDC.h"
+
+#if CONFIG_ENABLED(DEVICE_USB)
+
+#include "EventModel.h"
+#include "CodalCompat.h"
+#include "ErrorNo.h"
+#include "codal_target_hal.h"
+
+using namespace codal;
+
+static const uint8_t functionalDescriptors[] = {
+    0x05, 0x24, 0x00, 0x10, 0x01, // header, CDC 1.10
+    0x05, 0x24, 0x01, 0x00, 0xff, // call management: none, data interface (filled in)
+    0x04, 0x24, 0x02, 0x02,       // ACM: supports line coding and control line state requests
+    0x05, 0x24, 0x06, 0xff, 0xff, // union: control and data interfaces (filled in)
+};
+
+static const InterfaceInfo controlInterfaceInfo = {
+    NULL,
+    0,
+    1,
+    {
+        1,    // numEndpoints
+        0x02, /// class code - communications
+        0x02, // subclass - abstract control model
+        0x00, // protocol
+        0x00, //
+        0x00, //
+    },
+    {USB_EP_TYPE_INTERRUPT, 16},
+    {USB_EP_TYPE_INTERRUPT, 16},
+};
+
+static const InterfaceInfo dataInterfaceInfo = {
+    NULL,
+    0,
+    2,
+    {
+        2,    // numEndpoints
+        0x0A, /// class code - CDC data
+        0x00, // subclass
+        0x00, // protocol
+        0x00, //
+        0x00, //
+    },
+    {USB_EP_TYPE_BULK, 0},
+    {USB_EP_TYPE_BULK, 0},
+};
+
+// The number of bytes that can be written to a ring buffer at head without wrapping.
+static inline int contiguousFree(int head, int tail, int size)
+{
+    return tail > head ? tail - head - 1 : size - head - (tail == 0 ? 1 : 0);
+}
+
+// The number of bytes that can be read from a ring buffer at tail without wrapping.
+static inline int contiguousUsed(int head, int tail, int size)
+{
+    return head >= tail ? head - tail : size - tail;
+}
+
+USBCDCControl::USBCDCControl(uint16_t id) : CodalUSBInterface()
+{
+    this->id = id;
+    this->lineState = 0;
+
+    lineCoding.baud = 115200;
+    lineCoding.stopBits = 0;
+    lineCoding.parity = 0;
+    lineCoding.dataBits = 8;
+
+    memcpy(functional, functionalDescriptors, sizeof(functional));
+    info = controlInterfaceInfo;
+    info.supplementalDescriptor = functional;
+    info.supplementalDescriptorSize = sizeof(functional);
+}
+
+const InterfaceInfo *USBCDCControl::getInterfaceInfo()
+{
+    // The data interface is always added straight after this one.
+    functional[9] = interfaceIdx + 1;
+    functional[17] = interfaceIdx;
+    functional[18] = interfaceIdx + 1;
+
+    return &info;
+}
+
+int USBCDCControl::getAssociation(InterfaceAssociationDescriptor *desc)
+{
+    desc->len = sizeof(InterfaceAssociationDescriptor);
+    desc->dtype = USB_INTERFACE_ASSOCIATION_DESCRIPTOR_TYPE;
+    desc->firstInterface = interfaceIdx;
+    desc->interfaceCount = 2;
+    desc->functionClass = controlInterfaceInfo.iface.interfaceClass;
+    desc->functionSubClass = controlInterfaceInfo.iface.interfaceSubClass;
+    desc->functionProtocol = controlInterfaceInfo.iface.protocol;
+    desc->iFunction = 0;
+
+    return DEVICE_OK;
+}
+
+int USBCDCControl::classRequest(UsbEndpointIn &ctrl, USBSetup &setup)
+{
+    uint8_t buf[1] = {0};
+
+    switch (setup.bRequest)
+    {
+    case CDC_REQUEST_GET_LINE_CODING:
+        return ctrl.write(&lineCoding, min(setup.wLength, sizeof(lineCoding)));
+
+    case CDC_REQUEST_SET_CONTROL_LINE_STATE:
+        if (lineState != setup.wValueL)
+        {
+            lineState = setup.wValueL;
+            Event e(id, USB_CDC_EVT_LINE_STATE);
+        }
+        return ctrl.write(buf, 0);
+
+    case CDC_REQUEST_SET_LINE_CODING:
+        // The new coding arrives in the data stage, which is not passed on to interfaces.
+        // It has no bearing on a USB link, so just accept it.
+        return ctrl.write(buf, 0);
+    }
+
+    return DEVICE_NOT_SUPPORTED;
+}
+
+USBCDC::USBCDC(uint16_t id) : CodalUSBInterface(), control(id)
+{
+    this->id = id;
+    this->status = 0;
+    this->listening = false;
+
+    rxBuff = new uint8_t[USB_CDC_RX_BUFFER_SIZE];
+    txBuff = new uint8_t[USB_CDC_TX_BUFFER_SIZE];
+    rxHead = rxTail = 0;
+    txHead = txTail = 0;
+
+    streamLength = 0;
+    downstream = NULL;
+    upstream = NULL;
+}
+
+int USBCDC::attach(CodalUSB &usb)
+{
+    int result = usb.add(control);
+
+    if (result == DEVICE_OK)
+        result = usb.add(*this);
+
+    return result;
+}
+
+const InterfaceInfo *USBCDC::getInterfaceInfo()
+{
+    return &dataInterfaceInfo;
+}
+
+bool USBCDC::isConnected()
+{
+    return (control.getLineState() & CDC_LINE_STATE_DTR) != 0;
+}
+
+void USBCDC::startListening()
+{
+    if (listening || EventModel::defaultEventBus == NULL)
+        return;
+
+    listening = true;
+    EventModel::defaultEventBus->listen(id, USB_CDC_EVT_LINE_STATE, this, &USBCDC::onEvent);
+    EventModel::defaultEventBus->listen(id, USB_CDC_EVT_TX, this, &USBCDC::onEvent);
+    EventModel::defaultEventBus->listen(id, USB_CDC_EVT_STREAM, this, &USBCDC::onEvent);
+    EventModel::defaultEventBus->listen(id, USB_CDC_EVT_PULL, this, &USBCDC::onEvent);
+}
+
+void USBCDC::onEvent(Event evt)
+{
+    switch (evt.value)
+    {
+    case USB_CDC_EVT_STREAM:
+        deliverStream();
+        break;
+
+    case USB_CDC_EVT_PULL:
+        if (upstream)
+        {
+            // Written straight from the source's buffer. If nobody is listening, it is dropped.
+            ManagedBuffer b = upstream->pull();
+
+            if (b.length() > 0 && isConnected() && in)
+            {
+                txLock.wait();
+                in->write(b.getBytes(), b.length());
+                txLock.notify();
+            }
+        }
+        break;
+
+    default:
+        flushTx();
+        break;
+    }
+}
+
+/**
+ * Called from IRQ context when a packet may have arrived.
+ * Packets are read straight into the receive ring buffer, or the stream buffer if a DataSink is connected.
+ */
+int USBCDC::endpointRequest()
+{
+    if (status & USB_CDC_STATUS_RX_PAUSED)
+        return DEVICE_OK;
+
+    if (downstream)
+    {
+        receiveStream();
+        return DEVICE_OK;
+    }
+
+    if (rxSpace() < USB_MAX_PKT_SIZE)
+    {
+        pauseRx();
+        return DEVICE_OK;
+    }
+
+    int len;
+
+    if (contiguousFree(rxHead, rxTail, USB_CDC_RX_BUFFER_SIZE) >= USB_MAX_PKT_SIZE)
+    {
+        len = out->read(rxBuff + rxHead, USB_MAX_PKT_SIZE);
+
+        if (len <= 0)
+            return DEVICE_OK;
+    }
+    else
+    {
+        uint8_t packet[USB_MAX_PKT_SIZE];
+
+        len = out->read(packet, sizeof(packet));
+
+        if (len <= 0)
+            return DEVICE_OK;
+
+        int first = min(len, USB_CDC_RX_BUFFER_SIZE - rxHead);
+        memcpy(rxBuff + rxHead, packet, first);
+        memcpy(rxBuff, packet + first, len - first);
+    }
+
+    rxHead = (rxHead + len) % USB_CDC_RX_BUFFER_SIZE;
+
+    // Leave the host NAKing until there is room for another full packet.
+    if (rxSpace() < USB_MAX_PKT_SIZE)
+        pauseRx();
+
+    Event e(id, USB_CDC_EVT_DATA_RECEIVED);
+
+    return DEVICE_OK;
+}
+
+void USBCDC::receiveStream()
+{
+    if (status & USB_CDC_STATUS_STREAM_READY)
+    {
+        pauseRx();
+        return;
+    }
+
+    int len = out->read(streamBuffer.getBytes() + streamLength, USB_MAX_PKT_SIZE);
+
+    if (len <= 0)
+        return;
+
+    streamLength += len;
+
+    // A short packet ends a transfer, so hand on what we have rather than waiting for more.
+    if (len < USB_MAX_PKT_SIZE || streamLength + USB_MAX_PKT_SIZE > streamBuffer.length())
+    {
+        status |= USB_CDC_STATUS_STREAM_READY;
+        pauseRx();
+
+        Event e(id, USB_CDC_EVT_STREAM);
+    }
+}
+
+void USBCDC::deliverStream()
+{
+    // Wait for the DataSink to collect the previous buffer, pull() will call us again.
+    if (!(status & USB_CDC_STATUS_STREAM_READY) || output.length() > 0 || downstream == NULL)
+        return;
+
+    output = streamBuffer;
+    output.truncate(streamLength);
+
+    streamBuffer = ManagedBuffer(USB_CDC_STREAM_BUFFER_SIZE, BufferInitialize::None);
+    streamLength = 0;
+
+    target_disable_irq();
+    status &= ~USB_CDC_STATUS_STREAM_READY;
+    target_enable_irq();
+
+    resumeRx();
+    downstream->pullRequest();
+}
+
+void USBCDC::pauseRx()
+{
+    status |= USB_CDC_STATUS_RX_PAUSED;
+    out->disableIRQ();
+}
+
+void USBCDC::resumeRx()
+{
+    target_disable_irq();
+
+    if ((status & USB_CDC_STATUS_RX_PAUSED) &&
+        (downstream ? !(status & USB_CDC_STATUS_STREAM_READY) : rxSpace() >= USB_MAX_PKT_SIZE))
+    {
+        status &= ~USB_CDC_STATUS_RX_PAUSED;
+        out->enableIRQ();
+    }
+
+    target_enable_irq();
+}
+
+int USBCDC::rxSpace()
+{
+    return (rxTail - rxHead - 1 + USB_CDC_RX_BUFFER_SIZE) % USB_CDC_RX_BUFFER_SIZE;
+}
+
+int USBCDC::rxBufferedSize()
+{
+    return (rxHead - rxTail + USB_CDC_RX_BUFFER_SIZE) % USB_CDC_RX_BUFFER_SIZE;
+}
+
+int USBCDC::txBufferedSize()
+{
+    return (txHead - txTail + USB_CDC_TX_BUFFER_SIZE) % USB_CDC_TX_BUFFER_SIZE;
+}
+
+int USBCDC::isReadable()
+{
+    return rxHead != rxTail;
+}
+
+int USBCDC::clearRxBuffer()
+{
+    rxTail = rxHead;
+    resumeRx();
+
+    return DEVICE_OK;
+}
+
+int USBCDC::fillTxBuffer(const uint8_t *buffer, int len)
+{
+    int copied = 0;
+
+    while (copied < len)
+    {
+        int n = min(contiguousFree(txHead, txTail, USB_CDC_TX_BUFFER_SIZE), len - copied);
+
+        if (n <= 0)
+            break;
+
+        memcpy(txBuff + txHead, buffer + copied, n);
+        txHead = (txHead + n) % USB_CDC_TX_BUFFER_SIZE;
+        copied += n;
+    }
+
+    return copied;
+}
+
+/**
+ * Writes the contents of the transmit buffer to the host, straight from the ring buffer.
+ * The caller must hold txLock.
+ */
+int USBCDC::drainTx()
+{
+    while (txTail != txHead)
+    {
+        if (!isConnected() || in == NULL)
+            return DEVICE_INVALID_STATE;
+
+        int len = contiguousUsed(txHead, txTail, USB_CDC_TX_BUFFER_SIZE);
+        int result = in->write(txBuff + txTail, len);
+
+        if (result < 0)
+            return result;
+
+        txTail = (txTail + len) % USB_CDC_TX_BUFFER_SIZE;
+    }
+
+    return DEVICE_OK;
+}
+
+int USBCDC::flushTx()
+{
+    txLock.wait();
+    int result = drainTx();
+    txLock.notify();
+
+    return result;
+}
+
+int USBCDC::send(const uint8_t *buffer, int bufferLen, SerialMode mode)
+{
+    if (buffer == NULL || bufferLen <= 0)
+        return DEVICE_INVALID_PARAMETER;
+
+    startListening();
+
+    txLock.wait();
+
+    int bytesWritten = fillTxBuffer(buffer, bufferLen);
+
+    if (mode != ASYNC)
+    {
+        while (drainTx() == DEVICE_OK && bytesWritten < bufferLen)
+            bytesWritten += fillTxBuffer(buffer + bytesWritten, bufferLen - bytesWritten);
+    }
+
+    txLock.notify();
+
+    if (txHead != txTail && isConnected())
+        Event e(id, USB_CDC_EVT_TX);
+
+    return bytesWritten;
+}
+
+int USBCDC::send(ManagedString s, SerialMode mode)
+{
+    return send((const uint8_t *)s.toCharArray(), s.length(), mode);
+}
+
+int USBCDC::sendChar(char c, SerialMode mode)
+{
+    int result = send((const uint8_t *)&c, 1, mode);
+
+    return result == 0 ? DEVICE_NO_RESOURCES : result;
+}
+
+void USBCDC::waitForData(SerialMode mode)
+{
+    if (mode == SYNC_SLEEP && fiber_scheduler_running())
+    {
+        fiber_wake_on_event(id, USB_CDC_EVT_DATA_RECEIVED);
+        schedule();
+    }
+}
+
+int USBCDC::read(uint8_t *buffer, int bufferLen, SerialMode mode)
+{
+    if (buffer == NULL || bufferLen <= 0)
+        return DEVICE_INVALID_PARAMETER;
+
+    int count = 0;
+
+    while (count < bufferLen)
+    {
+        int n = min(contiguousUsed(rxHead, rxTail, USB_CDC_RX_BUFFER_SIZE), bufferLen - count);
+
+        if (n == 0)
+        {
+            if (mode == ASYNC)
+                break;
+
+            waitForData(mode);
+            continue;
+        }
+
+        memcpy(buffer + count, rxBuff + rxTail, n);
+        rxTail = (rxTail + n) % USB_CDC_RX_BUFFER_SIZE;
+        count += n;
+
+        resumeRx();
+    }
+
+    return count;
+}
+
+int USBCDC::read(SerialMode mode)
+{
+    uint8_t c;
+
+    if (read(&c, 1, mode) != 1)
+        return DEVICE_NO_DATA;
+
+    return c;
+}
+
+ManagedString USBCDC::read(int size, SerialMode mode)
+{
+    if (size <= 0)
+        return ManagedString();
+
+    ManagedBuffer b(size, BufferInitialize::None);
+    int len = read(b.getBytes(), size, mode);
+
+    return ManagedString((const char *)b.getBytes(), len);
+}
+
+void USBCDC::setSource(DataSource &source)
+{
+    startListening();
+    upstream = &source;
+    source.connect(*this);
+}
+
+int USBCDC::pullRequest()
+{
+    Event e(id, USB_CDC_EVT_PULL);
+
+    return DEVICE_OK;
+}
+
+void USBCDC::connect(DataSink &sink)
+{
+    startListening();
+
+    streamBuffer = ManagedBuffer(USB_CDC_STREAM_BUFFER_SIZE, BufferInitialize::None);
+    streamLength = 0;
+    downstream = &sink;
+}
+
+void USBCDC::disconnect()
+{
+    downstream = NULL;
+    output = ManagedBuffer();
+
+    target_disable_irq();
+    status &= ~USB_CDC_STATUS_STREAM_READY;
+    target_enable_irq();
+
+    resumeRx();
+}
+
+ManagedBuffer USBCDC::pull()
+{
+    ManagedBuffer b = output;
+    output = ManagedBuffer();
+
+    // The endpoint may have filled another buffer while this one was waiting.
+    if (status & USB_CDC_STATUS_STREAM_READY)
+        Event e(id, USB_CDC_EVT_STREAM);
+
+    return b;
+}
+
+int USBCDC::getFormat()
+{
+    return DATASTREAM_FORMAT_8BIT_UNSIGNED;
+}
+
+#endif
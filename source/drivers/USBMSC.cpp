@@ -68,6 +68,8 @@ DEALINGS IN THE SOFTWARE.
 
 #include "USBMassStorageClass.h"
 #include "EventModel.h"
+#include "Timer.h"
+#include "CodalFiber.h"
 
 #define CPU_TO_LE32(x) (x)
 #define le32_to_cpu(x) (x)
@@ -90,7 +92,7 @@ static inline uint16_t read16(uint8_t *p)
     return (p[0] << 8) | p[1];
 }
 
-static inline uint16_t read32(uint8_t *p)
+static inline uint32_t read32(uint8_t *p)
 {
     return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
 }
@@ -194,6 +196,10 @@ USBMSC::USBMSC() : CodalUSBInterface()
     failed = false;
     listen = false;
     disableIRQ = false;
+#ifdef USB_EP_FLAG_ASYNC
+    blockBuffers = NULL;
+#endif
+    resetStats();
 }
 
 int USBMSC::sendResponse(bool ok)
@@ -484,6 +490,86 @@ void USBMSC::writeHandler(Event)
     writeBlocks(blockAddr, blockCount);
 }
 
+#ifdef USB_EP_FLAG_ASYNC
+// wait for the IN endpoint to finish sending the previous asynchronous write, letting other fibers run
+void USBMSC::waitForEndpoint()
+{
+    while (!in->canWrite())
+        schedule();
+}
+#endif
+
+void USBMSC::readBlocks(int blockAddr, int numBlocks)
+{
+    CODAL_TIMESTAMP start = system_timer_current_time_us();
+
+#ifdef USB_EP_FLAG_ASYNC
+    if (blockBuffers == NULL)
+        blockBuffers = (uint8_t *)malloc(2 * USBMSC_BLOCK_SIZE);
+
+    if (blockBuffers)
+    {
+        // Asynchronous writes return once the endpoint has started sending, and the buffer must then be left
+        // alone until it has finished. Alternate between two buffers, so that the next block is read from
+        // storage while the previous one is on the bus.
+        in->flags |= USB_EP_FLAG_ASYNC;
+
+        for (int i = 0; i < numBlocks; i++)
+        {
+            uint8_t *buf = blockBuffers + (i & 1) * USBMSC_BLOCK_SIZE;
+
+            if (!failed && readBlock(blockAddr + i, buf) != DEVICE_OK)
+                fail();
+
+            waitForEndpoint();
+            writeBulk(buf, USBMSC_BLOCK_SIZE);
+        }
+
+        waitForEndpoint();
+        in->flags &= ~USB_EP_FLAG_ASYNC;
+    }
+    else
+#endif
+    {
+        uint8_t buf[USBMSC_BLOCK_SIZE];
+
+        for (int i = 0; i < numBlocks; i++)
+        {
+            if (!failed && readBlock(blockAddr + i, buf) != DEVICE_OK)
+                fail();
+            writeBulk(buf, USBMSC_BLOCK_SIZE);
+        }
+    }
+
+    stats.blocksRead += numBlocks;
+    stats.readTime += (uint32_t)(system_timer_current_time_us() - start);
+
+    finishReadWrite();
+}
+
+void USBMSC::writeBlocks(int blockAddr, int numBlocks)
+{
+    CODAL_TIMESTAMP start = system_timer_current_time_us();
+    uint8_t buf[USBMSC_BLOCK_SIZE];
+
+    for (int i = 0; i < numBlocks; i++)
+    {
+        readBulk(buf, USBMSC_BLOCK_SIZE);
+        if (!failed && writeBlock(blockAddr + i, buf) != DEVICE_OK)
+            fail();
+    }
+
+    stats.blocksWritten += numBlocks;
+    stats.writeTime += (uint32_t)(system_timer_current_time_us() - start);
+
+    finishReadWrite();
+}
+
+void USBMSC::resetStats()
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
 bool USBMSC::cmdModeSense(bool is10)
 {
     uint8_t ro = isReadOnly() ? 0x80 : 0x00;
@@ -0,0 +1,172 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Sample3DSource.h"
+#include "ErrorNo.h"
+
+using namespace codal;
+
+/**
+ * Saturates the given value to the 16 bit signed range.
+ */
+static inline int16_t saturate16(int v)
+{
+    return v > 32767 ? 32767 : v < -32768 ? -32768 : (int16_t) v;
+}
+
+/**
+ * Constructor.
+ *
+ * @param bufferSize The number of samples in each output buffer. Defaults to SAMPLE3D_SOURCE_DEFAULT_BUFFER_SIZE.
+ */
+Sample3DSource::Sample3DSource(int bufferSize)
+{
+    this->downstream = NULL;
+    this->position = 0;
+    this->bufferSize = bufferSize > 0 ? bufferSize : SAMPLE3D_SOURCE_DEFAULT_BUFFER_SIZE;
+}
+
+/**
+ * Appends a sample to the stream. Each axis is saturated to the 16 bit signed range.
+ * When a buffer is complete, our downstream component is notified.
+ *
+ * Samples are discarded if no downstream component is connected.
+ *
+ * @param s The sample to append.
+ */
+void Sample3DSource::push(const Sample3D &s)
+{
+    if (downstream == NULL)
+        return;
+
+    // Allocate a new buffer on demand. This avoids holding any memory while nobody is listening.
+    if (position == 0)
+        buffer = ManagedBuffer(bufferSize * 3 * sizeof(int16_t), BufferInitialize::None);
+
+    int16_t *p = ((int16_t *) buffer.getBytes()) + (position * 3);
+
+    *p++ = saturate16(s.x);
+    *p++ = saturate16(s.y);
+    *p = saturate16(s.z);
+
+    position++;
+
+    // If the buffer is complete, hand it over. If the last buffer has not yet been pulled, it is dropped
+    // in favour of the most recent data.
+    if (position == bufferSize)
+    {
+        output = buffer;
+        buffer = ManagedBuffer();
+        position = 0;
+
+        downstream->pullRequest();
+    }
+}
+
+/**
+ * Provide the next available ManagedBuffer to our downstream caller, if available.
+ */
+ManagedBuffer Sample3DSource::pull()
+{
+    ManagedBuffer b = output;
+    output = ManagedBuffer();
+
+    return b;
+}
+
+/**
+ * Allow our downstream component to register itself with us.
+ */
+void Sample3DSource::connect(DataSink &sink)
+{
+    this->downstream = &sink;
+}
+
+/**
+ * Remove our downstream component.
+ */
+void Sample3DSource::disconnect()
+{
+    this->downstream = NULL;
+    this->buffer = ManagedBuffer();
+    this->output = ManagedBuffer();
+    this->position = 0;
+}
+
+/**
+ *  Determine the data format of the buffers streamed out of this component.
+ *
+ *  @return DATASTREAM_FORMAT_16BIT_SIGNED_XYZ
+ */
+int Sample3DSource::getFormat()
+{
+    return DATASTREAM_FORMAT_16BIT_SIGNED_XYZ;
+}
+
+/**
+ * Defines the data format of the buffers streamed out of this component.
+ * Only DATASTREAM_FORMAT_16BIT_SIGNED_XYZ is supported.
+ *
+ * @return DEVICE_OK if the format is DATASTREAM_FORMAT_16BIT_SIGNED_XYZ, DEVICE_NOT_SUPPORTED otherwise.
+ */
+int Sample3DSource::setFormat(int format)
+{
+    return format == DATASTREAM_FORMAT_16BIT_SIGNED_XYZ ? DEVICE_OK : DEVICE_NOT_SUPPORTED;
+}
+
+/**
+ *  Determine the number of samples in each buffer streamed out of this component.
+ *  @return The number of XYZ samples in each output buffer.
+ */
+int Sample3DSource::getBufferSize()
+{
+    return bufferSize;
+}
+
+/**
+ *  Defines the number of samples in each buffer streamed out of this component.
+ *  Any partially filled buffer is discarded.
+ *
+ *  @param samples the number of XYZ samples in each output buffer.
+ *  @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if samples is not positive.
+ */
+int Sample3DSource::setBufferSize(int samples)
+{
+    if (samples <= 0)
+        return DEVICE_INVALID_PARAMETER;
+
+    bufferSize = samples;
+    buffer = ManagedBuffer();
+    position = 0;
+
+    return DEVICE_OK;
+}
+
+/**
+ * Destructor.
+ */
+Sample3DSource::~Sample3DSource()
+{
+}
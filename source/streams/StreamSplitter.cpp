@@ -101,7 +101,7 @@ ManagedBuffer StreamSplitter::pull()
 void StreamSplitter::connect(DataSink &downstream)
 {
     int placed = 0;
-    DMESG("%s %p","Adding New Channel, ", &downstream);
+    DMESG_DEBUG(STREAM, "%s %p","Adding New Channel, ", &downstream);
 
     for (int i = 0; i < CONFIG_MAX_CHANNELS; i++)
     {
@@ -109,11 +109,11 @@ void StreamSplitter::connect(DataSink &downstream)
         if (outputChannels[i] == NULL){
             outputChannels[i] = &downstream;
             placed = 1;
-            DMESG("%s %d","Channel Added at location ", i);
+            DMESG_DEBUG(STREAM, "%s %d","Channel Added at location ", i);
             break;
         }
         else{
-            DMESG("Channel Filled, Trying Next one");
+            DMESG_DEBUG(STREAM, "Channel Filled, Trying Next one");
         }
     }
     if(placed == 1){
@@ -122,12 +122,12 @@ void StreamSplitter::connect(DataSink &downstream)
         
             for (int i = 0; i < CONFIG_MAX_CHANNELS; i++)
             {
-                DMESG("%p", outputChannels[i]);
-                DMESG("%s", "-------");
+                DMESG_DEBUG(STREAM, "%p", outputChannels[i]);
+                DMESG_DEBUG(STREAM, "%s", "-------");
             }
     }
     else{
-        DMESG("Channel Not Added - Max Number of Channels Reached?");
+        DMESG_WARN(STREAM, "Channel Not Added - Max Number of Channels Reached?");
     }
 
     if(numberChannels > 0){
@@ -26,8 +26,9 @@ DEALINGS IN THE SOFTWARE.
   * Class definition for a BitmapFont
   * This class represents a font that can be used by the display to render text.
   *
-  * A BitmapFont is typically 5x5, but up to 8x8.
-  * Each Row is represented by a byte in the array.
+  * A BitmapFont is typically 5x5, but may be up to 32 pixels wide and 32 pixels high.
+  * Each Row is represented by (width + 7) / 8 bytes in the array, most significant byte first,
+  * with the rightmost column held in the least significant bit.
   *
   * Row Format:
   *            ================================================================
@@ -45,6 +46,7 @@ DEALINGS IN THE SOFTWARE.
 
 #include "CodalConfig.h"
 #include "BitmapFont.h"
+#include "CodalCompat.h"
 
 using namespace codal;
 
@@ -63,11 +65,21 @@ BitmapFont BitmapFont::systemFont = BitmapFont(defaultFont, BITMAP_FONT_ASCII_EN
   * @param font A pointer to the beginning of the new font.
   *
   * @param asciiEnd the char value at which this font finishes.
+  *
+  * @param width The width of each glyph in pixels (1..32). Defaults to BITMAP_FONT_WIDTH.
+  *
+  * @param height The height of each glyph in pixels (1..32). Defaults to BITMAP_FONT_HEIGHT.
+  *
+  * @param proportional true if empty columns either side of each glyph should be trimmed when
+  *                     text is laid out. Defaults to false.
   */
-BitmapFont::BitmapFont(const unsigned char* characters, int asciiEnd)
+BitmapFont::BitmapFont(const unsigned char* characters, int asciiEnd, int width, int height, bool proportional)
 {
     this->characters = characters;
     this->asciiEnd = asciiEnd;
+    this->width = max(1, min(width, 32));
+    this->height = max(1, min(height, 32));
+    this->proportional = proportional;
 }
 
 /**
@@ -79,6 +91,9 @@ BitmapFont::BitmapFont()
 {
     this->characters = defaultFont;
     this->asciiEnd = BITMAP_FONT_ASCII_END;
+    this->width = BITMAP_FONT_WIDTH;
+    this->height = BITMAP_FONT_HEIGHT;
+    this->proportional = false;
 }
 
 /**
@@ -107,8 +122,73 @@ BitmapFont BitmapFont::getSystemFont()
  */
 const uint8_t* BitmapFont::get(char c)
 {
-    if (c < BITMAP_FONT_ASCII_START || c > BITMAP_FONT_ASCII_END)
+    if (c < BITMAP_FONT_ASCII_START || c > asciiEnd)
         return NULL;
 
-    return characters + (c-BITMAP_FONT_ASCII_START) * ((1 + (BITMAP_FONT_WIDTH / 8)) * BITMAP_FONT_HEIGHT);
+    return characters + (c-BITMAP_FONT_ASCII_START) * (((width + 7) / 8) * height);
+}
+
+/**
+ * Determines if the given pixel of a glyph is set.
+ *
+ * @param glyph A pointer to the glyph, as returned by get().
+ * @param x The column of the pixel, from 0 (leftmost) to width - 1.
+ * @param y The row of the pixel, from 0 (top) to height - 1.
+ *
+ * @return 1 if the pixel is set, 0 otherwise.
+ */
+int BitmapFont::getPixel(const uint8_t *glyph, int x, int y)
+{
+    int bytesPerRow = (width + 7) / 8;
+    int bit = width - 1 - x;
+
+    return (glyph[y * bytesPerRow + bytesPerRow - 1 - (bit >> 3)] >> (bit & 7)) & 1;
+}
+
+/**
+ * Renders the given character as a sequence of columns, as used when laying out scrolling text.
+ * Bit n of each column represents the pixel in row n of the glyph.
+ * Characters not present in the font are rendered as blank space.
+ *
+ * @param c The character to render.
+ * @param columns Buffer to receive the rendered columns, at least width entries long, or NULL to
+ *                just measure the character.
+ *
+ * @return The number of columns occupied by the character, excluding any inter-character spacing.
+ */
+int BitmapFont::getColumns(char c, uint32_t *columns)
+{
+    const uint8_t *glyph = get(c);
+    int first = width;
+    int last = -1;
+
+    for (int x = 0; x < width; x++)
+    {
+        uint32_t column = 0;
+
+        if (glyph)
+            for (int y = 0; y < height; y++)
+                column |= (uint32_t) getPixel(glyph, x, y) << y;
+
+        if (column)
+        {
+            first = min(first, x);
+            last = x;
+        }
+
+        if (columns)
+            columns[x] = column;
+    }
+
+    if (!proportional)
+        return width;
+
+    // Blank glyphs (such as space) still need to take up some room.
+    if (last < 0)
+        return (width + 1) / 2;
+
+    if (columns && first > 0)
+        memmove(columns, columns + first, (last - first + 1) * sizeof(uint32_t));
+
+    return last - first + 1;
 }
@@ -589,20 +589,19 @@ int Image::print(char c, int16_t x, int16_t y)
     // Paste.
     v = font.get(c);
 
-    for (int row=0; row<BITMAP_FONT_HEIGHT; row++)
+    for (int row=0; row<font.height; row++)
     {
         // Update our Y co-ord write position
         y1 = y+row;
 
-        for (int col = 0; col < BITMAP_FONT_WIDTH; col++)
+        for (int col = 0; col < font.width; col++)
         {
             // Update our X co-ord write position
             x1 = x+col;
 
             if (x1 < getWidth() && y1 < getHeight())
-                this->getBitmap()[y1*getWidth()+x1] = ((*v) & (0x10 >> col)) ? 255 : 0;
+                this->getBitmap()[y1*getWidth()+x1] = font.getPixel(v, col, row) ? 255 : 0;
         }
-        v++;
     }
 
     return DEVICE_OK;
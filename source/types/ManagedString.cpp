@@ -55,6 +55,29 @@ using namespace codal;
 
 REF_COUNTED_DEF_EMPTY(0, 0)
 
+#if CONFIG_ENABLED(MANAGED_STRING_STATIC_CHARS)
+// Read-only strings for each single printable character, so short strings like these need no heap allocation.
+// Each is laid out as a StringData: the reference count, (tag), length, then the character and its terminator.
+#if CONFIG_ENABLED(DEVICE_TAG)
+#define STATIC_CHAR(c) {0xffff, REF_TAG, 1, (c)}
+#define STATIC_CHAR_SIZE 4
+#else
+#define STATIC_CHAR(c) {0xffff, 1, (c)}
+#define STATIC_CHAR_SIZE 3
+#endif
+
+#define STATIC_CHAR_4(c) STATIC_CHAR(c), STATIC_CHAR(c + 1), STATIC_CHAR(c + 2), STATIC_CHAR(c + 3)
+#define STATIC_CHAR_16(c) STATIC_CHAR_4(c), STATIC_CHAR_4(c + 4), STATIC_CHAR_4(c + 8), STATIC_CHAR_4(c + 12)
+
+#define STATIC_CHAR_FIRST 32
+#define STATIC_CHAR_COUNT 96
+
+static const uint16_t staticChars[STATIC_CHAR_COUNT][STATIC_CHAR_SIZE] __attribute__((aligned(4))) = {
+    STATIC_CHAR_16(32), STATIC_CHAR_16(48), STATIC_CHAR_16(64),
+    STATIC_CHAR_16(80), STATIC_CHAR_16(96), STATIC_CHAR_16(112)
+};
+#endif
+
 
 /**
   * Internal constructor helper.
@@ -73,6 +96,22 @@ void ManagedString::initEmpty()
   */
 void ManagedString::initString(const char *str, int len)
 {
+    if (len <= 0)
+    {
+        initEmpty();
+        return;
+    }
+
+#if CONFIG_ENABLED(MANAGED_STRING_STATIC_CHARS)
+    uint8_t c = str[0];
+
+    if (len == 1 && c >= STATIC_CHAR_FIRST && c < STATIC_CHAR_FIRST + STATIC_CHAR_COUNT)
+    {
+        ptr = (StringData *)(void *)staticChars[c - STATIC_CHAR_FIRST];
+        return;
+    }
+#endif
+
     // Initialise this ManagedString as a new string, using the data provided.
     // We assume the string is sane, and null terminated.
     ptr = (StringData *) malloc(sizeof(StringData) + len + 1);
@@ -350,7 +389,11 @@ ManagedString& ManagedString::operator = (const ManagedString& s)
   */
 bool ManagedString::operator== (const ManagedString& s)
 {
-    return ((length() == s.length()) && (strcmp(toCharArray(),s.toCharArray())==0));
+    // Literals, interned strings and copies of a string all share the same data.
+    if (ptr == s.ptr)
+        return true;
+
+    return ((length() == s.length()) && (memcmp(toCharArray(), s.toCharArray(), length()) == 0));
 }
 
 /**
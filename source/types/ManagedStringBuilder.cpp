@@ -0,0 +1,163 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "ManagedStringBuilder.h"
+#include "CodalCompat.h"
+#include "ErrorNo.h"
+
+using namespace codal;
+
+#define REF_TAG REF_TAG_STRING
+
+// The longest string a ManagedString can describe.
+#define MANAGED_STRING_MAX_LENGTH 0x7fff
+
+ManagedStringBuilder::ManagedStringBuilder(int capacity)
+{
+    this->ptr = NULL;
+    this->capacity = 0;
+
+    if (capacity > 0)
+        reserve(capacity);
+}
+
+ManagedStringBuilder::~ManagedStringBuilder()
+{
+    free(ptr);
+}
+
+int ManagedStringBuilder::reserve(int capacity)
+{
+    if (capacity > MANAGED_STRING_MAX_LENGTH)
+        return DEVICE_INVALID_PARAMETER;
+
+    if (capacity <= this->capacity && ptr != NULL)
+        return DEVICE_OK;
+
+    StringData *p = (StringData *) realloc(ptr, sizeof(StringData) + capacity + 1);
+
+    if (p == NULL)
+        return DEVICE_NO_RESOURCES;
+
+    if (ptr == NULL)
+        p->len = 0;
+
+    ptr = p;
+    this->capacity = capacity;
+
+    return DEVICE_OK;
+}
+
+ManagedStringBuilder &ManagedStringBuilder::append(const char *str, int len)
+{
+    if (str == NULL || len <= 0)
+        return *this;
+
+    int required = length() + len;
+
+    if (required > capacity || ptr == NULL)
+    {
+        // Grow geometrically, so that building a string one part at a time copies it a bounded number of times.
+        int size = max(required, min(capacity * 2, MANAGED_STRING_MAX_LENGTH));
+
+        if (reserve(max(size, 16)) != DEVICE_OK && reserve(required) != DEVICE_OK)
+            return *this;
+    }
+
+    memcpy(ptr->data + ptr->len, str, len);
+    ptr->len += len;
+
+    return *this;
+}
+
+ManagedStringBuilder &ManagedStringBuilder::append(const char *str)
+{
+    if (str != NULL)
+        append(str, strlen(str));
+
+    return *this;
+}
+
+ManagedStringBuilder &ManagedStringBuilder::append(const ManagedString &s)
+{
+    return append(s.toCharArray(), s.length());
+}
+
+ManagedStringBuilder &ManagedStringBuilder::append(ManagedBuffer buffer)
+{
+    return append((const char *)buffer.getBytes(), buffer.length());
+}
+
+ManagedStringBuilder &ManagedStringBuilder::append(char c)
+{
+    return append(&c, 1);
+}
+
+ManagedStringBuilder &ManagedStringBuilder::append(int value)
+{
+    char str[12];
+
+    itoa(value, str);
+
+    return append(str, strlen(str));
+}
+
+void ManagedStringBuilder::clear()
+{
+    if (ptr)
+        ptr->len = 0;
+}
+
+ManagedString ManagedStringBuilder::toString()
+{
+    ManagedString s;
+    int len = length();
+
+    if (len == 0)
+        return s;
+
+    // Short strings, and those that would waste much of our buffer, get a buffer of their own.
+    if (len <= 1 || capacity - len > MANAGED_STRING_BUILDER_SLACK)
+    {
+        s.initString(ptr->data, len);
+        ptr->len = 0;
+        return s;
+    }
+
+    // Otherwise, our buffer becomes the string.
+    ptr->data[len] = 0;
+    REF_COUNTED_INIT(ptr);
+
+    s = ManagedString(ptr);
+    ptr->decr();
+
+    ptr = NULL;
+    capacity = 0;
+
+    return s;
+}
@@ -0,0 +1,129 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2021 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "ManagedStringTable.h"
+#include "PearsonHash.h"
+#include "ErrorNo.h"
+
+using namespace codal;
+
+ManagedStringTable::ManagedStringTable(int capacity)
+{
+    this->entries = NULL;
+    this->count = 0;
+    this->capacity = 4;
+
+    while (this->capacity < capacity && this->capacity < 0x8000)
+        this->capacity <<= 1;
+}
+
+ManagedStringTable::~ManagedStringTable()
+{
+    if (entries == NULL)
+        return;
+
+    for (int i = 0; i < capacity; i++)
+        if (entries[i])
+            entries[i]->decr();
+
+    free(entries);
+}
+
+int ManagedStringTable::lookup(const char *str, int len)
+{
+    if (entries == NULL)
+    {
+        entries = (StringData **) malloc(capacity * sizeof(StringData *));
+
+        if (entries == NULL)
+            return DEVICE_NO_RESOURCES;
+
+        memset(entries, 0, capacity * sizeof(StringData *));
+    }
+
+    int mask = capacity - 1;
+    int i = PearsonHash::hash16(str) & mask;
+
+    // Linear probing. The table is never allowed to fill, so an empty slot always ends the search.
+    while (entries[i])
+    {
+        if (entries[i]->len == len && memcmp(entries[i]->data, str, len) == 0)
+            return i;
+
+        i = (i + 1) & mask;
+    }
+
+    if (count + 1 > capacity - (capacity >> 2))
+        return DEVICE_NO_RESOURCES;
+
+    return i;
+}
+
+ManagedString ManagedStringTable::intern(ManagedString s)
+{
+    if (s.length() == 0)
+        return s;
+
+    int i = lookup(s.toCharArray(), s.length());
+
+    if (i < 0)
+        return s;
+
+    if (entries[i] == NULL)
+    {
+        // The table keeps the reference held by this copy.
+        ManagedString copy = s;
+        entries[i] = copy.leakData();
+        count++;
+    }
+
+    return ManagedString(entries[i]);
+}
+
+ManagedString ManagedStringTable::intern(const char *s)
+{
+    if (s == NULL || *s == 0)
+        return ManagedString::EmptyString;
+
+    int i = lookup(s, strlen(s));
+
+    if (i < 0 || entries[i] == NULL)
+        return intern(ManagedString(s));
+
+    return ManagedString(entries[i]);
+}
+
+bool ManagedStringTable::contains(ManagedString s)
+{
+    if (entries == NULL || s.length() == 0)
+        return false;
+
+    int i = lookup(s.toCharArray(), s.length());
+
+    return i >= 0 && entries[i] != NULL;
+}